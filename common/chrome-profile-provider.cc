@@ -23,13 +23,17 @@
 #include <time.h>
 #include <algorithm>
 #include <string>
-#include <bitset>
 
 #define NVALGRIND
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <gio/gio.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <utime.h>
+#include <sqlite3.h>
 #include "chrome/browser/browser_process.h"
 #include "chrome/browser/thumbnail_store.h"
 #include "chrome/browser/history/thumbnail_database.h"
@@ -65,23 +69,355 @@ ChromeProfileProvider::ChromeProfileProvider() :
   favorite_expback_(NULL),
   autocompletion_context_(NULL),
   autocompletion_callback_(NULL),
-  autocompletion_expback_(NULL)
+  autocompletion_expback_(NULL),
+  autocompletion_batch_callback_(NULL),
+  ready_context_(NULL),
+  ready_callback_(NULL),
+  syncing_(false),
+  session_file_(NULL)
 {
+  favorite_batch_.provider = this;
+  session_batch_.provider = this;
+  session_batch_.sessions = true;
 }
 
 ChromeProfileProvider::~ChromeProfileProvider() {
+  CancelThumbnailBatch(&favorite_batch_);
+  CancelThumbnailBatch(&session_batch_);
+  if (session_file_)
+    mwb_session_file_free (session_file_);
   if (autocompletion_controller_)
     delete autocompletion_controller_;
 }
 
+// Pages copied per sqlite3_backup_step(). Between steps the source is
+// unlocked so the browser can keep writing to it.
+#define PROFILE_SYNC_BACKUP_PAGES 64
+#define PROFILE_SYNC_BACKUP_PAUSE_MS 5
+// A running browser keeps some databases locked exclusively, and
+// steady writes keep restarting a backup, so give up after this long
+// and copy the file instead
+#define PROFILE_SYNC_BACKUP_TIMEOUT_S 5.0
+
+// Files the profile reads that aren't databases, they are synced
+// before the profile gets created along with the databases
+static const char* kProfileSyncRequired[] = {
+  "Preferences",
+  "Bookmarks",
+  "Current Session",
+};
+
+struct ProfileSyncData {
+  ChromeProfileProvider* provider;
+  gchar*                 src_dir;
+  gchar*                 dest_dir;
+};
+
+static bool
+profile_sync_is_database (const gchar* path)
+{
+  static const char kHeader[] = "SQLite format 3";
+  char header[sizeof (kHeader)];
+  bool result = false;
+
+  FILE* fp = fopen (path, "rb");
+  if (fp)
+    {
+      result = (fread (header, sizeof (header), 1, fp) == 1 &&
+                !memcmp (header, kHeader, sizeof (kHeader)));
+      fclose (fp);
+    }
+
+  return result;
+}
+
+static bool
+profile_sync_is_required (const gchar* rel_path)
+{
+  for (size_t i = 0; i < G_N_ELEMENTS (kProfileSyncRequired); i++)
+    if (!strcmp (rel_path, kProfileSyncRequired[i]))
+      return true;
+  return false;
+}
+
+// Lists the files under dir relative to it. Journals are skipped
+// because the backup API gives consistent copies without them, and so
+// is the cache, which the panel never reads.
+static void
+profile_sync_list (const gchar* dir,
+                   const gchar* rel_dir,
+                   std::vector<std::string>* files)
+{
+  gchar* path = rel_dir ? g_build_filename (dir, rel_dir, NULL)
+    : g_strdup (dir);
+  GDir* gdir = g_dir_open (path, 0, NULL);
+  const gchar* name;
+
+  g_free (path);
+  if (!gdir)
+    return;
+
+  while ((name = g_dir_read_name (gdir)))
+    {
+      gchar* rel_path = rel_dir ? g_build_filename (rel_dir, name, NULL)
+        : g_strdup (name);
+      gchar* full_path = g_build_filename (dir, rel_path, NULL);
+
+      if (g_str_has_suffix (name, "-journal") ||
+          !strcmp (rel_path, "Cache"))
+        ;
+      else if (g_file_test (full_path, G_FILE_TEST_IS_DIR))
+        profile_sync_list (dir, rel_path, files);
+      else if (g_file_test (full_path, G_FILE_TEST_IS_REGULAR))
+        files->push_back (rel_path);
+
+      g_free (full_path);
+      g_free (rel_path);
+    }
+
+  g_dir_close (gdir);
+}
+
+static bool
+profile_sync_copy_file (const gchar* src_path, const gchar* dest_path)
+{
+  GFile* src = g_file_new_for_path (src_path);
+  GFile* dest = g_file_new_for_path (dest_path);
+  GError* error = NULL;
+  bool copied;
+
+  copied = g_file_copy (src, dest, G_FILE_COPY_OVERWRITE,
+                        NULL, NULL, NULL, &error);
+  if (!copied)
+    {
+      g_warning ("[netpanel] unable to sync %s: %s",
+                 src_path, error->message);
+      g_error_free (error);
+    }
+  g_object_unref (src);
+  g_object_unref (dest);
+
+  return copied;
+}
+
+// The plain copy the backup falls back to. The journal goes along
+// with the database, if there is one, so SQLite can roll back a half
+// written transaction when the copy is opened.
+static bool
+profile_sync_copy_database (const gchar* src_path, const gchar* dest_path)
+{
+  gchar* src_journal = g_strconcat (src_path, "-journal", NULL);
+  gchar* dest_journal = g_strconcat (dest_path, "-journal", NULL);
+  bool copied = profile_sync_copy_file (src_path, dest_path);
+
+  if (copied && g_file_test (src_journal, G_FILE_TEST_IS_REGULAR))
+    profile_sync_copy_file (src_journal, dest_journal);
+  else
+    g_unlink (dest_journal);
+
+  g_free (src_journal);
+  g_free (dest_journal);
+
+  return copied;
+}
+
+static bool
+profile_sync_backup_database (const gchar* src_path, const gchar* dest_path)
+{
+  sqlite3* src = NULL;
+  sqlite3* dest = NULL;
+  sqlite3_backup* backup;
+  GTimer* timer;
+  int rc;
+
+  if (sqlite3_open_v2 (src_path, &src, SQLITE_OPEN_READONLY, NULL) ||
+      sqlite3_open (dest_path, &dest))
+    {
+      g_warning ("[netpanel] unable to open %s for syncing: %s", src_path,
+                 sqlite3_errmsg (dest ? dest : src));
+      sqlite3_close (src);
+      sqlite3_close (dest);
+      return false;
+    }
+
+  backup = sqlite3_backup_init (dest, "main", src, "main");
+  if (!backup)
+    {
+      g_warning ("[netpanel] unable to sync %s: %s", src_path,
+                 sqlite3_errmsg (dest));
+      sqlite3_close (src);
+      sqlite3_close (dest);
+      return false;
+    }
+
+  timer = g_timer_new ();
+  do
+    {
+      rc = sqlite3_backup_step (backup, PROFILE_SYNC_BACKUP_PAGES);
+      if (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED)
+        {
+          if (g_timer_elapsed (timer, NULL) > PROFILE_SYNC_BACKUP_TIMEOUT_S)
+            break;
+          sqlite3_sleep (PROFILE_SYNC_BACKUP_PAUSE_MS);
+        }
+    }
+  while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+  g_timer_destroy (timer);
+
+  sqlite3_backup_finish (backup);
+  if (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED)
+    g_warning ("[netpanel] backup of %s timed out, copying it instead",
+               src_path);
+  else if (rc != SQLITE_DONE)
+    g_warning ("[netpanel] unable to sync %s: %s", src_path,
+               sqlite3_errmsg (dest));
+
+  sqlite3_close (src);
+  sqlite3_close (dest);
+
+  // Timed out or failed, fall back to copying the file as it is
+  if (rc != SQLITE_DONE)
+    return profile_sync_copy_database (src_path, dest_path);
+
+  return true;
+}
+
+// Copies a file unless the copy has the same size and mtime already
+static void
+profile_sync_file (const gchar* src_dir,
+                   const gchar* dest_dir,
+                   const std::string& rel_path)
+{
+  gchar* src_path = g_build_filename (src_dir, rel_path.c_str(), NULL);
+  gchar* dest_path = g_build_filename (dest_dir, rel_path.c_str(), NULL);
+  struct stat src_stat, dest_stat;
+
+  if (g_stat (src_path, &src_stat) ||
+      (!g_stat (dest_path, &dest_stat) &&
+       dest_stat.st_size == src_stat.st_size &&
+       dest_stat.st_mtime == src_stat.st_mtime))
+    {
+      g_free (src_path);
+      g_free (dest_path);
+      return;
+    }
+
+  gchar* parent = g_path_get_dirname (dest_path);
+  g_mkdir_with_parents (parent, 0755);
+  g_free (parent);
+
+  bool copied;
+  if (profile_sync_is_database (src_path))
+    copied = profile_sync_backup_database (src_path, dest_path);
+  else
+    copied = profile_sync_copy_file (src_path, dest_path);
+
+  // Match the mtime so the next sync can tell the copy is current
+  if (copied)
+    {
+      struct utimbuf times;
+      times.actime = src_stat.st_atime;
+      times.modtime = src_stat.st_mtime;
+      g_utime (dest_path, &times);
+    }
+
+  g_free (src_path);
+  g_free (dest_path);
+}
+
+gpointer
+ChromeProfileProvider::SyncThread(gpointer data)
+{
+  ProfileSyncData* sync = static_cast<ProfileSyncData*>(data);
+  std::vector<std::string> files;
+  std::vector<std::string> later;
+
+  profile_sync_list (sync->src_dir, NULL, &files);
+
+  // Databases and the files the profile reads come first, then the
+  // profile can be created while the rest are copied
+  for (std::vector<std::string>::iterator i = files.begin();
+       i != files.end(); i++)
+    {
+      gchar* src_path = g_build_filename (sync->src_dir, i->c_str(), NULL);
+
+      if (profile_sync_is_required (i->c_str()) ||
+          profile_sync_is_database (src_path))
+        profile_sync_file (sync->src_dir, sync->dest_dir, *i);
+      else
+        later.push_back (*i);
+
+      g_free (src_path);
+    }
+
+  g_idle_add (ChromeProfileProvider::OnDatabasesSynced, sync->provider);
+
+  for (std::vector<std::string>::iterator i = later.begin();
+       i != later.end(); i++)
+    profile_sync_file (sync->src_dir, sync->dest_dir, *i);
+
+  g_idle_add (ChromeProfileProvider::OnSyncFinished, sync);
+
+  return NULL;
+}
+
+gboolean
+ChromeProfileProvider::OnDatabasesSynced(gpointer data)
+{
+  ChromeProfileProvider* self = static_cast<ChromeProfileProvider*>(data);
+
+  self->profile_ =
+    Profile::CreateProfile(self->user_data_dir_.AppendASCII("Default"));
+  if (!self->profile_)
+    {
+      g_warning ("[netpanel] unable to create the browser profile");
+      return FALSE;
+    }
+
+  self->history_service_ =
+    self->profile_->GetHistoryService(Profile::EXPLICIT_ACCESS);
+  self->session_service_ = self->profile_->GetSessionService();
+
+  if (!self->autocompletion_controller_) {
+    self->autocompletion_controller_ =
+      new AutocompleteController(self->profile_);
+    self->registrar_.Add(self,
+                         NotificationType::AUTOCOMPLETE_CONTROLLER_RESULT_UPDATED,
+                         NotificationService::AllSources());
+  }
+  else
+    self->autocompletion_controller_->SetProfile(self->profile_);
+
+  if (self->ready_callback_)
+    self->ready_callback_ (self->ready_context_);
+
+  return FALSE;
+}
+
+gboolean
+ChromeProfileProvider::OnSyncFinished(gpointer data)
+{
+  ProfileSyncData* sync = static_cast<ProfileSyncData*>(data);
+
+  sync->provider->syncing_ = false;
+
+  g_free (sync->src_dir);
+  g_free (sync->dest_dir);
+  delete sync;
+
+  return FALSE;
+}
+
 bool
-ChromeProfileProvider::Initialize(const char* config_dir_name)
+ChromeProfileProvider::Initialize(const char*    config_dir_name,
+                                  void*          ready_context,
+                                  ReadyCallBack* ready_callback)
 {
-  if (profile_)
+  if (profile_ || syncing_)
     return false;
 
-  // TODO: improve the performance
-  // Sync the chrome default profile
+  // Sync the chrome default profile. Only files that changed since
+  // the last sync are copied.
   gchar* chrome_profile_path = g_build_filename (g_get_home_dir(),
                                                  ".config",
                                                  config_dir_name,
@@ -92,34 +428,35 @@ ChromeProfileProvider::Initialize(const char* config_dir_name)
                                                 ".config",
                                                 "web-panel",
                                                 NULL);
-  
+
   g_mkdir_with_parents (panel_profile_path, 0755);
-  
-  std::string cmd_line = "rsync -av " + std::string(chrome_profile_path) + " " + std::string(panel_profile_path) + " -a";
 
-  //printf("command line: %s\n", cmd_line.c_str());
-  
-  g_spawn_command_line_sync (cmd_line.c_str(), NULL, NULL, NULL, NULL);
-  
   user_data_dir_ = FilePath(panel_profile_path);
 
-  g_free(chrome_profile_path);
+  ProfileSyncData* sync = new ProfileSyncData;
+  sync->provider = this;
+  sync->src_dir = chrome_profile_path;
+  sync->dest_dir = g_build_filename (panel_profile_path, "Default", NULL);
+
   g_free(panel_profile_path);
 
-  profile_ = Profile::CreateProfile(user_data_dir_.AppendASCII("Default"));
-  if (!profile_)
-    return false;
+  ready_context_ = ready_context;
+  ready_callback_ = ready_callback;
 
-  history_service_ = profile_->GetHistoryService(Profile::EXPLICIT_ACCESS);
-  session_service_ = profile_->GetSessionService();
+  GError* error = NULL;
+  if (!g_thread_create (ChromeProfileProvider::SyncThread,
+                        sync, FALSE, &error))
+    {
+      g_warning ("[netpanel] unable to start profile sync: %s",
+                 error->message);
+      g_error_free (error);
+      g_free (sync->src_dir);
+      g_free (sync->dest_dir);
+      delete sync;
+      return false;
+    }
 
-  if (!autocompletion_controller_) {
-    autocompletion_controller_ = new AutocompleteController(profile_);
-    registrar_.Add(this, NotificationType::AUTOCOMPLETE_CONTROLLER_RESULT_UPDATED,
-                   NotificationService::AllSources());
-  }
-  else
-    autocompletion_controller_->SetProfile(profile_);
+  syncing_ = true;
 
   return true;
 }
@@ -167,39 +504,27 @@ ChromeProfileProvider::OnSegmentUsageAvailable(CancelableRequestProvider::Handle
     return;
   }
 
+  // Drop anything left over from an earlier request
+  CancelThumbnailBatch(&favorite_batch_);
+  favorite_batch_.fetches.clear();
+
   for (size_t i = 0; i < page_data->size(); i++)
     {
-      PageUsageData page = *(*page_data)[i];
-
-      thumbnail_urls_.push_back(page.GetURL().spec().c_str());
+      const PageUsageData* page = (*page_data)[i];
+      ThumbnailFetch fetch;
 
-      if (history_service_->GetPageThumbnail(page.GetURL(),
-                                             &consumer_,
-                                             NewCallback(static_cast<ChromeProfileProvider*>(this),
-                                                         &ChromeProfileProvider::OnThumbnailDataAvailable)))
-        {
-          //nest run message loop to make sure thumbnail data is ready before callback
-          bool old_state = MessageLoop::current()->NestableTasksAllowed();
-          MessageLoop::current()->SetNestableTasksAllowed(true);
-          MessageLoop::current()->Run();
-          MessageLoop::current()->SetNestableTasksAllowed(old_state);
-        }
-      if (favorite_context_ && favorite_callback_)
-        {
-          favorite_callback_ (favorite_context_,
-                              page.GetURL().spec().c_str(),
-                              UTF16ToUTF8(page.GetTitle()).c_str());
-        }
+      fetch.url = page->GetURL().spec();
+      fetch.title = UTF16ToUTF8(page->GetTitle());
+      fetch.tab_id = 0;
+      fetch.navigation_index = 0;
+      favorite_batch_.fetches.push_back(fetch);
 
 #ifdef DEBUG_CHROMIUM_API
-      g_debug ("Fav: %s, %s",
-               page.GetURL().spec().c_str(),
-               UTF16ToUTF8(page.GetTitle()).c_str());
+      g_debug ("Fav: %s, %s", fetch.url.c_str(), fetch.title.c_str());
 #endif
     }
-  favorite_context_ = NULL;
-  favorite_callback_ = NULL;
-  favorite_expback_ = NULL;
+
+  StartThumbnailBatch(&favorite_batch_);
 }
 
 void
@@ -210,8 +535,17 @@ ChromeProfileProvider::StartAutoComplete(const char* keyword,
 {
   autocompletion_context_ = context;
   autocompletion_callback_ = callback;
+  autocompletion_batch_callback_ = NULL;
   autocompletion_expback_ = expback;
 
+  RunAutoComplete(keyword);
+}
+
+// The callbacks must be in place first, the controller can deliver
+// results before Start() returns
+void
+ChromeProfileProvider::RunAutoComplete(const char* keyword)
+{
   if (keyword && autocompletion_controller_)
     {
       // Fire ac event to UI thread
@@ -223,6 +557,20 @@ ChromeProfileProvider::StartAutoComplete(const char* keyword,
     }
 }
 
+void
+ChromeProfileProvider::StartAutoCompleteBatch(const char* keyword,
+                                              void* context,
+                                              AutoCompletionBatchCallBack* callback,
+                                              ExceptionCallback* expback)
+{
+  autocompletion_context_ = context;
+  autocompletion_callback_ = NULL;
+  autocompletion_batch_callback_ = callback;
+  autocompletion_expback_ = expback;
+
+  RunAutoComplete(keyword);
+}
+
 void
 ChromeProfileProvider::StopAutoComplete(void)
 {
@@ -230,18 +578,119 @@ ChromeProfileProvider::StopAutoComplete(void)
 }
 
 
-void 
+// Give up on thumbnails that take longer than this, the pages are
+// delivered without them
+#define THUMBNAIL_BATCH_DEADLINE_MS 500
+
+void
+ChromeProfileProvider::StartThumbnailBatch(ThumbnailBatch* batch)
+{
+  for (size_t i = 0; i < batch->fetches.size(); i++)
+    {
+      CancelableRequestProvider::Handle handle =
+        history_service_->GetPageThumbnail(GURL(batch->fetches[i].url),
+                                           &consumer_,
+                                           NewCallback(this,
+                                                       &ChromeProfileProvider::
+                                                       OnThumbnailDataAvailable));
+      if (handle)
+        batch->pending[handle] = i;
+    }
+
+  if (batch->pending.empty())
+    FinishThumbnailBatch(batch);
+  else
+    batch->deadline_source =
+      g_timeout_add (THUMBNAIL_BATCH_DEADLINE_MS,
+                     ChromeProfileProvider::OnThumbnailDeadline, batch);
+}
+
+void
+ChromeProfileProvider::CancelThumbnailBatch(ThumbnailBatch* batch)
+{
+  for (std::map<CancelableRequestProvider::Handle, size_t>::iterator i =
+         batch->pending.begin();
+       i != batch->pending.end(); i++)
+    history_service_->CancelRequest((*i).first);
+  batch->pending.clear();
+
+  if (batch->deadline_source)
+    {
+      g_source_remove (batch->deadline_source);
+      batch->deadline_source = 0;
+    }
+}
+
+void
+ChromeProfileProvider::FinishThumbnailBatch(ThumbnailBatch* batch)
+{
+  CancelThumbnailBatch(batch);
+
+  for (std::vector<ThumbnailFetch>::iterator i = batch->fetches.begin();
+       i != batch->fetches.end(); i++)
+    {
+      if (batch->sessions && session_context_ && session_callback_)
+        session_callback_(session_context_,
+                          i->tab_id,
+                          i->navigation_index,
+                          i->url.c_str(),
+                          i->title.c_str());
+      else if (!batch->sessions && favorite_context_ && favorite_callback_)
+        favorite_callback_(favorite_context_,
+                           i->url.c_str(),
+                           i->title.c_str());
+    }
+  batch->fetches.clear();
+
+  if (batch->sessions)
+    {
+      session_context_ = NULL;
+      session_callback_ = NULL;
+      session_expback_ = NULL;
+    }
+  else
+    {
+      favorite_context_ = NULL;
+      favorite_callback_ = NULL;
+      favorite_expback_ = NULL;
+    }
+}
+
+gboolean
+ChromeProfileProvider::OnThumbnailDeadline(gpointer data)
+{
+  ThumbnailBatch* batch = static_cast<ThumbnailBatch*>(data);
+
+  batch->deadline_source = 0;
+  batch->provider->FinishThumbnailBatch(batch);
+
+  return FALSE;
+}
+
+void
 ChromeProfileProvider::OnThumbnailDataAvailable(HistoryService::Handle handle,
                                                 scoped_refptr<RefCountedBytes> jpeg_data)
 {
-  if (jpeg_data.get()) 
+  ThumbnailBatch* batches[] = { &favorite_batch_, &session_batch_ };
+
+  for (size_t i = 0; i < G_N_ELEMENTS (batches); i++)
     {
-      SaveThumbnail(thumbnail_urls_.back(), 
-                    jpeg_data->front(), 
-                    jpeg_data->size());
-      thumbnail_urls_.pop_back();
+      std::map<CancelableRequestProvider::Handle, size_t>::iterator it =
+        batches[i]->pending.find(handle);
+
+      if (it == batches[i]->pending.end())
+        continue;
+
+      if (jpeg_data.get() && jpeg_data->size())
+        SaveThumbnail(batches[i]->fetches[(*it).second].url.c_str(),
+                      jpeg_data->front(),
+                      jpeg_data->size());
+
+      batches[i]->pending.erase(it);
+      if (batches[i]->pending.empty())
+        FinishThumbnailBatch(batches[i]);
+      return;
     }
-  MessageLoop::current()->Quit();
 }
 
 void
@@ -290,65 +739,125 @@ ChromeProfileProvider::SaveThumbnail(const char* url,
   return; 
 }
 
+// Appends a UTF-8 copy of a string and its terminator to the arena,
+// returning its offset
+static size_t
+append_to_arena (std::string* arena, std::string* scratch,
+                 const std::wstring& str)
+{
+  size_t offset = arena->size();
+
+  WideToUTF8(str.data(), str.size(), scratch);
+  arena->append(*scratch);
+  arena->push_back('\0');
+
+  return offset;
+}
+
+static size_t
+append_to_arena (std::string* arena, const std::string& str)
+{
+  size_t offset = arena->size();
+
+  arena->append(str);
+  arena->push_back('\0');
+
+  return offset;
+}
+
+void
+ChromeProfileProvider::BuildAutocompleteRecords(const AutocompleteResult& result)
+{
+  std::string& arena = autocompletion_arena_;
+
+  std::vector<size_t>& offsets = autocompletion_offsets_;
+
+  arena.clear();
+  offsets.clear();
+  autocompletion_records_.resize(result.size());
+
+  // The arena can move while it grows, so keep offsets until it's done
+  for (size_t i = 0; i < result.size(); i++)
+    {
+      const AutocompleteMatch& match = result.match_at(i);
+      AutocompleteRecord& record = autocompletion_records_[i];
+
+      record.type = (int)match.type;
+      record.relevance = match.relevance;
+      offsets.push_back(append_to_arena(&arena,
+                                        match.destination_url.spec()));
+      offsets.push_back(append_to_arena(&arena, &autocompletion_scratch_,
+                                        match.contents));
+      offsets.push_back(append_to_arena(&arena, &autocompletion_scratch_,
+                                        match.description));
+    }
+
+  const char* base = arena.data();
+  for (size_t i = 0; i < autocompletion_records_.size(); i++)
+    {
+      AutocompleteRecord& record = autocompletion_records_[i];
+
+      record.url = base + offsets[i * 3];
+      record.contents = base + offsets[i * 3 + 1];
+      record.description = base + offsets[i * 3 + 2];
+    }
+}
+
 void 
 ChromeProfileProvider::Observe(NotificationType type,
                                const NotificationSource& source,
                                const NotificationDetails& details)
 {
   // should check if controller is done to avoid duplicate results
-  if (autocompletion_controller_->done() &&
-      type == NotificationType::AUTOCOMPLETE_CONTROLLER_RESULT_UPDATED)
-    {
-      AutocompleteResult result;
-      result.CopyFrom(*(Details<const AutocompleteResult>(details).ptr()));
+  if (!autocompletion_controller_->done() ||
+      type != NotificationType::AUTOCOMPLETE_CONTROLLER_RESULT_UPDATED)
+    return;
 
-      if (result.size() == 0)
-        if (autocompletion_context_ && autocompletion_expback_)
-          {
-            autocompletion_expback_(autocompletion_context_, 0);
-            return;
-          }
+  const AutocompleteResult* result =
+    Details<const AutocompleteResult>(details).ptr();
 
-      for (size_t i = 0; i < result.size(); i++)
-        {
-          AutocompleteMatch match = result.match_at(i);
-          if (autocompletion_context_ && autocompletion_callback_)
-            {
-              char contents[match.contents.size() * 2 + 1];
-              char description[match.description.size() * 2 + 1];
+  if (result->size() == 0)
+    if (autocompletion_context_ && autocompletion_expback_)
+      {
+        autocompletion_expback_(autocompletion_context_, 0);
+        return;
+      }
 
-              sprintf(contents, "%ls", match.contents.c_str());
-              sprintf(description, "%ls", match.description.c_str());
+  if (!autocompletion_context_ ||
+      (!autocompletion_batch_callback_ && !autocompletion_callback_))
+    return;
 
-              autocompletion_callback_(autocompletion_context_,
-                                       (int)match.type, 
-                                       match.destination_url.spec().c_str(), 
-                                       contents, 
-                                       description);
-            }
+  BuildAutocompleteRecords(*result);
 
-#ifdef DEBUG_CHROMIUM_API
-          g_debug ("AC: type=%d, url=%s, fill=%ls, contents=%ls, desc=%ls", 
-                   match.type, 
-                   match.destination_url.spec().c_str(), 
-                   match.fill_into_edit.c_str(), 
-                   match.contents.c_str(),
-                   match.description.c_str());
-#endif
-        }
+  if (autocompletion_batch_callback_)
+    {
+      autocompletion_batch_callback_(autocompletion_context_,
+                                     autocompletion_records_.empty() ? NULL :
+                                     &autocompletion_records_[0],
+                                     autocompletion_records_.size());
+      return;
     }
-}
 
-static const SessionCommand::id_type kCommandTabClosed = 3;
-static const SessionCommand::id_type kCommandUpdateTabNavigation = 6;
+  for (size_t i = 0; i < autocompletion_records_.size(); i++)
+    {
+      const AutocompleteRecord& record = autocompletion_records_[i];
 
-struct TabEntry {
-  SessionID::id_type tab_id;
-  int                navigation_index;
-  std::string        url_spec;
-  string16           title;
-};
+      autocompletion_callback_(autocompletion_context_,
+                               record.type,
+                               record.url,
+                               record.contents,
+                               record.description);
 
+#ifdef DEBUG_CHROMIUM_API
+      g_debug ("AC: type=%d, relevance=%d, url=%s, contents=%s, desc=%s",
+               record.type,
+               record.relevance,
+               record.url,
+               record.contents,
+               record.description);
+#endif
+    }
+}
 
 void 
 ChromeProfileProvider::OnGotSession(SessionService::Handle handle,
@@ -403,6 +912,28 @@ ChromeProfileProvider::OnGotSession(SessionService::Handle handle,
 
 //#define USE_SESSION_SERVICE
 
+void
+ChromeProfileProvider::OnSessionTab(gint         tab_id,
+                                    gint         navigation_index,
+                                    const gchar* url,
+                                    const gchar* title,
+                                    gpointer     data)
+{
+  ThumbnailBatch* batch = static_cast<ThumbnailBatch*>(data);
+  ThumbnailFetch fetch;
+
+  fetch.url = url;
+  fetch.title = title;
+  fetch.tab_id = tab_id;
+  fetch.navigation_index = navigation_index;
+  batch->fetches.push_back(fetch);
+
+#ifdef DEBUG_CHROMIUM_API
+  g_debug ("tab_id=%d, navigation_index=0x%x, url=%s, title=%s",
+           tab_id, navigation_index, url, title);
+#endif
+}
+
 void
 ChromeProfileProvider::GetSessions(void* context, 
                                    SessionCallBack* callback,
@@ -418,73 +949,21 @@ ChromeProfileProvider::GetSessions(void* context,
                                                   &ChromeProfileProvider::
                                                   OnGotSession));
 #else
-  SessionFileReader session_reader(user_data_dir_.
-                                   AppendASCII("Default/Current Session"));
-
-  std::vector<SessionCommand*> commands;
-  session_reader.Read(BaseSessionService::SESSION_RESTORE, &commands);
-  // Fixme: 256 tabs should be big enough here
-  std::bitset<256> bitmap(0);
-  std::vector<TabEntry*> tabs;
-
-  std::map<int, TabEntry*> tabs_map;
-  
-  for (std::vector<SessionCommand*>::iterator i = commands.begin();
-       i < commands.end(); i++) 
-    {      
-      if ((*i))
-        {
-          if ((*i)->id() == kCommandUpdateTabNavigation)
-            {
-              scoped_ptr<Pickle> pickle((*i)->PayloadAsPickle());
-              if (!pickle.get())
-                continue;
-
-              void* iterator = NULL;
-              TabEntry *tab_entry = new TabEntry();
-
-              if (!pickle->ReadInt(&iterator, &tab_entry->tab_id) ||
-                  !pickle->ReadInt(&iterator, &tab_entry->navigation_index) ||
-                  !pickle->ReadString(&iterator, &tab_entry->url_spec) ||
-                  !pickle->ReadString16(&iterator, &tab_entry->title))
-                {
-                  continue;
-                }
-              tabs_map[tab_entry->tab_id] = tab_entry;
-            }
-          else if ((*i)->id() == kCommandTabClosed) // for closed tabs
-            {
-              scoped_ptr<Pickle> pickle((*i)->PayloadAsPickle());
-              if (!pickle.get())
-                continue;
-
-              struct ClosedPayload 
-              {
-                int id;
-                int64 time;
-              };
-
-              ClosedPayload payload;
-              
-              if(!(*i)->GetPayload(&payload, sizeof(payload)))
-                continue;
-              
-              
-              std::map<int, TabEntry*>::iterator it = tabs_map.find(payload.id);
-              
-              if (it != tabs_map.end())
-                tabs_map.erase(it);
-            }
-        }
+  if (!session_file_)
+    {
+      FilePath path = user_data_dir_.AppendASCII("Default/Current Session");
+      session_file_ = mwb_session_file_new (path.value().c_str());
     }
-  
-  for (std::map<int, TabEntry*>::iterator i = tabs_map.begin();
-       i != tabs_map.end(); i++)
+
+  // Only parses what the browser appended since the last call
+  GError* error = NULL;
+  if (!mwb_session_file_update (session_file_, &error))
     {
-      tabs.push_back((*i).second);
+      g_warning ("[netpanel] unable to read session: %s", error->message);
+      g_error_free (error);
     }
 
-  if (tabs.size() == 0)
+  if (mwb_session_file_get_n_tabs (session_file_) == 0)
     {
       if (session_context_ && session_expback_)
         session_expback_(session_context_, 0);
@@ -494,51 +973,21 @@ ChromeProfileProvider::GetSessions(void* context,
       return;
     }
 
-  // Second reverse scan
-  for (std::vector<TabEntry*>::iterator i = tabs.begin();
-       i < tabs.end(); i++) 
-    {
-      // Dont rely on this way - the session may or may not have thubmail available.
-      thumbnail_urls_.push_back((*i)->url_spec.c_str());
-      if (history_service_->GetPageThumbnail(GURL((*i)->url_spec),
-                                             &consumer_,
-                                             NewCallback(static_cast
-                                                         <ChromeProfileProvider*>(this),
-                                                         &ChromeProfileProvider::
-                                                         OnThumbnailDataAvailable)))
-        {
-          bool old_state = MessageLoop::current()->NestableTasksAllowed();
-          MessageLoop::current()->SetNestableTasksAllowed(true);
-          MessageLoop::current()->Run();
-          MessageLoop::current()->SetNestableTasksAllowed(old_state);
-        }
-      if (session_context_ && session_callback_)
-        {
-          session_callback_(session_context_,
-                            (*i)->tab_id, 
-                            (*i)->navigation_index,
-                            (*i)->url_spec.c_str(),
-                            UTF16ToUTF8((*i)->title).c_str());
-        }
+  // Drop anything left over from an earlier request
+  CancelThumbnailBatch(&session_batch_);
+  session_batch_.fetches.clear();
 
-#ifdef DEBUG_CHROMIUM_API
-      g_debug ("tab_id=%d, navigation_index=0x%x, url=%s, title=%s", 
-               (*i)->tab_id, 
-               (*i)->navigation_index, 
-               (*i)->url_spec.c_str(), 
-               UTF16ToUTF8((*i)->title).c_str());
-#endif
+  mwb_session_file_foreach (session_file_,
+                            ChromeProfileProvider::OnSessionTab,
+                            &session_batch_);
 
-      delete *i;
-    }
+  StartThumbnailBatch(&session_batch_);
 #endif
-  session_context_ = NULL;
-  session_callback_ = NULL;
-  session_expback_ = NULL;
 }
 
 bool ChromeProfileProvider::GetReady(void)
 {
-  return favorite_context_ == NULL && session_context_ == NULL;
+  return profile_ != NULL &&
+    favorite_context_ == NULL && session_context_ == NULL;
 }
 
@@ -23,6 +23,12 @@
 #include <time.h>
 #include <algorithm>
 #include <string>
+#include <map>
+#include <vector>
+
+#include <glib.h>
+
+#include "mwb-session-file.h"
 
 #include "app/app_paths.h"
 #include "base/basictypes.h"
@@ -65,9 +71,48 @@ typedef void AutoCompletionCallBack (void*       ac_ctx,
                                      const char* content, 
                                      const char* description);
 
+// One match of an autocomplete result. The strings are UTF-8 and only
+// valid during the batch callback.
+struct AutocompleteRecord {
+  int         type;
+  int         relevance;
+  const char* url;
+  const char* contents;
+  const char* description;
+};
+
+typedef void AutoCompletionBatchCallBack (void*                     ac_ctx,
+                                          const AutocompleteRecord* records,
+                                          size_t                    n_records);
+
 typedef void ExceptionCallback (void* ctx,
                                 int   errno);
 
+typedef void ReadyCallBack     (void* ready_ctx);
+
+class ChromeProfileProvider;
+
+// A page whose thumbnail is fetched before it gets passed to a
+// favorite or session callback
+struct ThumbnailFetch {
+  std::string url;
+  std::string title;
+  int         tab_id;
+  int         navigation_index;
+};
+
+// Thumbnails requested together. The pages get delivered in order once
+// every request has finished or the deadline has passed.
+struct ThumbnailBatch {
+  ThumbnailBatch() : provider(NULL), sessions(false), deadline_source(0) {}
+
+  ChromeProfileProvider*                         provider;
+  bool                                           sessions;
+  std::vector<ThumbnailFetch>                    fetches;
+  std::map<CancelableRequestProvider::Handle, size_t> pending;
+  guint                                          deadline_source;
+};
+
 class ChromeProfileProvider : public NotificationObserver {
 public:
   typedef unsigned char service_type;
@@ -75,7 +120,12 @@ public:
   ChromeProfileProvider();
   ~ChromeProfileProvider();
 
-  bool Initialize (const char* config_dir_name);
+  // Starts syncing the browser's profile in the background. The
+  // callback runs once the databases are in place and the profile has
+  // been created, the rest of the files keep syncing after that.
+  bool Initialize (const char*    config_dir_name,
+                   void*          ready_context,
+                   ReadyCallBack* ready_callback);
   void Uninitialize ();
 
   static ChromeProfileProvider* GetInstance();
@@ -90,6 +140,12 @@ public:
                             void*                   context,
                             AutoCompletionCallBack* callback,
                             ExceptionCallback* expback);
+  // Same as StartAutoComplete() but every result update is delivered
+  // in one call
+  void StartAutoCompleteBatch (const char*                  keyword,
+                               void*                        context,
+                               AutoCompletionBatchCallBack* callback,
+                               ExceptionCallback*           expback);
   void StopAutoComplete    (void);
 
   void GetSessions         (void*                   context,
@@ -109,6 +165,10 @@ public:
                                 const NotificationSource&         source,
                                 const NotificationDetails&        details);
 
+  void RunAutoComplete         (const char*                       keyword);
+
+  void BuildAutocompleteRecords (const AutocompleteResult&       result);
+
   void SaveThumbnail           (const char*                       url,
                                 const unsigned char* data,
                                 size_t len);
@@ -116,6 +176,21 @@ public:
   void OnGotSession            (SessionService::Handle            handle,
                                 std::vector<SessionWindow*>*      windows);
 
+  void StartThumbnailBatch     (ThumbnailBatch*                   batch);
+  void CancelThumbnailBatch    (ThumbnailBatch*                   batch);
+  void FinishThumbnailBatch    (ThumbnailBatch*                   batch);
+  static gboolean OnThumbnailDeadline (gpointer                   data);
+
+  static void OnSessionTab      (gint                              tab_id,
+                                gint                              navigation_index,
+                                const gchar*                      url,
+                                const gchar*                      title,
+                                gpointer                          data);
+
+  static gpointer SyncThread          (gpointer                   data);
+  static gboolean OnDatabasesSynced   (gpointer                   data);
+  static gboolean OnSyncFinished      (gpointer                   data);
+
   DISALLOW_EVIL_CONSTRUCTORS(ChromeProfileProvider);
 
   private:
@@ -135,8 +210,24 @@ public:
   void*                    autocompletion_context_;
   AutoCompletionCallBack*  autocompletion_callback_;
   ExceptionCallback*       autocompletion_expback_;
+  AutoCompletionBatchCallBack* autocompletion_batch_callback_;
+
+  // Reused for every result update, so converting a result only
+  // allocates when it is bigger than any before it
+  std::string              autocompletion_arena_;
+  std::string              autocompletion_scratch_;
+  std::vector<AutocompleteRecord> autocompletion_records_;
+  // Three per record, the url, contents and description
+  std::vector<size_t>      autocompletion_offsets_;
+
+  void*                    ready_context_;
+  ReadyCallBack*           ready_callback_;
+  bool                     syncing_;
+
+  MwbSessionFile*          session_file_;
 
   CancelableRequestConsumer consumer_;
 
-  std::vector<const char*> thumbnail_urls_;
+  ThumbnailBatch           favorite_batch_;
+  ThumbnailBatch           session_batch_;
 };
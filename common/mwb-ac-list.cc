@@ -28,8 +28,16 @@ extern "C" {
 #include <glib/gi18n.h>
 #include <math.h>
 #include "mwb-ac-list.h"
+#include "mwb-ac-query.h"
+#include "mwb-arena.h"
+#include "mwb-lifecycle.h"
 #include "mwb-separator.h"
+#include "mwb-stats.h"
 #include "mwb-utils.h"
+#include "mwb-trace.h"
+#include "mwb-assets.h"
+#include "mwb-texture-budget.h"
+#include "mwb-url-table.h"
 
 G_DEFINE_TYPE (MwbAcList, mwb_ac_list, MX_TYPE_WIDGET);
 
@@ -48,6 +56,9 @@ enum
 };
 
 #define MWB_AC_LIST_MAX_ENTRIES 15
+
+/* Enough for the strings of a full list of entries */
+#define MWB_AC_LIST_ARENA_BLOCK_SIZE 4096
 #define MWB_AC_LIST_ICON_SIZE 16
 
 #define MWB_AC_LIST_SUGGESTED_TLD_PREF "suggested_tld."
@@ -66,10 +77,22 @@ struct _MwbAcListPrivate
 
   GArray        *entries;
   guint          n_visible_entries;
+  /* Owns the label strings of the entries above, reset with them */
+  MwbArena      *entry_arena;
+  /* The URLs of the previous set of entries. They are held on to for
+     one more search as typing another character mostly finds the same
+     pages again, which then don't need interning from scratch. */
+  GPtrArray     *prev_urls;
 
   gint           tallest_entry;
 
+  /* Reused by paint to collect the separators and the icons of all the
+     visible rows so each kind is drawn in one go */
+  GArray        *separator_rects;
+  GArray        *icon_rects;
+
   guint            clear_timeout;
+  guint            lifecycle_id;
   gfloat           last_height;
   gdouble          anim_progress;
   ClutterTimeline *timeline;
@@ -79,6 +102,8 @@ struct _MwbAcListPrivate
   ClutterColor   match_color;
 
   GString       *search_text;
+  /* The LIKE pattern bound to search_stmt */
+  GString       *search_pattern;
   /* Keeps track of the old search text length so that we can clear
      the favicon cache when it shrinks */
   guint          old_search_length;
@@ -91,11 +116,10 @@ struct _MwbAcListPrivate
   sqlite3       *dbcon;
   sqlite3_stmt  *search_stmt;
 
-  /* List of suggested TLD completions */
-  GHashTable    *tld_suggestions;
-  /* Pointer to a key in the hash table which has the highest score so
-     we can quickly complete the common case */
-  const gchar   *best_tld_suggestion;
+  /* Suggested TLD completions, scored by how often their hosts are
+     visited */
+  MwbTldTrie    *tld_trie;
+  gboolean       tld_scores_loaded;
 };
 
 typedef struct _MwbAcListEntry MwbAcListEntry;
@@ -103,18 +127,22 @@ typedef struct _MwbAcListEntry MwbAcListEntry;
 struct _MwbAcListEntry
 {
   MxWidget *label_actor;
+  /* Allocated from the entry arena */
   gchar *label_text;
-  gchar *url;
-  gint type;
+  MwbUrl *url;
+  /* The places favicons.id of the result */
+  gint favicon_id;
   gint match_start, match_end;
   CoglHandle texture;
-
-  /* This is used for drawing the highlight and also for picking. Its
-     color gets set to the highlight color but it will not be painted
-     if the row is not highlighted */
+  /* Only set for icons decoded by mwb_ac_list_set_icon. They are
+     never evicted because the list is rebuilt on every keystroke
+     anyway. */
+  MwbTextureBudgetEntry *budget;
+
+  /* This is used for drawing the highlight. Its color gets set to the
+     highlight color but it will not be painted if the row is not
+     highlighted */
   MxWidget *highlight_widget;
-  guint highlight_motion_handler;
-  guint highlight_clicked_handler;
 };
 
 typedef struct _MwbAcListCachedFavicon MwbAcListCachedFavicon;
@@ -153,6 +181,8 @@ static void mwb_ac_list_add_default_entries (MwbAcList *self);
 
 static void mwb_ac_list_forget_search_engine (MwbAcList *self);
 
+static void mwb_ac_list_suspend (gpointer data);
+
 #define MWB_AC_LIST_SEARCH_ENTRY    0
 #define MWB_AC_LIST_HOSTNAME_ENTRY  1
 #define MWB_AC_LIST_N_FIXED_ENTRIES 2
@@ -240,6 +270,12 @@ mwb_ac_list_dispose (GObject *object)
       priv->separator = NULL;
     }
 
+  if (priv->lifecycle_id)
+    {
+      mwb_lifecycle_remove (priv->lifecycle_id);
+      priv->lifecycle_id = 0;
+    }
+
   mwb_ac_list_clear_entries (MWB_AC_LIST (object));
 
   mwb_ac_list_forget_search_engine (MWB_AC_LIST (object));
@@ -253,10 +289,16 @@ mwb_ac_list_finalize (GObject *object)
   MwbAcListPrivate *priv = MWB_AC_LIST (object)->priv;
 
   g_array_free (priv->entries, TRUE);
+  mwb_arena_free (priv->entry_arena);
+  g_array_free (priv->separator_rects, TRUE);
+  g_array_free (priv->icon_rects, TRUE);
+  g_ptr_array_foreach (priv->prev_urls, (GFunc) mwb_url_unref, NULL);
+  g_ptr_array_free (priv->prev_urls, TRUE);
 
   g_string_free (priv->search_text, TRUE);
+  g_string_free (priv->search_pattern, TRUE);
 
-  g_hash_table_unref (priv->tld_suggestions);
+  mwb_tld_trie_free (priv->tld_trie);
 
   if (priv->search_engine_name)
     g_free (priv->search_engine_name);
@@ -266,52 +308,6 @@ mwb_ac_list_finalize (GObject *object)
   G_OBJECT_CLASS (mwb_ac_list_parent_class)->finalize (object);
 }
 
-static gboolean
-mwb_ac_list_stristr (const gchar *haystack, const gchar *needle,
-                     gint *start_ret, gint *end_ret)
-{
-  const gchar *search_start;
-
-  /* Looks for the first occurence of needle in haystack both of which
-     are UTF-8 strings. Case is ignored as far as allowed by
-     g_unichar_tolower. */
-
-  /* Try each position in haystack */
-  for (search_start = haystack;
-       *search_start;
-       search_start = g_utf8_next_char (search_start))
-    {
-      const gchar *haystack_ptr = search_start;
-      const gchar *needle_ptr = needle;
-
-      while (TRUE)
-        {
-          if (*needle_ptr == 0)
-            {
-              /* If we've reached the end of the needle then we have
-                 found a match */
-              if (start_ret)
-                *start_ret = search_start - haystack;
-              if (end_ret)
-                *end_ret = haystack_ptr - haystack;
-              return TRUE;
-            }
-          else if (*haystack_ptr == 0)
-            break;
-          else if (g_unichar_tolower (g_utf8_get_char (haystack_ptr))
-                   != g_unichar_tolower (g_utf8_get_char (needle_ptr)))
-            break;
-          else
-            {
-              haystack_ptr = g_utf8_next_char (haystack_ptr);
-              needle_ptr = g_utf8_next_char (needle_ptr);
-            }
-        }
-    }
-
-  return FALSE;
-}
-
 static gfloat
 mwb_ac_list_get_height (MwbAcList *self,
                         gfloat     max_height)
@@ -389,6 +385,37 @@ mwb_ac_list_get_preferred_height_with_max (MwbAcList *self,
     }
 }
 
+static void
+mwb_ac_list_add_icon_rect (GArray *icon_rects,
+                           gfloat  x,
+                           gfloat  y)
+{
+  gfloat coords[8] = { x, y,
+                       x + MWB_AC_LIST_ICON_SIZE, y + MWB_AC_LIST_ICON_SIZE,
+                       0.0f, 0.0f, 1.0f, 1.0f };
+
+  g_array_append_vals (icon_rects, coords, 8);
+}
+
+static void
+mwb_ac_list_flush_icon_rects (GArray     *icon_rects,
+                              CoglHandle  texture)
+{
+  if (icon_rects->len == 0)
+    return;
+
+  cogl_set_source_texture (texture);
+  cogl_rectangles_with_texture_coords ((gfloat *) icon_rects->data,
+                                       icon_rects->len / 8);
+  g_array_set_size (icon_rects, 0);
+}
+
+/* The rows are painted in passes rather than one row at a time so
+   that consecutive drawing uses the same source. Cogl then batches the
+   separators into one draw, the icons into one per texture (or a
+   single one when they share an atlas) and the glyphs of all the
+   labels into one per glyph cache texture, instead of flushing after
+   every piece of every row. */
 static void
 mwb_ac_list_paint (ClutterActor *actor)
 {
@@ -396,9 +423,13 @@ mwb_ac_list_paint (ClutterActor *actor)
   MxPadding padding;
   ClutterGeometry geom;
   gfloat separator_height = 0.;
+  CoglHandle icon_texture = COGL_INVALID_HANDLE;
   gfloat ypos;
+  guint n_rows;
   guint i;
 
+  MWB_TRACE_BEGIN ("ac-list-paint");
+
   /* Chain up to get the background */
   CLUTTER_ACTOR_CLASS (mwb_ac_list_parent_class)->paint (actor);
 
@@ -413,60 +444,99 @@ mwb_ac_list_paint (ClutterActor *actor)
     clutter_actor_get_preferred_height (CLUTTER_ACTOR (priv->separator), -1,
                                         NULL, &separator_height);
 
-  for (i = 0;
-       i < priv->entries->len
+  /* Collect the separators and count the rows that fit */
+  g_array_set_size (priv->separator_rects, 0);
+  for (n_rows = 0;
+       n_rows < priv->entries->len
          && ypos + priv->tallest_entry <= geom.height + 1e-6;
-       i++)
+       n_rows++)
     {
-      MwbAcListEntry *entry = &g_array_index (priv->entries, MwbAcListEntry, i);
+      if (priv->separator
+          && ypos + priv->tallest_entry + separator_height
+          <= geom.height + 1e-6)
+        mwb_separator_add_rectangles (MWB_SEPARATOR (priv->separator),
+                                      ypos + priv->tallest_entry,
+                                      priv->separator_rects);
+
+      ypos += priv->tallest_entry + separator_height;
+    }
+
+  /* Only paint the highlight widget if the row is selected */
+  if (priv->selection >= 0 && (guint)priv->selection < n_rows)
+    {
+      MwbAcListEntry *entry = &g_array_index (priv->entries, MwbAcListEntry,
+                                              priv->selection);
 
-      /* Only paint the highlight widget if the row is selected */
-      if (entry->highlight_widget && (guint)priv->selection == i
+      if (entry->highlight_widget
           && CLUTTER_ACTOR_IS_MAPPED (CLUTTER_ACTOR (entry->highlight_widget)))
         clutter_actor_paint (CLUTTER_ACTOR (entry->highlight_widget));
+    }
+
+  if (priv->separator_rects->len > 0
+      && CLUTTER_ACTOR_IS_MAPPED (CLUTTER_ACTOR (priv->separator)))
+    {
+      mwb_separator_set_source (MWB_SEPARATOR (priv->separator));
+      cogl_rectangles ((gfloat *) priv->separator_rects->data,
+                       priv->separator_rects->len / 4);
+    }
+
+  /* Icons, grouped into one call for each run of rows with the same
+     texture such as the default globe */
+  ypos = padding.top;
+  for (i = 0; i < n_rows; i++)
+    {
+      MwbAcListEntry *entry = &g_array_index (priv->entries, MwbAcListEntry, i);
 
       if (entry->texture)
         {
           int y = ((int) ypos + priv->tallest_entry / 2
                    - MWB_AC_LIST_ICON_SIZE / 2);
 
-          cogl_set_source_texture (entry->texture);
-          cogl_rectangle (padding.left,
-                          y,
-                          padding.left + MWB_AC_LIST_ICON_SIZE,
-                          y + MWB_AC_LIST_ICON_SIZE);
+          if (entry->texture != icon_texture)
+            {
+              mwb_ac_list_flush_icon_rects (priv->icon_rects, icon_texture);
+              icon_texture = entry->texture;
+            }
+
+          mwb_ac_list_add_icon_rect (priv->icon_rects, padding.left, y);
         }
 
+      ypos += priv->tallest_entry + separator_height;
+    }
+  mwb_ac_list_flush_icon_rects (priv->icon_rects, icon_texture);
+
+  for (i = 0; i < n_rows; i++)
+    {
+      MwbAcListEntry *entry = &g_array_index (priv->entries, MwbAcListEntry, i);
+
       if (entry->label_actor
           && CLUTTER_ACTOR_IS_MAPPED (CLUTTER_ACTOR (entry->label_actor)))
         clutter_actor_paint (CLUTTER_ACTOR (entry->label_actor));
-
-      /* Temporarily move the separator with cogl_translate so that we can
-         paint it in the right place */
-      if (ypos + priv->tallest_entry + separator_height <= geom.height + 1e-6)
-        {
-          cogl_push_matrix ();
-          cogl_translate (0.0f, ypos + priv->tallest_entry, 0.0f);
-          clutter_actor_paint (CLUTTER_ACTOR (priv->separator));
-          cogl_pop_matrix ();
-        }
-
-      ypos += priv->tallest_entry + separator_height;
     }
+
+  MWB_TRACE_END ("ac-list-paint");
 }
 
-static void
-mwb_ac_list_pick (ClutterActor *actor, const ClutterColor *color)
+/* Returns the row under the stage position or -1. This is worked out
+   from the row layout rather than by picking the highlight boxes, so
+   the whole list only needs its bounding box in the pick buffer. */
+static gint
+mwb_ac_list_get_row_at_pos (MwbAcList *self,
+                            gfloat     stage_x,
+                            gfloat     stage_y)
 {
-  MwbAcListPrivate *priv = MWB_AC_LIST (actor)->priv;
+  MwbAcListPrivate *priv = self->priv;
+  ClutterActor *actor = CLUTTER_ACTOR (self);
   gfloat separator_height = 0;
-  gfloat ypos;
+  gfloat x, y, row_height;
   ClutterGeometry geom;
   MxPadding padding;
-  guint i;
+  guint row;
 
-  /* Chain up so we get a bounding box painted */
-  CLUTTER_ACTOR_CLASS (mwb_ac_list_parent_class)->pick (actor, color);
+  if (priv->tallest_entry <= 0
+      || !clutter_actor_transform_stage_point (actor, stage_x, stage_y,
+                                               &x, &y))
+    return -1;
 
   if (priv->separator)
     clutter_actor_get_preferred_height (CLUTTER_ACTOR (priv->separator), -1,
@@ -476,70 +546,53 @@ mwb_ac_list_pick (ClutterActor *actor, const ClutterColor *color)
 
   clutter_actor_get_allocation_geometry (actor, &geom);
 
-  ypos = padding.top;
-  geom.height -= (gint)padding.bottom;
+  y -= padding.top;
+  if (y < 0 || x < 0 || x >= geom.width)
+    return -1;
 
-  /* We only want to pick on the highlight boxes. We will paint the
-     highlight box regardless of whether the row is selected so that
-     we can pick on all rows */
-  for (i = 0;
-       i < priv->entries->len
-         && ypos + priv->tallest_entry <= geom.height + 1e-6;
-       i++)
-    {
-      MwbAcListEntry *entry = &g_array_index (priv->entries, MwbAcListEntry, i);
+  row_height = priv->tallest_entry + separator_height;
+  row = (guint) (y / row_height);
 
-      /* Only paint the highlight widget if the row is selected */
-      if (entry->highlight_widget
-          && CLUTTER_ACTOR_IS_MAPPED (CLUTTER_ACTOR (entry->highlight_widget)))
-        clutter_actor_paint (CLUTTER_ACTOR (entry->highlight_widget));
+  /* Not on the separator below the row, and only rows that are
+     painted completely */
+  if (y - row * row_height >= priv->tallest_entry
+      || row >= priv->entries->len
+      || padding.top + row * row_height + priv->tallest_entry
+      > geom.height - padding.bottom + 1e-6)
+    return -1;
 
-      ypos += priv->tallest_entry + separator_height;
-    }
+  return row;
 }
 
 static gboolean
-mwb_ac_list_set_selection_for_highlight (MwbAcList *ac_list,
-                                         ClutterActor *actor)
+mwb_ac_list_motion_event (ClutterActor       *actor,
+                          ClutterMotionEvent *event)
 {
-  MwbAcListPrivate *priv = ac_list->priv;
-  guint i;
-
-  for (i = 0; i < priv->entries->len; i++)
-    {
-      MwbAcListEntry *entry = &g_array_index (priv->entries, MwbAcListEntry, i);
+  MwbAcList *self = MWB_AC_LIST (actor);
+  gint row = mwb_ac_list_get_row_at_pos (self, event->x, event->y);
 
-      if (CLUTTER_ACTOR (entry->highlight_widget) == actor)
-        {
-          mwb_ac_list_set_selection (ac_list, i);
+  if (row < 0)
+    return FALSE;
 
-          return TRUE;
-        }
-    }
+  mwb_ac_list_set_selection (self, row);
 
-  return FALSE;
+  return TRUE;
 }
 
 static gboolean
-mwb_ac_list_highlight_motion_cb (ClutterActor *actor,
-                                 ClutterMotionEvent *event,
-                                 MwbAcList *ac_list)
+mwb_ac_list_button_press_event (ClutterActor       *actor,
+                                ClutterButtonEvent *event)
 {
-  return mwb_ac_list_set_selection_for_highlight (ac_list, actor);
-}
+  MwbAcList *self = MWB_AC_LIST (actor);
+  gint row = mwb_ac_list_get_row_at_pos (self, event->x, event->y);
 
-static gboolean
-mwb_ac_list_highlight_clicked_cb (ClutterActor *actor,
-                                  ClutterMotionEvent *event,
-                                  MwbAcList *ac_list)
-{
-  if (mwb_ac_list_set_selection_for_highlight (ac_list, actor))
-    {
-      g_signal_emit (ac_list, ac_list_signals[ACTIVATE_SIGNAL], 0);
-      return TRUE;
-    }
-  else
+  if (row < 0)
     return FALSE;
+
+  mwb_ac_list_set_selection (self, row);
+  g_signal_emit (self, ac_list_signals[ACTIVATE_SIGNAL], 0);
+
+  return TRUE;
 }
 
 static void
@@ -565,14 +618,6 @@ mwb_ac_list_forget_search_engine (MwbAcList *self)
     }
 }
 
-struct BestTldData
-{
-  const gchar *best_tld;
-  gint best_score;
-  gint best_overlap_length;
-  const gchar *search_string;
-};
-
 static void
 mwb_ac_list_update_entry (MwbAcList *ac_list,
                           MwbAcListEntry *entry)
@@ -584,16 +629,7 @@ mwb_ac_list_update_entry (MwbAcList *ac_list,
   if (entry->highlight_widget == NULL)
     {
       entry->highlight_widget = (MxWidget*)g_object_new (MX_TYPE_FRAME,
-                                                         "reactive", TRUE,
                                                          NULL);
-      entry->highlight_motion_handler
-        = g_signal_connect (entry->highlight_widget, "motion-event",
-                            G_CALLBACK (mwb_ac_list_highlight_motion_cb),
-                            ac_list);
-      entry->highlight_clicked_handler
-        = g_signal_connect (entry->highlight_widget, "button-press-event",
-                            G_CALLBACK (mwb_ac_list_highlight_clicked_cb),
-                            ac_list);
       clutter_actor_set_parent (CLUTTER_ACTOR (entry->highlight_widget),
                                 CLUTTER_ACTOR (ac_list));
     }
@@ -645,6 +681,8 @@ mwb_ac_list_allocate (ClutterActor           *actor,
   gfloat ypos;
   gfloat separator_height = 0;
 
+  MWB_TRACE_BEGIN ("ac-list-allocate");
+
   CLUTTER_ACTOR_CLASS (mwb_ac_list_parent_class)->allocate (actor, box, flags);
 
   mx_widget_get_padding (MX_WIDGET (actor), &padding);
@@ -658,9 +696,9 @@ mwb_ac_list_allocate (ClutterActor           *actor,
       clutter_actor_get_preferred_height (CLUTTER_ACTOR (priv->separator), -1,
                                           NULL, &separator_height);
 
-      /* The separator is actually going to be draw multiple times at
-         different locations using cogl_translate, so we just want to
-         allocate it with the right width at the top */
+      /* The separator is actually going to be drawn multiple times at
+         different locations by paint, so we just want to allocate it
+         with the right width at the top */
       separator_box.x1 = 0;
       separator_box.x2 = box->x2 - box->x1;
       separator_box.y1 = 0;
@@ -729,6 +767,8 @@ mwb_ac_list_allocate (ClutterActor           *actor,
 
       ypos += (gfloat)priv->tallest_entry + separator_height;
     }
+
+  MWB_TRACE_END ("ac-list-allocate");
 }
 
 static void
@@ -790,7 +830,8 @@ mwb_ac_list_class_init (MwbAcListClass *klass)
 
   actor_class->get_preferred_height = mwb_ac_list_get_preferred_height;
   actor_class->paint = mwb_ac_list_paint;
-  actor_class->pick = mwb_ac_list_pick;
+  actor_class->motion_event = mwb_ac_list_motion_event;
+  actor_class->button_press_event = mwb_ac_list_button_press_event;
   actor_class->allocate = mwb_ac_list_allocate;
 
   pspec = g_param_spec_string ("search-text", "Search Text",
@@ -845,8 +886,13 @@ mwb_ac_list_init (MwbAcList *self)
   MwbAcListPrivate *priv = self->priv = MWB_AC_LIST_PRIVATE (self);
 
   priv->entries = g_array_new (FALSE, TRUE, sizeof (MwbAcListEntry));
+  priv->entry_arena = mwb_arena_new (MWB_AC_LIST_ARENA_BLOCK_SIZE);
+  priv->separator_rects = g_array_new (FALSE, FALSE, sizeof (gfloat));
+  priv->icon_rects = g_array_new (FALSE, FALSE, sizeof (gfloat));
+  priv->prev_urls = g_ptr_array_new ();
 
   priv->search_text = g_string_new ("");
+  priv->search_pattern = g_string_new ("");
 
   priv->selection = -1;
 
@@ -854,18 +900,22 @@ mwb_ac_list_init (MwbAcList *self)
   clutter_actor_set_parent (CLUTTER_ACTOR (priv->separator),
                             CLUTTER_ACTOR (self));
 
-  g_object_set (G_OBJECT (self), "clip-to-allocation", TRUE, NULL);
+  /* Rows are hit tested in the motion and button press handlers, the
+     default pick of the bounding box is all that is needed */
+  g_object_set (G_OBJECT (self),
+                "clip-to-allocation", TRUE,
+                "reactive", TRUE,
+                NULL);
 
-  priv->tld_suggestions = g_hash_table_new_full (g_str_hash,
-                                                 g_str_equal,
-                                                 g_free,
-                                                 NULL);
+  priv->tld_trie = mwb_tld_trie_new ();
 
   g_signal_connect (self, "style-changed",
                     G_CALLBACK (mwb_ac_list_style_changed_cb), NULL);
 
   priv->dbcon = NULL;
   priv->search_stmt = NULL;
+
+  priv->lifecycle_id = mwb_lifecycle_add (mwb_ac_list_suspend, NULL, self);
 }
 
 MxWidget*
@@ -874,9 +924,6 @@ mwb_ac_list_new (void)
   return MX_WIDGET (g_object_new (MWB_TYPE_AC_LIST, NULL));
 }
 
-#define FAVICON_SQL "SELECT url FROM favicons WHERE id='%d'"
-
-#define THEMEDIR "/usr/share/meego-panel-web/netpanel/"
 static void
 mwb_ac_list_set_icon (MwbAcList *self, MwbAcListEntry *entry)
 {
@@ -885,53 +932,11 @@ mwb_ac_list_set_icon (MwbAcList *self, MwbAcListEntry *entry)
 
   GError *texture_error = NULL;
 
-  if (!entry)
+  if (!entry || !entry->url)
     return;
 
-  gchar *favi_url = NULL;
-  gchar *icon_path = NULL;
-
-  sqlite3_stmt *favicon_stmt;
-  gchar *stmt = g_strdup_printf(FAVICON_SQL, entry->type);
-  int rc = sqlite3_prepare_v2 (priv->dbcon,
-                           stmt,
-                           -1,
-                           &favicon_stmt, NULL);
-  if (rc)
-    g_warning ("[netpanel] sqlite3_prepare_v2():tab_stmt %s",
-               sqlite3_errmsg(priv->dbcon));
-
-  if (priv->dbcon && favicon_stmt)
-    {
-      if (sqlite3_step (favicon_stmt) == SQLITE_ROW)
-        {
-          favi_url = (gchar*)sqlite3_column_text(favicon_stmt, 0);
-        }
-    }
-
-  if(favi_url)
-    {
-      gchar *csum = g_compute_checksum_for_string (G_CHECKSUM_MD5, favi_url, -1);
-      gchar *thumbnail_filename = g_strconcat (csum, ".ico", NULL);
-      icon_path = g_build_filename (g_get_home_dir (),
-                                    ".config",
-                                    "internet-panel",
-                                    "favicons",
-                                    thumbnail_filename,
-                                    NULL);
-      if (!g_file_test (icon_path, G_FILE_TEST_EXISTS))
-        {
-          g_free (icon_path);
-          icon_path = g_strdup_printf ("%s%s", THEMEDIR, "o2_globe.png");
-        }
-      g_free(csum);
-      g_free(thumbnail_filename);
-    }
-  else
-    {
-      icon_path = g_strdup_printf("%s%s", THEMEDIR, "o2_globe.png");
-    }
-  sqlite3_finalize(favicon_stmt);
+  gchar *icon_path
+    = mwb_ac_query_get_favicon_filename (priv->dbcon, entry->favicon_id);
 
   if (icon_path)
     {
@@ -945,9 +950,21 @@ mwb_ac_list_set_icon (MwbAcList *self, MwbAcListEntry *entry)
                      texture_error->message);
           g_error_free (texture_error);
         }
-      clutter_actor_queue_redraw (CLUTTER_ACTOR (self));
+      else if (entry->texture != COGL_INVALID_HANDLE)
+        entry->budget
+          = mwb_texture_budget_add (cogl_texture_get_width (entry->texture)
+                                    * cogl_texture_get_height (entry->texture)
+                                    * 4,
+                                    TRUE, NULL, NULL, NULL);
       g_free(icon_path);
     }
+
+  /* The globe is shared by every row without a favicon so it isn't
+     accounted per row */
+  if (entry->texture == COGL_INVALID_HANDLE)
+    entry->texture = mwb_assets_get_texture ("o2_globe.png");
+
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (self));
 }
 
 static void
@@ -956,6 +973,7 @@ mwb_ac_list_new_frame_cb (ClutterTimeline *timeline,
                           MwbAcList       *self)
 {
   MwbAcListPrivate *priv = self->priv;
+  mwb_stats_wakeup (MWB_STATS_WAKEUP_ANIMATION);
   priv->anim_progress = clutter_timeline_get_progress (timeline);
   clutter_actor_queue_relayout (CLUTTER_ACTOR (self));
 }
@@ -1015,23 +1033,20 @@ mwb_ac_list_result_received(void       *context,
   if (!url || !value) /* No URL */
     return;
 
-  char *result_text = NULL;
-
-  result_text = g_strdup(value);
+  /* The first result of a new search replaces the old ones, so remove
+     the clear timeout */
+  if (priv->clear_timeout)
+    {
+      mwb_ac_list_clear_entries (self);
+      mwb_ac_list_add_default_entries (self);
+      g_source_remove (priv->clear_timeout);
+      priv->clear_timeout = 0;
+    }
 
   if (priv->entries->len < MWB_AC_LIST_MAX_ENTRIES)
     {
       MwbAcListEntry *entry;
-      //xxx MwbAcListCachedFavicon *cached_favicon;
-
-      /* Remove the clear timeout */
-      if (priv->clear_timeout)
-        {
-          mwb_ac_list_clear_entries (self);
-          mwb_ac_list_add_default_entries (self);
-          g_source_remove (priv->clear_timeout);
-          priv->clear_timeout = 0;
-        }
+      gchar *result_text = mwb_arena_strdup (priv->entry_arena, value);
 
       g_array_set_size (priv->entries, priv->entries->len + 1);
       entry = &g_array_index (priv->entries, MwbAcListEntry,
@@ -1039,17 +1054,17 @@ mwb_ac_list_result_received(void       *context,
 
       /* Prefer to display the comment if the search string matches in
          it */
-      if (!mwb_ac_list_stristr (result_text, priv->search_text->str,
-                               &entry->match_start, &entry->match_end))
+      if (!mwb_ac_query_stristr (result_text, priv->search_text->str,
+                                 &entry->match_start, &entry->match_end))
         {
           /* If neither match just display the comment and trust that
              places had some reason to suggest it */
           entry->match_start = entry->match_end = 0;
         }
 
-      entry->label_text = (gchar*)result_text;
-      entry->url = g_strdup (url);
-      entry->type = favicon_id;
+      entry->label_text = result_text;
+      entry->url = mwb_url_intern (url);
+      entry->favicon_id = favicon_id;
 
       mwb_ac_list_update_entry (self, entry);
       mwb_ac_list_set_icon (self, entry);
@@ -1066,6 +1081,9 @@ mwb_ac_list_clear_entries (MwbAcList *self)
   MwbAcListPrivate *priv = self->priv;
   guint i;
 
+  g_ptr_array_foreach (priv->prev_urls, (GFunc) mwb_url_unref, NULL);
+  g_ptr_array_set_size (priv->prev_urls, 0);
+
   for (i = 0; i < priv->entries->len; i++)
     {
       MwbAcListEntry *entry
@@ -1073,22 +1091,17 @@ mwb_ac_list_clear_entries (MwbAcList *self)
       if (entry->label_actor)
         clutter_actor_unparent (CLUTTER_ACTOR (entry->label_actor));
       if (entry->highlight_widget)
-        {
-          g_signal_handler_disconnect (entry->highlight_widget,
-                                       entry->highlight_clicked_handler);
-          g_signal_handler_disconnect (entry->highlight_widget,
-                                       entry->highlight_motion_handler);
-          clutter_actor_unparent (CLUTTER_ACTOR (entry->highlight_widget));
-        }
-      if (entry->label_text)
-        g_free (entry->label_text);
+        clutter_actor_unparent (CLUTTER_ACTOR (entry->highlight_widget));
       if (entry->url)
-        g_free (entry->url);
+        g_ptr_array_add (priv->prev_urls, entry->url);
       if (entry->texture != COGL_INVALID_HANDLE)
         cogl_handle_unref (entry->texture);
+      if (entry->budget)
+        mwb_texture_budget_remove (entry->budget);
     }
 
   g_array_set_size (priv->entries, 0);
+  mwb_arena_reset (priv->entry_arena);
 
   if (priv->selection >= 0)
     {
@@ -1105,7 +1118,7 @@ static void
 mwb_ac_list_add_default_entry (MwbAcList *self,
                                const gchar *label_text,
                                const gchar *search_text,
-                               gchar *url,
+                               const gchar *url,
                                CoglHandle icon)
 {
   MwbAcListPrivate *priv = self->priv;
@@ -1120,15 +1133,16 @@ mwb_ac_list_add_default_entry (MwbAcList *self,
      offsets in the hope that it would make translation easier */
   if ((marker = strstr (label_text, "%s")) == NULL)
     {
-      entry->label_text = g_strdup (label_text);
+      entry->label_text = mwb_arena_strdup (priv->entry_arena, label_text);
       entry->match_start = entry->match_end = -1;
     }
   else
     {
       size_t search_len = strlen (search_text);
       size_t end_len = strlen (marker + 2);
-      entry->label_text = (gchar*)g_malloc (marker - label_text
-                                    + search_len + end_len + 1);
+      entry->label_text = (gchar*)mwb_arena_alloc (priv->entry_arena,
+                                                   marker - label_text
+                                                   + search_len + end_len + 1);
       memcpy (entry->label_text, label_text, marker - label_text);
       memcpy (entry->label_text + (marker - label_text),
               search_text, search_len);
@@ -1138,117 +1152,13 @@ mwb_ac_list_add_default_entry (MwbAcList *self,
       entry->match_end = entry->match_start + search_len;
     }
 
-  entry->url = url;
+  entry->url = mwb_url_intern (url);
   if (icon != COGL_INVALID_HANDLE)
     entry->texture = cogl_handle_ref (icon);
 
   mwb_ac_list_update_entry (self, entry);
 }
 
-static void
-mwb_ac_list_check_best_tld_suggestion_overlap (gpointer key,
-                                               gpointer value,
-                                               gpointer user_data)
-{
-  struct BestTldData *data = (struct BestTldData *) user_data;
-  int overlap = -1;
-  const gchar *search_str_end = (data->search_string +
-                                 strlen (data->search_string));
-  const gchar *tail;
-  int keylen = strlen ((const char*)key);
-
-  /* Scan from the end of the string to find the most overlap with the
-     start of the key */
-  for (tail = search_str_end;
-       search_str_end - tail <= keylen &&
-         tail >= (const gchar *) data->search_string;
-       tail--)
-    if (g_str_has_prefix ((const char*)key, tail))
-      overlap = search_str_end - tail;
-
-  /* Use this key if more of it overlaps or it has a better score */
-  if (data->best_overlap_length < overlap ||
-      (data->best_overlap_length == overlap &&
-       data->best_score < GPOINTER_TO_INT (value)))
-    {
-      data->best_score = GPOINTER_TO_INT (value);
-      data->best_tld = (const char*)key;
-      data->best_overlap_length = overlap;
-    }
-}
-
-static void
-mwb_ac_list_complete_domain (MwbAcList *self,
-                             const gchar *search_text,
-                             gchar **completion,
-                             gchar **completion_url)
-{
-  MwbAcListPrivate *priv = self->priv;
-  const gchar *p;
-  gboolean has_dot = FALSE;
-  struct BestTldData data;
-
-  /* If we don't have any completions then just return the search
-     text */
-  if (priv->best_tld_suggestion == NULL)
-    {
-      *completion = g_strdup (search_text);
-      *completion_url = g_strdup (search_text);
-      return;
-    }
-
-  /* Check if the search text contains any characters that don't look
-     like part of a domain */
-  for (p = search_text; *p; p = g_utf8_next_char (p))
-    {
-      gunichar ch = g_utf8_get_char (p);
-
-      if (ch == '.')
-        has_dot = TRUE;
-
-      if (ch == '/' || ch == ':' || ch == '?' ||
-          (!g_unichar_isalnum (g_utf8_get_char_validated (p, -1)) &&
-           *p != '-' && *p != '.'))
-        {
-          *completion = g_strdup (search_text);
-          *completion_url = g_strdup (search_text);
-          return;
-        }
-    }
-
-  /* If the search string doesn't contain a dot then just append the
-     highest scoring tld */
-  if (!has_dot)
-    {
-      *completion = g_strconcat (search_text,
-                                 priv->best_tld_suggestion, NULL);
-      *completion_url = g_strconcat ("http://", *completion, "/", NULL);
-      return;
-    }
-
-  /* Otherwise look for the string with the longest overlap */
-  data.best_tld = NULL;
-  data.best_score = -1;
-  data.best_overlap_length = -1;
-  data.search_string = search_text;
-  g_hash_table_foreach (priv->tld_suggestions,
-                        mwb_ac_list_check_best_tld_suggestion_overlap,
-                        &data);
-  if (data.best_tld)
-    {
-      *completion = g_strconcat (search_text,
-                                 data.best_tld + data.best_overlap_length,
-                                 NULL);
-      *completion_url = g_strconcat ("http://", *completion, "/", NULL);
-    }
-  else
-    {
-      /* Otherwise we don't have a sensible suggestion */
-      *completion = g_strdup (search_text);
-      *completion_url = g_strdup (search_text);
-    }
-}
-
 static void
 mwb_ac_list_add_default_entries (MwbAcList *self)
 {
@@ -1293,8 +1203,7 @@ mwb_ac_list_add_default_entries (MwbAcList *self)
                                      priv->search_text->str,
                                      search_uri->str,
                                      priv->search_engine_icon);
-      /* Above call takes ownership of the URI string */
-      g_string_free (search_uri, FALSE);
+      g_string_free (search_uri, TRUE);
 
       g_free (label);
     }
@@ -1302,10 +1211,10 @@ mwb_ac_list_add_default_entries (MwbAcList *self)
     {
       gchar *completion, *completion_url;
 
-      mwb_ac_list_complete_domain (self,
-                                   priv->search_text->str,
-                                   &completion,
-                                   &completion_url);
+      mwb_ac_query_complete_domain (priv->tld_trie,
+                                    priv->search_text->str,
+                                    &completion,
+                                    &completion_url);
 
       mwb_ac_list_add_default_entry (self,
                                      _("Go to %s"),
@@ -1314,6 +1223,7 @@ mwb_ac_list_add_default_entries (MwbAcList *self)
                                      COGL_INVALID_HANDLE);
 
       g_free (completion);
+      g_free (completion_url);
     }
 }
 
@@ -1322,6 +1232,8 @@ mwb_ac_list_clear_timeout_cb (MwbAcList *self)
 {
   MwbAcListPrivate *priv = self->priv;
 
+  mwb_stats_wakeup (MWB_STATS_WAKEUP_CLEAR_TIMEOUT);
+
   mwb_ac_list_clear_entries (self);
   mwb_ac_list_add_default_entries (self);
 
@@ -1332,14 +1244,29 @@ mwb_ac_list_clear_timeout_cb (MwbAcList *self)
   return FALSE;
 }
 
-#define AC_LIST_SQL "SELECT DISTINCT url, url||' - '||title as vl, favicon_id "\
-                    "FROM ( "\
-                          "SELECT url, title, favicon_id, 100 as visit_count "\
-                          "FROM bookmarks "\
-                          "UNION "\
-                          "SELECT url, title, favicon_id, visit_count "\
-                          "FROM urls"\
-                         ") WHERE vl like ? ORDER BY visit_count DESC"
+/* Settles the list right away instead of waiting for the clear
+   timeout and the transition */
+static void
+mwb_ac_list_suspend (gpointer data)
+{
+  MwbAcList *self = MWB_AC_LIST (data);
+  MwbAcListPrivate *priv = self->priv;
+
+  if (priv->clear_timeout)
+    {
+      g_source_remove (priv->clear_timeout);
+      priv->clear_timeout = 0;
+
+      mwb_ac_list_clear_entries (self);
+      mwb_ac_list_add_default_entries (self);
+    }
+
+  if (priv->timeline)
+    {
+      priv->anim_progress = 1.0;
+      mwb_lifecycle_finish_timeline (priv->timeline);
+    }
+}
 
 void
 mwb_ac_list_set_search_text (MwbAcList *self,
@@ -1374,15 +1301,11 @@ mwb_ac_list_set_search_text (MwbAcList *self,
       if (search_text_len == 0 || !priv->search_stmt)
         return;
 
-      sqlite3_reset(priv->search_stmt);
-
-      gchar param[search_text_len + 3];
-      sprintf(param, "%%%s%%", search_text);
-      int rc = sqlite3_bind_text(priv->search_stmt, 1, param, search_text_len + 2, SQLITE_TRANSIENT);
+      int rc = mwb_ac_query_bind (priv->search_stmt, search_text,
+                                  priv->search_pattern);
       if (rc)
           g_warning("[netpanel] sqlite3_bind_text(): %s", sqlite3_errmsg(priv->dbcon));
 
-      priv->entries->len = 0;
       while (sqlite3_step(priv->search_stmt) == SQLITE_ROW)
         {
           mwb_ac_list_result_received(self,
@@ -1461,7 +1384,19 @@ mwb_ac_list_get_entry_url (MwbAcList *self, guint entry)
 
   g_return_val_if_fail (entry < priv->entries->len, NULL);
 
-  return g_strdup (g_array_index (priv->entries, MwbAcListEntry, entry).url);
+  return g_strdup (g_array_index (priv->entries, MwbAcListEntry, entry).url->str);
+}
+
+void
+mwb_ac_list_increment_tld_score_for_url (MwbAcList *self,
+                                         const gchar *url)
+{
+  MwbAcListPrivate *priv = self->priv;
+  const gchar *tld;
+  gsize tld_len;
+
+  if (mwb_tld_trie_find_tld (url, &tld, &tld_len))
+    mwb_tld_trie_add_score (priv->tld_trie, tld, tld_len, 1);
 }
 
 GList *
@@ -1469,7 +1404,7 @@ mwb_ac_list_get_tld_suggestions (MwbAcList *self)
 {
   MwbAcListPrivate *priv = self->priv;
 
-  return g_hash_table_get_keys (priv->tld_suggestions);
+  return mwb_tld_trie_get_keys (priv->tld_trie);
 }
 
 void
@@ -1488,7 +1423,7 @@ mwb_ac_list_db_stmt_prepare (MwbAcList *self, void *dbcon)
   if (!priv->search_stmt)
     {
       rc = sqlite3_prepare_v2 (priv->dbcon,
-                               AC_LIST_SQL,
+                               MWB_AC_QUERY_SQL,
                                -1,
                                &priv->search_stmt,
                                NULL);
@@ -1496,6 +1431,12 @@ mwb_ac_list_db_stmt_prepare (MwbAcList *self, void *dbcon)
       g_warning("[netpanel] sqlite3_prepare_v2 (): %s",
                 sqlite3_errmsg(priv->dbcon));
     }
+
+  /* Scores learned from the history only need loading once, later
+     visits are added by mwb_ac_list_increment_tld_score_for_url() */
+  if (!priv->tld_scores_loaded)
+    priv->tld_scores_loaded = mwb_ac_query_load_tld_scores (priv->dbcon,
+                                                            priv->tld_trie);
 }
 
 void
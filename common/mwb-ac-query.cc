@@ -0,0 +1,229 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include "mwb-ac-query.h"
+#include "mwb-utils.h"
+
+#define FAVICON_SQL "SELECT url FROM favicons WHERE id='%d'"
+
+gboolean
+mwb_ac_query_stristr (const gchar *haystack, const gchar *needle,
+                      gint *start_ret, gint *end_ret)
+{
+  const gchar *search_start;
+
+  /* Looks for the first occurence of needle in haystack both of which
+     are UTF-8 strings. Case is ignored as far as allowed by
+     g_unichar_tolower. */
+
+  /* Try each position in haystack */
+  for (search_start = haystack;
+       *search_start;
+       search_start = g_utf8_next_char (search_start))
+    {
+      const gchar *haystack_ptr = search_start;
+      const gchar *needle_ptr = needle;
+
+      while (TRUE)
+        {
+          if (*needle_ptr == 0)
+            {
+              /* If we've reached the end of the needle then we have
+                 found a match */
+              if (start_ret)
+                *start_ret = search_start - haystack;
+              if (end_ret)
+                *end_ret = haystack_ptr - haystack;
+              return TRUE;
+            }
+          else if (*haystack_ptr == 0)
+            break;
+          else if (g_unichar_tolower (g_utf8_get_char (haystack_ptr))
+                   != g_unichar_tolower (g_utf8_get_char (needle_ptr)))
+            break;
+          else
+            {
+              haystack_ptr = g_utf8_next_char (haystack_ptr);
+              needle_ptr = g_utf8_next_char (needle_ptr);
+            }
+        }
+    }
+
+  return FALSE;
+}
+
+int
+mwb_ac_query_bind (sqlite3_stmt *search_stmt,
+                   const gchar  *search_text,
+                   GString      *pattern)
+{
+  sqlite3_reset (search_stmt);
+
+  g_string_assign (pattern, "%");
+  g_string_append (pattern, search_text);
+  g_string_append_c (pattern, '%');
+
+  return sqlite3_bind_text (search_stmt, 1, pattern->str, pattern->len,
+                            SQLITE_STATIC);
+}
+
+gchar *
+mwb_ac_query_get_favicon_filename (sqlite3 *dbcon, gint favicon_id)
+{
+  gchar *icon_path = NULL;
+  sqlite3_stmt *favicon_stmt = NULL;
+
+  gchar *stmt = g_strdup_printf (FAVICON_SQL, favicon_id);
+  int rc = sqlite3_prepare_v2 (dbcon,
+                               stmt,
+                               -1,
+                               &favicon_stmt, NULL);
+  g_free (stmt);
+
+  if (rc)
+    g_warning ("[netpanel] sqlite3_prepare_v2():favicon_stmt %s",
+               sqlite3_errmsg (dbcon));
+
+  if (dbcon && favicon_stmt && sqlite3_step (favicon_stmt) == SQLITE_ROW)
+    {
+      const gchar *favi_url
+        = (const gchar *)sqlite3_column_text (favicon_stmt, 0);
+
+      if (favi_url)
+        {
+          gchar *csum = g_compute_checksum_for_string (G_CHECKSUM_MD5,
+                                                       favi_url, -1);
+          gchar *favicon_filename = g_strconcat (csum, ".ico", NULL);
+          icon_path = g_build_filename (mwb_utils_get_netpanel_dir (),
+                                        "favicons",
+                                        favicon_filename,
+                                        NULL);
+          if (!g_file_test (icon_path, G_FILE_TEST_EXISTS))
+            {
+              g_free (icon_path);
+              icon_path = NULL;
+            }
+          g_free (csum);
+          g_free (favicon_filename);
+        }
+    }
+
+  sqlite3_finalize (favicon_stmt);
+
+  return icon_path;
+}
+
+gboolean
+mwb_ac_query_load_tld_scores (sqlite3    *dbcon,
+                              MwbTldTrie *tld_trie)
+{
+  sqlite3_stmt *stmt;
+
+  if (sqlite3_prepare_v2 (dbcon, MWB_AC_QUERY_TLD_SQL, -1,
+                          &stmt, NULL) != SQLITE_OK)
+    {
+      g_warning ("[netpanel] sqlite3_prepare_v2 (): %s",
+                 sqlite3_errmsg (dbcon));
+      return FALSE;
+    }
+
+  while (sqlite3_step (stmt) == SQLITE_ROW)
+    {
+      const gchar *url = (const gchar *)sqlite3_column_text (stmt, 0);
+      const gchar *tld;
+      gsize tld_len;
+
+      if (url && mwb_tld_trie_find_tld (url, &tld, &tld_len))
+        mwb_tld_trie_add_score (tld_trie, tld, tld_len,
+                                MAX (sqlite3_column_int (stmt, 1), 1));
+    }
+
+  sqlite3_finalize (stmt);
+
+  return TRUE;
+}
+
+void
+mwb_ac_query_complete_domain (MwbTldTrie *tld_trie,
+                              const gchar *search_text,
+                              gchar **completion,
+                              gchar **completion_url)
+{
+  const gchar *p;
+  gboolean has_dot = FALSE;
+  const gchar *best_tld_suggestion = mwb_tld_trie_get_best (tld_trie);
+  const gchar *best_tld;
+  gint overlap;
+
+  /* If we don't have any completions then just return the search
+     text */
+  if (best_tld_suggestion == NULL)
+    {
+      *completion = g_strdup (search_text);
+      *completion_url = g_strdup (search_text);
+      return;
+    }
+
+  /* Check if the search text contains any characters that don't look
+     like part of a domain */
+  for (p = search_text; *p; p = g_utf8_next_char (p))
+    {
+      gunichar ch = g_utf8_get_char (p);
+
+      if (ch == '.')
+        has_dot = TRUE;
+
+      if (ch == '/' || ch == ':' || ch == '?' ||
+          (!g_unichar_isalnum (g_utf8_get_char_validated (p, -1)) &&
+           *p != '-' && *p != '.'))
+        {
+          *completion = g_strdup (search_text);
+          *completion_url = g_strdup (search_text);
+          return;
+        }
+    }
+
+  /* If the search string doesn't contain a dot then just append the
+     highest scoring tld */
+  if (!has_dot)
+    {
+      *completion = g_strconcat (search_text, best_tld_suggestion, NULL);
+      *completion_url = g_strconcat ("http://", *completion, "/", NULL);
+      return;
+    }
+
+  /* Otherwise look for the string with the longest overlap */
+  best_tld = mwb_tld_trie_lookup (tld_trie, search_text, &overlap);
+  if (best_tld)
+    {
+      *completion = g_strconcat (search_text, best_tld + overlap, NULL);
+      *completion_url = g_strconcat ("http://", *completion, "/", NULL);
+    }
+  else
+    {
+      /* Otherwise we don't have a sensible suggestion */
+      *completion = g_strdup (search_text);
+      *completion_url = g_strdup (search_text);
+    }
+}
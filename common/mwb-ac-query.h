@@ -0,0 +1,70 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* The data side of MwbAcList. Nothing in here needs a stage so it can
+   be driven headless, eg. from the benchmarks in tools/ */
+
+#ifndef _MWB_AC_QUERY_H
+#define _MWB_AC_QUERY_H
+
+#include <glib.h>
+#include <sqlite3.h>
+#include "mwb-tld-trie.h"
+
+G_BEGIN_DECLS
+
+#define MWB_AC_QUERY_SQL "SELECT DISTINCT url, url||' - '||title as vl, favicon_id "\
+                         "FROM ( "\
+                               "SELECT url, title, favicon_id, 100 as visit_count "\
+                               "FROM bookmarks "\
+                               "UNION "\
+                               "SELECT url, title, favicon_id, visit_count "\
+                               "FROM urls"\
+                              ") WHERE vl like ? ORDER BY visit_count DESC"
+
+gboolean mwb_ac_query_stristr (const gchar *haystack,
+                               const gchar *needle,
+                               gint        *start_ret,
+                               gint        *end_ret);
+
+/* Builds the LIKE pattern in 'pattern' and binds it without a copy,
+   so it must be left alone until the statement is bound again */
+int mwb_ac_query_bind (sqlite3_stmt *search_stmt,
+                       const gchar  *search_text,
+                       GString      *pattern);
+
+gchar *mwb_ac_query_get_favicon_filename (sqlite3 *dbcon,
+                                          gint     favicon_id);
+
+/* The most visited URLs, used to learn which TLDs get typed most */
+#define MWB_AC_QUERY_TLD_SQL "SELECT url, visit_count FROM urls "\
+                             "WHERE hidden = 0 "\
+                             "ORDER BY visit_count DESC LIMIT 2000"
+
+/* Adds the visit count of each URL above to the score of its TLD */
+gboolean mwb_ac_query_load_tld_scores (sqlite3    *dbcon,
+                                       MwbTldTrie *tld_trie);
+
+void mwb_ac_query_complete_domain (MwbTldTrie  *tld_trie,
+                                   const gchar *search_text,
+                                   gchar      **completion,
+                                   gchar      **completion_url);
+
+G_END_DECLS
+
+#endif /* _MWB_AC_QUERY_H */
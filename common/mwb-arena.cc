@@ -0,0 +1,148 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include "mwb-arena.h"
+
+#define MWB_ARENA_ALIGN(size) (((size) + 7) & ~(gsize) 7)
+
+typedef struct _MwbArenaBlock MwbArenaBlock;
+
+struct _MwbArenaBlock
+{
+  MwbArenaBlock *next;
+  gsize          size;
+  /* followed by 'size' bytes of data */
+};
+
+#define MWB_ARENA_BLOCK_DATA(block) \
+  ((gchar *) (block) + MWB_ARENA_ALIGN (sizeof (MwbArenaBlock)))
+
+struct _MwbArena
+{
+  gsize          block_size;
+
+  /* All the blocks ever allocated, in the order they get used */
+  MwbArenaBlock *first;
+  MwbArenaBlock *last;
+
+  /* Where the next allocation comes from */
+  MwbArenaBlock *current;
+  gsize          offset;
+};
+
+static MwbArenaBlock *
+mwb_arena_block_new (gsize size)
+{
+  MwbArenaBlock *block = (MwbArenaBlock *)
+    g_malloc (MWB_ARENA_ALIGN (sizeof (MwbArenaBlock)) + size);
+
+  block->next = NULL;
+  block->size = size;
+
+  return block;
+}
+
+MwbArena *
+mwb_arena_new (gsize block_size)
+{
+  MwbArena *arena = g_slice_new (MwbArena);
+
+  arena->block_size = MWB_ARENA_ALIGN (block_size);
+  arena->first = arena->last = arena->current
+    = mwb_arena_block_new (arena->block_size);
+  arena->offset = 0;
+
+  return arena;
+}
+
+void
+mwb_arena_free (MwbArena *arena)
+{
+  MwbArenaBlock *block, *next;
+
+  for (block = arena->first; block; block = next)
+    {
+      next = block->next;
+      g_free (block);
+    }
+
+  g_slice_free (MwbArena, arena);
+}
+
+void
+mwb_arena_reset (MwbArena *arena)
+{
+  arena->current = arena->first;
+  arena->offset = 0;
+}
+
+gpointer
+mwb_arena_alloc (MwbArena *arena,
+                 gsize     size)
+{
+  gpointer mem;
+
+  size = MWB_ARENA_ALIGN (size);
+
+  /* Move on to the next block that fits, the rest of this one is
+     wasted until the next reset */
+  while (arena->offset + size > arena->current->size)
+    {
+      if (!arena->current->next)
+        {
+          MwbArenaBlock *block
+            = mwb_arena_block_new (MAX (arena->block_size, size));
+
+          arena->last->next = block;
+          arena->last = block;
+        }
+
+      arena->current = arena->current->next;
+      arena->offset = 0;
+    }
+
+  mem = MWB_ARENA_BLOCK_DATA (arena->current) + arena->offset;
+  arena->offset += size;
+
+  return mem;
+}
+
+gchar *
+mwb_arena_strndup (MwbArena    *arena,
+                   const gchar *str,
+                   gsize        len)
+{
+  gchar *copy = (gchar *) mwb_arena_alloc (arena, len + 1);
+
+  memcpy (copy, str, len);
+  copy[len] = '\0';
+
+  return copy;
+}
+
+gchar *
+mwb_arena_strdup (MwbArena    *arena,
+                  const gchar *str)
+{
+  return mwb_arena_strndup (arena, str, strlen (str));
+}
@@ -0,0 +1,51 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* A bump allocator for data that all dies at the same time, eg. the
+   strings of one set of autocomplete results. Allocating is a pointer
+   increment and mwb_arena_reset() just rewinds to the first block, so
+   the blocks are reused and nothing is freed until mwb_arena_free().
+   Individual allocations can't be freed. */
+
+#ifndef _MWB_ARENA_H
+#define _MWB_ARENA_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _MwbArena MwbArena;
+
+MwbArena *mwb_arena_new   (gsize     block_size);
+void      mwb_arena_free  (MwbArena *arena);
+
+/* Forgets every allocation, all of them become invalid */
+void      mwb_arena_reset (MwbArena *arena);
+
+/* Aligned for any basic type, never returns NULL */
+gpointer  mwb_arena_alloc   (MwbArena    *arena,
+                             gsize        size);
+gchar    *mwb_arena_strdup  (MwbArena    *arena,
+                             const gchar *str);
+gchar    *mwb_arena_strndup (MwbArena    *arena,
+                             const gchar *str,
+                             gsize        len);
+
+G_END_DECLS
+
+#endif /* _MWB_ARENA_H */
@@ -0,0 +1,177 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <mx/mx.h>
+#include "mwb-assets.h"
+#include "mwb-texture-budget.h"
+
+static gchar *assets_dir = NULL;
+
+/* Names of the images counted against the texture budget. Each one is
+   pinned and counted once however many actors show it. */
+static GHashTable *accounted = NULL;
+
+static gboolean
+mwb_assets_load_atlas (const gchar *filename)
+{
+  MxTextureCache *cache = mx_texture_cache_get_default ();
+  const MwbAssetsHeader *header;
+  const MwbAssetsEntry *entries;
+  const guchar *data;
+  GMappedFile *mapped;
+  GError *error = NULL;
+  CoglHandle atlas;
+  guint64 needed;
+  gsize len;
+  guint i;
+
+  mapped = g_mapped_file_new (filename, FALSE, &error);
+  if (!mapped)
+    {
+      /* Only built with --enable-cache */
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_warning ("[netpanel] %s", error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  data = (const guchar *) g_mapped_file_get_contents (mapped);
+  len = g_mapped_file_get_length (mapped);
+  header = (const MwbAssetsHeader *) data;
+
+  if (len < sizeof (MwbAssetsHeader) ||
+      memcmp (header->magic, MWB_ASSETS_MAGIC, sizeof (header->magic)) ||
+      header->version != MWB_ASSETS_VERSION)
+    {
+      g_warning ("[netpanel] %s is not a version %d asset atlas",
+                 filename, MWB_ASSETS_VERSION);
+      g_mapped_file_unref (mapped);
+      return FALSE;
+    }
+
+  needed = sizeof (MwbAssetsHeader)
+    + (guint64) header->n_entries * sizeof (MwbAssetsEntry)
+    + (guint64) header->width * header->height * 4;
+  if (len < needed)
+    {
+      g_warning ("[netpanel] %s is truncated", filename);
+      g_mapped_file_unref (mapped);
+      return FALSE;
+    }
+
+  entries = (const MwbAssetsEntry *) (data + sizeof (MwbAssetsHeader));
+  atlas = cogl_texture_new_from_data (header->width, header->height,
+                                      COGL_TEXTURE_NO_AUTO_MIPMAP,
+                                      COGL_PIXEL_FORMAT_RGBA_8888,
+                                      COGL_PIXEL_FORMAT_ANY,
+                                      header->width * 4,
+                                      (const guint8 *)
+                                      (entries + header->n_entries));
+  if (atlas == COGL_INVALID_HANDLE)
+    {
+      g_warning ("[netpanel] unable to upload %s", filename);
+      g_mapped_file_unref (mapped);
+      return FALSE;
+    }
+
+  for (i = 0; i < header->n_entries; i++)
+    {
+      const MwbAssetsEntry *entry = entries + i;
+      CoglHandle texture;
+      gchar *name, *path;
+
+      if ((guint64) entry->x + entry->width > header->width ||
+          (guint64) entry->y + entry->height > header->height ||
+          !entry->width || !entry->height)
+        continue;
+
+      name = g_strndup (entry->name, sizeof (entry->name));
+      path = g_build_filename (assets_dir, name, NULL);
+
+      /* The sub-texture keeps the atlas alive. Mx declares the texture
+         argument as a CoglHandle pointer but takes the handle itself. */
+      texture = cogl_texture_new_from_sub_texture (atlas,
+                                                   entry->x, entry->y,
+                                                   entry->width,
+                                                   entry->height);
+      mx_texture_cache_insert (cache, path, (CoglHandle *) texture);
+      cogl_handle_unref (texture);
+
+      g_hash_table_insert (accounted, name, NULL);
+      g_free (path);
+    }
+
+  mwb_texture_budget_add ((gsize) header->width * header->height * 4,
+                          TRUE, NULL, NULL, NULL);
+
+  cogl_handle_unref (atlas);
+  g_mapped_file_unref (mapped);
+
+  return TRUE;
+}
+
+gboolean
+mwb_assets_init (const gchar *theme_dir)
+{
+  gchar *filename;
+  gboolean loaded;
+
+  g_return_val_if_fail (assets_dir == NULL, FALSE);
+
+  assets_dir = g_strdup (theme_dir);
+  accounted = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  filename = g_build_filename (assets_dir, MWB_ASSETS_FILENAME, NULL);
+  loaded = mwb_assets_load_atlas (filename);
+  g_free (filename);
+
+  return loaded;
+}
+
+CoglHandle
+mwb_assets_get_texture (const gchar *name)
+{
+  CoglHandle texture;
+  gchar *path;
+
+  if (!assets_dir)
+    mwb_assets_init (PKGDATADIR "/netpanel");
+
+  /* Comes from the atlas if it was loaded, otherwise Mx decodes the
+     file on the first call and keeps it for the rest */
+  path = g_build_filename (assets_dir, name, NULL);
+  texture = mx_texture_cache_get_cogl_texture (mx_texture_cache_get_default (),
+                                               path);
+  if (texture == COGL_INVALID_HANDLE)
+    g_warning ("[netpanel] unable to open %s", path);
+  else if (!g_hash_table_lookup_extended (accounted, name, NULL, NULL))
+    {
+      mwb_texture_budget_add (cogl_texture_get_width (texture)
+                              * cogl_texture_get_height (texture) * 4,
+                              TRUE, NULL, NULL, NULL);
+      g_hash_table_insert (accounted, g_strdup (name), NULL);
+    }
+  g_free (path);
+
+  return texture;
+}
@@ -0,0 +1,75 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Theme images shared by the whole process. Each image is decoded and
+   uploaded once and then handed out to every tile and row that shows
+   it.
+
+   With --enable-cache the build packs all the theme images into
+   'assets.atlas' in the theme directory, see tools/mwb-pack-assets.cc.
+   The atlas is already decoded so loading it is a single upload, and
+   every image in it is put in the Mx texture cache so images named in
+   the stylesheet come from it too. Without the atlas each image is
+   decoded from its own file the first time it is asked for. */
+
+#ifndef _MWB_ASSETS_H
+#define _MWB_ASSETS_H
+
+#include <glib.h>
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+
+#define MWB_ASSETS_FILENAME  "assets.atlas"
+#define MWB_ASSETS_MAGIC     "MWBA"
+#define MWB_ASSETS_VERSION   1
+#define MWB_ASSETS_NAME_SIZE 64
+
+/* The atlas file is this header, n_entries entries and then
+   width * height unpremultiplied RGBA pixels with no row padding, all
+   in host byte order */
+typedef struct
+{
+  gchar   magic[4];
+  guint32 version;
+  guint32 width;
+  guint32 height;
+  guint32 n_entries;
+} MwbAssetsHeader;
+
+typedef struct
+{
+  gchar   name[MWB_ASSETS_NAME_SIZE];
+  guint32 x;
+  guint32 y;
+  guint32 width;
+  guint32 height;
+} MwbAssetsEntry;
+
+/* Sets the directory images are looked up in and loads its atlas if
+   there is one. Returns whether the atlas was loaded. Without a call
+   the images come from the installed netpanel theme. */
+gboolean   mwb_assets_init        (const gchar *theme_dir);
+
+/* Returns a new reference to the texture for a theme image, eg.
+   "o2_globe.png", or COGL_INVALID_HANDLE if it can't be loaded */
+CoglHandle mwb_assets_get_texture (const gchar *name);
+
+G_END_DECLS
+
+#endif /* _MWB_ASSETS_H */
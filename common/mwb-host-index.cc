@@ -0,0 +1,245 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+#include "mwb-host-index.h"
+
+/* Bounds the build time and memory on huge histories, anything
+   further down is unlikely to be the best completion */
+#define MWB_HOST_INDEX_SQL "SELECT url, visit_count FROM urls "\
+                           "WHERE hidden = 0 "\
+                           "ORDER BY visit_count DESC LIMIT 20000"
+
+typedef struct
+{
+  const gchar *key;
+  gint         score;
+} MwbHostIndexEntry;
+
+struct _MwbHostIndex
+{
+  GStringChunk      *keys;
+
+  /* Sorted by key */
+  MwbHostIndexEntry *entries;
+  guint              n_entries;
+
+  /* Bottom-up segment tree over the entries, each node is the index of
+     the best entry below it. The leaves start at n_entries. */
+  guint             *tree;
+};
+
+/* Skips the parts of a URL that keys don't have. Returns NULL for
+   schemes that shouldn't be completed, eg. file:// */
+static const gchar *
+mwb_host_index_strip (const gchar *url)
+{
+  if (!g_ascii_strncasecmp (url, "http://", 7))
+    url += 7;
+  else if (!g_ascii_strncasecmp (url, "https://", 8))
+    url += 8;
+  else if (strstr (url, "://"))
+    return NULL;
+
+  if (!g_ascii_strncasecmp (url, "www.", 4))
+    url += 4;
+
+  return url;
+}
+
+static void
+mwb_host_index_add (GHashTable  *lookup,
+                    GArray      *entries,
+                    GStringChunk *keys,
+                    const gchar *key,
+                    gsize        key_len,
+                    gint         score)
+{
+  gchar *lower = g_ascii_strdown (key, key_len);
+  gpointer index;
+
+  if (g_hash_table_lookup_extended (lookup, lower, NULL, &index))
+    g_array_index (entries, MwbHostIndexEntry,
+                   GPOINTER_TO_UINT (index)).score += score;
+  else
+    {
+      MwbHostIndexEntry entry;
+
+      entry.key = g_string_chunk_insert (keys, lower);
+      entry.score = score;
+      g_hash_table_insert (lookup, (gpointer) entry.key,
+                           GUINT_TO_POINTER (entries->len));
+      g_array_append_val (entries, entry);
+    }
+
+  g_free (lower);
+}
+
+static gint
+mwb_host_index_compare (gconstpointer a, gconstpointer b)
+{
+  return strcmp (((const MwbHostIndexEntry *) a)->key,
+                 ((const MwbHostIndexEntry *) b)->key);
+}
+
+/* Higher score wins, then the earlier key so that a host comes before
+   the URLs on it */
+static guint
+mwb_host_index_better (MwbHostIndex *index, guint a, guint b)
+{
+  if (a == G_MAXUINT)
+    return b;
+  if (b == G_MAXUINT)
+    return a;
+  if (index->entries[a].score != index->entries[b].score)
+    return index->entries[a].score > index->entries[b].score ? a : b;
+  return MIN (a, b);
+}
+
+MwbHostIndex *
+mwb_host_index_new_from_db (sqlite3 *dbcon)
+{
+  MwbHostIndex *index;
+  sqlite3_stmt *stmt;
+  GHashTable *lookup;
+  GArray *entries;
+  guint i;
+
+  if (sqlite3_prepare_v2 (dbcon, MWB_HOST_INDEX_SQL, -1,
+                          &stmt, NULL) != SQLITE_OK)
+    {
+      g_warning ("[netpanel] sqlite3_prepare_v2 (): %s",
+                 sqlite3_errmsg (dbcon));
+      return NULL;
+    }
+
+  index = g_slice_new0 (MwbHostIndex);
+  index->keys = g_string_chunk_new (4096);
+  lookup = g_hash_table_new (g_str_hash, g_str_equal);
+  entries = g_array_new (FALSE, FALSE, sizeof (MwbHostIndexEntry));
+
+  while (sqlite3_step (stmt) == SQLITE_ROW)
+    {
+      const gchar *url = (const gchar *) sqlite3_column_text (stmt, 0);
+      gint visits = MAX (sqlite3_column_int (stmt, 1), 1);
+      const gchar *key, *slash;
+      gchar *host;
+
+      if (!url || !(key = mwb_host_index_strip (url)) || !*key)
+        continue;
+
+      mwb_host_index_add (lookup, entries, index->keys,
+                          key, strlen (key), visits);
+
+      /* Hosts are always completed with the trailing slash */
+      slash = strchr (key, '/');
+      host = slash ? g_strndup (key, slash - key + 1)
+        : g_strconcat (key, "/", NULL);
+      mwb_host_index_add (lookup, entries, index->keys,
+                          host, strlen (host), visits);
+      g_free (host);
+    }
+
+  sqlite3_finalize (stmt);
+  g_hash_table_destroy (lookup);
+
+  g_array_sort (entries, mwb_host_index_compare);
+  index->n_entries = entries->len;
+  index->entries = (MwbHostIndexEntry *) g_array_free (entries, FALSE);
+
+  index->tree = g_new (guint, MAX (index->n_entries, 1) * 2);
+  for (i = 0; i < index->n_entries; i++)
+    index->tree[index->n_entries + i] = i;
+  for (i = index->n_entries - 1; i > 0 && i < index->n_entries; i--)
+    index->tree[i] = mwb_host_index_better (index,
+                                            index->tree[i * 2],
+                                            index->tree[i * 2 + 1]);
+
+  return index;
+}
+
+void
+mwb_host_index_free (MwbHostIndex *index)
+{
+  g_string_chunk_free (index->keys);
+  g_free (index->entries);
+  g_free (index->tree);
+  g_slice_free (MwbHostIndex, index);
+}
+
+/* First entry whose key compares greater than 'prefix' over its
+   length, or greater or equal if 'or_equal' */
+static guint
+mwb_host_index_bound (MwbHostIndex *index,
+                      const gchar  *prefix,
+                      gsize         prefix_len,
+                      gboolean      or_equal)
+{
+  guint lo = 0, hi = index->n_entries;
+
+  while (lo < hi)
+    {
+      guint mid = lo + (hi - lo) / 2;
+      gint cmp = g_ascii_strncasecmp (index->entries[mid].key,
+                                      prefix, prefix_len);
+
+      if (cmp < 0 || (cmp == 0 && !or_equal))
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+const gchar *
+mwb_host_index_complete (MwbHostIndex *index,
+                         const gchar  *text)
+{
+  const gchar *prefix = mwb_host_index_strip (text);
+  gsize prefix_len;
+  guint lo, hi, best = G_MAXUINT;
+
+  if (!prefix || !*prefix || strchr (prefix, ' '))
+    return NULL;
+  prefix_len = strlen (prefix);
+
+  lo = mwb_host_index_bound (index, prefix, prefix_len, TRUE);
+  hi = mwb_host_index_bound (index, prefix, prefix_len, FALSE);
+
+  /* Best entry in [lo, hi) */
+  for (lo += index->n_entries, hi += index->n_entries;
+       lo < hi;
+       lo /= 2, hi /= 2)
+    {
+      if (lo & 1)
+        best = mwb_host_index_better (index, best, index->tree[lo++]);
+      if (hi & 1)
+        best = mwb_host_index_better (index, best, index->tree[--hi]);
+    }
+
+  if (best == G_MAXUINT || !index->entries[best].key[prefix_len])
+    return NULL;
+
+  return index->entries[best].key + prefix_len;
+}
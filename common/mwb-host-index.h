@@ -0,0 +1,51 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* In-memory index of visited hosts and URLs for inline completion.
+   Keys are lowercased with the http:// or https:// scheme and any
+   leading "www." stripped, eg. "example.com/" for a host and
+   "example.com/news/" for a URL, and scored by visit count. A host
+   scores the sum of its URLs so it wins over any one of them.
+
+   Building reads the database so should be done off the main thread,
+   looking up never touches it. */
+
+#ifndef _MWB_HOST_INDEX_H
+#define _MWB_HOST_INDEX_H
+
+#include <glib.h>
+#include <sqlite3.h>
+
+G_BEGIN_DECLS
+
+typedef struct _MwbHostIndex MwbHostIndex;
+
+MwbHostIndex *mwb_host_index_new_from_db (sqlite3 *dbcon);
+void          mwb_host_index_free        (MwbHostIndex *index);
+
+/* Returns the text to append to 'text' to complete it to the highest
+   scoring key it is a prefix of, or NULL if there is none or 'text'
+   is a whole key already. 'text' is matched the same way keys are
+   made so "http://www.exa" completes with "mple.com/". The result
+   belongs to the index. */
+const gchar  *mwb_host_index_complete    (MwbHostIndex *index,
+                                          const gchar  *text);
+
+G_END_DECLS
+
+#endif /* _MWB_HOST_INDEX_H */
@@ -0,0 +1,127 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "mwb-lifecycle.h"
+
+typedef struct
+{
+  guint            id;
+  MwbLifecycleFunc suspend_func;
+  MwbLifecycleFunc resume_func;
+  gpointer         user_data;
+} MwbLifecycleClient;
+
+/* In registration order, suspended in reverse */
+static GList *mwb_lifecycle_clients = NULL;
+static guint mwb_lifecycle_next_id = 1;
+static gboolean mwb_lifecycle_suspended = FALSE;
+
+guint
+mwb_lifecycle_add (MwbLifecycleFunc suspend_func,
+                   MwbLifecycleFunc resume_func,
+                   gpointer         user_data)
+{
+  MwbLifecycleClient *client = g_slice_new (MwbLifecycleClient);
+
+  client->id = mwb_lifecycle_next_id++;
+  client->suspend_func = suspend_func;
+  client->resume_func = resume_func;
+  client->user_data = user_data;
+
+  mwb_lifecycle_clients = g_list_append (mwb_lifecycle_clients, client);
+
+  return client->id;
+}
+
+void
+mwb_lifecycle_remove (guint id)
+{
+  GList *l;
+
+  for (l = mwb_lifecycle_clients; l; l = l->next)
+    {
+      MwbLifecycleClient *client = (MwbLifecycleClient *) l->data;
+
+      if (client->id == id)
+        {
+          mwb_lifecycle_clients = g_list_delete_link (mwb_lifecycle_clients,
+                                                      l);
+          g_slice_free (MwbLifecycleClient, client);
+          return;
+        }
+    }
+}
+
+void
+mwb_lifecycle_suspend (void)
+{
+  GList *l;
+
+  if (mwb_lifecycle_suspended)
+    return;
+
+  mwb_lifecycle_suspended = TRUE;
+
+  for (l = g_list_last (mwb_lifecycle_clients); l; l = l->prev)
+    {
+      MwbLifecycleClient *client = (MwbLifecycleClient *) l->data;
+
+      if (client->suspend_func)
+        client->suspend_func (client->user_data);
+    }
+}
+
+void
+mwb_lifecycle_resume (void)
+{
+  GList *l;
+
+  if (!mwb_lifecycle_suspended)
+    return;
+
+  mwb_lifecycle_suspended = FALSE;
+
+  for (l = mwb_lifecycle_clients; l; l = l->next)
+    {
+      MwbLifecycleClient *client = (MwbLifecycleClient *) l->data;
+
+      if (client->resume_func)
+        client->resume_func (client->user_data);
+    }
+}
+
+gboolean
+mwb_lifecycle_is_suspended (void)
+{
+  return mwb_lifecycle_suspended;
+}
+
+void
+mwb_lifecycle_finish_timeline (ClutterTimeline *timeline)
+{
+  /* Not is_playing(), that is still FALSE during the delay */
+  if (!timeline)
+    return;
+
+  clutter_timeline_stop (timeline);
+  g_signal_emit_by_name (timeline, "completed");
+}
@@ -0,0 +1,56 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Keeps a hidden panel from waking up. Anything owning a timeout, an
+   idle or a timeline registers a suspend function, called when the
+   panel has finished hiding, that cancels or pauses them and a resume
+   function called when it is shown again. Nothing is expected to
+   schedule new work while suspended, check mwb_lifecycle_is_suspended()
+   before starting an animation from a signal handler. */
+
+#ifndef _MWB_LIFECYCLE_H
+#define _MWB_LIFECYCLE_H
+
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+
+typedef void (* MwbLifecycleFunc) (gpointer user_data);
+
+/* Either function may be NULL. Returns an id for mwb_lifecycle_remove(). */
+guint mwb_lifecycle_add    (MwbLifecycleFunc suspend_func,
+                            MwbLifecycleFunc resume_func,
+                            gpointer         user_data);
+void  mwb_lifecycle_remove (guint            id);
+
+/* Called by the panel on hide-end and show-begin */
+void  mwb_lifecycle_suspend (void);
+void  mwb_lifecycle_resume  (void);
+
+gboolean mwb_lifecycle_is_suspended (void);
+
+/* Jumps a started transition to its end by stopping it and emitting
+   "completed", so the owner settles in the final state instead of
+   the timeline ticking on while nobody can see it. Only for timelines
+   the owner drops when they complete, so any it still has are known
+   to be running. */
+void mwb_lifecycle_finish_timeline (ClutterTimeline *timeline);
+
+G_END_DECLS
+
+#endif /* _MWB_LIFECYCLE_H */
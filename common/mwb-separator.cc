@@ -41,6 +41,9 @@ struct _MwbSeparatorPrivate
   gfloat line_width;
   gfloat on_width, off_width;
   ClutterColor color;
+
+  /* Reused by paint for the rectangles of the line */
+  GArray *rectangles;
 };
 
 enum
@@ -118,43 +121,45 @@ mwb_separator_set_property (GObject *object, guint property_id,
 }
 
 static void
-mwb_separator_paint (ClutterActor *actor)
+mwb_separator_add_rectangle (GArray *rectangles,
+                             gfloat  x1,
+                             gfloat  y1,
+                             gfloat  x2,
+                             gfloat  y2)
+{
+  gfloat coords[4] = { x1, y1, x2, y2 };
+
+  g_array_append_vals (rectangles, coords, 4);
+}
+
+void
+mwb_separator_add_rectangles (MwbSeparator *separator,
+                              gfloat        y_offset,
+                              GArray       *rectangles)
 {
-  MwbSeparator *separator = MWB_SEPARATOR (actor);
   MwbSeparatorPrivate *priv = separator->priv;
   ClutterGeometry geom;
   MxPadding padding;
-  guint8 tmp_alpha;
   gfloat ypos;
 
-  /* compute the composited opacity of the actor taking into account
-   * the opacity of the color set by the user
-   */
-  tmp_alpha = (clutter_actor_get_paint_opacity (actor)
-               * priv->color.alpha
-               / 255);
-
-  cogl_set_source_color4ub (priv->color.red,
-                            priv->color.green,
-                            priv->color.blue,
-                            tmp_alpha);
-
-  clutter_actor_get_allocation_geometry (actor, &geom);
+  clutter_actor_get_allocation_geometry (CLUTTER_ACTOR (separator), &geom);
 
-  mx_widget_get_padding (MX_WIDGET (actor), &padding);
+  mx_widget_get_padding (MX_WIDGET (separator), &padding);
 
   /* Center the line in the allocated height */
   ypos = ((geom.height - padding.top - padding.bottom) / 2.0f
           - priv->line_width / 2.0f
-          + padding.top);
+          + padding.top
+          + y_offset);
 
   /* If the widths don't progress forward then just draw a solid line
      instead */
   if (priv->on_width + priv->off_width <= 1e-8f)
-    cogl_rectangle (padding.left,
-                    ypos,
-                    geom.width - padding.right,
-                    ypos + priv->line_width);
+    mwb_separator_add_rectangle (rectangles,
+                                 padding.left,
+                                 ypos,
+                                 geom.width - padding.right,
+                                 ypos + priv->line_width);
   else
     {
       gfloat xpos = padding.left;
@@ -169,14 +174,18 @@ mwb_separator_paint (ClutterActor *actor)
             {
               /* Draw to the end and stop */
               if (on_off)
-                cogl_rectangle (xpos, ypos, geom.width - padding.right,
-                                ypos + priv->line_width);
+                mwb_separator_add_rectangle (rectangles,
+                                             xpos, ypos,
+                                             geom.width - padding.right,
+                                             ypos + priv->line_width);
               break;
             }
 
           if (on_off)
-            cogl_rectangle (xpos, ypos,
-                            xpos + part_width, ypos + priv->line_width);
+            mwb_separator_add_rectangle (rectangles,
+                                         xpos, ypos,
+                                         xpos + part_width,
+                                         ypos + priv->line_width);
 
           xpos += part_width;
           on_off = !on_off;
@@ -184,6 +193,48 @@ mwb_separator_paint (ClutterActor *actor)
     }
 }
 
+void
+mwb_separator_set_source (MwbSeparator *separator)
+{
+  MwbSeparatorPrivate *priv = separator->priv;
+  guint8 tmp_alpha;
+
+  /* compute the composited opacity of the actor taking into account
+   * the opacity of the color set by the user
+   */
+  tmp_alpha = (clutter_actor_get_paint_opacity (CLUTTER_ACTOR (separator))
+               * priv->color.alpha
+               / 255);
+
+  cogl_set_source_color4ub (priv->color.red,
+                            priv->color.green,
+                            priv->color.blue,
+                            tmp_alpha);
+}
+
+static void
+mwb_separator_paint (ClutterActor *actor)
+{
+  MwbSeparator *separator = MWB_SEPARATOR (actor);
+  GArray *rectangles = separator->priv->rectangles;
+
+  g_array_set_size (rectangles, 0);
+  mwb_separator_add_rectangles (separator, 0.0f, rectangles);
+
+  mwb_separator_set_source (separator);
+  cogl_rectangles ((gfloat *) rectangles->data, rectangles->len / 4);
+}
+
+static void
+mwb_separator_finalize (GObject *object)
+{
+  MwbSeparatorPrivate *priv = MWB_SEPARATOR (object)->priv;
+
+  g_array_free (priv->rectangles, TRUE);
+
+  G_OBJECT_CLASS (mwb_separator_parent_class)->finalize (object);
+}
+
 static void
 mwb_separator_get_preferred_height (ClutterActor *self,
                                     gfloat        for_width,
@@ -287,6 +338,7 @@ mwb_separator_class_init (MwbSeparatorClass *klass)
 
   object_class->get_property = mwb_separator_get_property;
   object_class->set_property = mwb_separator_set_property;
+  object_class->finalize = mwb_separator_finalize;
   actor_class->paint = mwb_separator_paint;
   actor_class->get_preferred_height = mwb_separator_get_preferred_height;
 
@@ -342,6 +394,7 @@ mwb_separator_init (MwbSeparator *self)
 
   priv->color = default_color;
   priv->line_width = 1.0f;
+  priv->rectangles = g_array_new (FALSE, FALSE, sizeof (gfloat));
 
   g_signal_connect (self, "style-changed",
                     G_CALLBACK (mwb_separator_style_changed_cb), NULL);
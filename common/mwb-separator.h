@@ -84,6 +84,17 @@ gfloat mwb_separator_get_on_width (MwbSeparator *separator);
 void mwb_separator_set_on_width (MwbSeparator *separator,
                                  gfloat value);
 
+/* Appends the line as rectangles of four floats, x1, y1, x2 and y2, in
+   the separator's own coordinates moved down by 'y_offset'. This lets
+   a container that draws the same separator several times collect all
+   of them and draw them with a single cogl_rectangles(). */
+void mwb_separator_add_rectangles (MwbSeparator *separator,
+                                   gfloat        y_offset,
+                                   GArray       *rectangles);
+
+/* Sets the Cogl source to the line color at the paint opacity */
+void mwb_separator_set_source (MwbSeparator *separator);
+
 G_END_DECLS
 
 #endif /* _MWB_SEPARATOR_H */
@@ -0,0 +1,410 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+#include "mwb-session-file.h"
+
+/* The file starts with "SNSS" and a version number. Each command after
+   that is a 16-bit size, which counts the id byte, an 8-bit id and the
+   payload, all in host byte order. */
+#define MWB_SESSION_FILE_HEADER_SIZE 8
+#define MWB_SESSION_FILE_VERSION 1
+
+#define MWB_SESSION_COMMAND_TAB_CLOSED 3
+#define MWB_SESSION_COMMAND_UPDATE_TAB_NAVIGATION 6
+
+/* Enough of the end of the parsed part to notice the file was
+   rewritten rather than appended to */
+#define MWB_SESSION_FILE_TAIL_SIZE 32
+
+typedef enum
+{
+  MWB_SESSION_TAB_EMPTY = 0,
+  MWB_SESSION_TAB_USED,
+  MWB_SESSION_TAB_DELETED
+} MwbSessionTabState;
+
+typedef struct
+{
+  MwbSessionTabState state;
+  gint               tab_id;
+  gint               navigation_index;
+  gchar             *url;
+  gchar             *title;
+} MwbSessionTab;
+
+struct _MwbSessionFile
+{
+  gchar         *filename;
+
+  /* Open addressing with linear probing, the size is a power of two.
+     'n_filled' counts deleted slots too as they still end probes. */
+  MwbSessionTab *tabs;
+  guint          size;
+  guint          n_tabs;
+  guint          n_filled;
+
+  gsize          offset;
+  guchar         tail[MWB_SESSION_FILE_TAIL_SIZE];
+  gsize          tail_len;
+
+  /* Titles are UTF-16 at unaligned offsets so get copied here first */
+  GArray        *utf16;
+};
+
+typedef struct
+{
+  const guchar *p;
+  const guchar *end;
+} MwbSessionPickle;
+
+MwbSessionFile *
+mwb_session_file_new (const gchar *filename)
+{
+  MwbSessionFile *session = g_slice_new0 (MwbSessionFile);
+
+  session->filename = g_strdup (filename);
+  session->utf16 = g_array_new (FALSE, FALSE, sizeof (gunichar2));
+
+  return session;
+}
+
+static void
+mwb_session_file_clear (MwbSessionFile *session)
+{
+  guint i;
+
+  for (i = 0; i < session->size; i++)
+    if (session->tabs[i].state == MWB_SESSION_TAB_USED)
+      {
+        g_free (session->tabs[i].url);
+        g_free (session->tabs[i].title);
+      }
+  g_free (session->tabs);
+
+  session->tabs = NULL;
+  session->size = 0;
+  session->n_tabs = 0;
+  session->n_filled = 0;
+  session->offset = 0;
+  session->tail_len = 0;
+}
+
+void
+mwb_session_file_free (MwbSessionFile *session)
+{
+  mwb_session_file_clear (session);
+  g_array_free (session->utf16, TRUE);
+  g_free (session->filename);
+  g_slice_free (MwbSessionFile, session);
+}
+
+guint
+mwb_session_file_get_n_tabs (MwbSessionFile *session)
+{
+  return session->n_tabs;
+}
+
+/* Returns the slot holding 'tab_id' or, if it isn't there, the slot to
+   put it in */
+static MwbSessionTab *
+mwb_session_file_lookup (MwbSessionFile *session, gint tab_id)
+{
+  MwbSessionTab *free_slot = NULL;
+  guint i = ((guint) tab_id * 2654435761u) & (session->size - 1);
+
+  while (TRUE)
+    {
+      MwbSessionTab *tab = session->tabs + i;
+
+      if (tab->state == MWB_SESSION_TAB_EMPTY)
+        return free_slot ? free_slot : tab;
+      if (tab->state == MWB_SESSION_TAB_DELETED)
+        {
+          if (!free_slot)
+            free_slot = tab;
+        }
+      else if (tab->tab_id == tab_id)
+        return tab;
+
+      i = (i + 1) & (session->size - 1);
+    }
+}
+
+static void
+mwb_session_file_grow (MwbSessionFile *session)
+{
+  MwbSessionTab *old_tabs = session->tabs;
+  guint old_size = session->size, i;
+
+  /* Rehashing drops the deleted slots, so this may not grow at all */
+  session->size = 16;
+  while (session->size < session->n_tabs * 4)
+    session->size *= 2;
+  session->tabs = g_new0 (MwbSessionTab, session->size);
+  session->n_filled = session->n_tabs;
+
+  for (i = 0; i < old_size; i++)
+    if (old_tabs[i].state == MWB_SESSION_TAB_USED)
+      *mwb_session_file_lookup (session, old_tabs[i].tab_id) = old_tabs[i];
+
+  g_free (old_tabs);
+}
+
+static void
+mwb_session_file_set_tab (MwbSessionFile *session,
+                          gint            tab_id,
+                          gint            navigation_index,
+                          gchar          *url,
+                          gchar          *title)
+{
+  MwbSessionTab *tab;
+
+  if ((session->n_filled + 1) * 4 > session->size * 3)
+    mwb_session_file_grow (session);
+
+  tab = mwb_session_file_lookup (session, tab_id);
+  if (tab->state == MWB_SESSION_TAB_USED)
+    {
+      g_free (tab->url);
+      g_free (tab->title);
+    }
+  else
+    {
+      if (tab->state == MWB_SESSION_TAB_EMPTY)
+        session->n_filled++;
+      session->n_tabs++;
+      tab->state = MWB_SESSION_TAB_USED;
+      tab->tab_id = tab_id;
+    }
+
+  tab->navigation_index = navigation_index;
+  tab->url = url;
+  tab->title = title;
+}
+
+static void
+mwb_session_file_remove_tab (MwbSessionFile *session, gint tab_id)
+{
+  MwbSessionTab *tab;
+
+  if (!session->n_tabs)
+    return;
+
+  tab = mwb_session_file_lookup (session, tab_id);
+  if (tab->state != MWB_SESSION_TAB_USED)
+    return;
+
+  g_free (tab->url);
+  g_free (tab->title);
+  tab->url = tab->title = NULL;
+  tab->state = MWB_SESSION_TAB_DELETED;
+  session->n_tabs--;
+}
+
+static gboolean
+mwb_session_pickle_read_int (MwbSessionPickle *pickle, gint32 *value)
+{
+  if (pickle->end - pickle->p < 4)
+    return FALSE;
+
+  memcpy (value, pickle->p, 4);
+  pickle->p += 4;
+
+  return TRUE;
+}
+
+/* Fields are padded to four bytes */
+static const guchar *
+mwb_session_pickle_read_bytes (MwbSessionPickle *pickle, gsize len)
+{
+  const guchar *data = pickle->p;
+  gsize remaining = pickle->end - pickle->p;
+  gsize padded;
+
+  /* Checked before padding so a huge length can't wrap round */
+  if (len > remaining)
+    return NULL;
+
+  padded = (len + 3) & ~(gsize) 3;
+  if (remaining < padded)
+    return NULL;
+  pickle->p += padded;
+
+  return data;
+}
+
+static void
+mwb_session_file_update_tab_navigation (MwbSessionFile *session,
+                                        const guchar   *payload,
+                                        gsize           payload_len)
+{
+  MwbSessionPickle pickle;
+  gint32 pickle_len, tab_id, navigation_index, url_len, title_len;
+  const guchar *url, *title;
+  gchar *title_utf8;
+
+  pickle.p = payload;
+  pickle.end = payload + payload_len;
+  if (!mwb_session_pickle_read_int (&pickle, &pickle_len) ||
+      pickle_len < 0 || (gsize) pickle_len > payload_len - 4)
+    return;
+  pickle.end = pickle.p + pickle_len;
+
+  if (!mwb_session_pickle_read_int (&pickle, &tab_id) ||
+      !mwb_session_pickle_read_int (&pickle, &navigation_index) ||
+      !mwb_session_pickle_read_int (&pickle, &url_len) || url_len < 0 ||
+      (gsize) url_len > (gsize) (pickle.end - pickle.p) ||
+      !(url = mwb_session_pickle_read_bytes (&pickle, (gsize) url_len)) ||
+      !mwb_session_pickle_read_int (&pickle, &title_len) || title_len < 0 ||
+      (gsize) title_len > (gsize) (pickle.end - pickle.p) / 2 ||
+      !(title = mwb_session_pickle_read_bytes (&pickle,
+                                               (gsize) title_len * 2)))
+    return;
+
+  g_array_set_size (session->utf16, title_len);
+  memcpy (session->utf16->data, title, (gsize) title_len * 2);
+  title_utf8 = g_utf16_to_utf8 ((gunichar2 *) session->utf16->data,
+                                title_len, NULL, NULL, NULL);
+
+  mwb_session_file_set_tab (session, tab_id, navigation_index,
+                            g_strndup ((const gchar *) url, url_len),
+                            title_utf8 ? title_utf8 : g_strdup (""));
+}
+
+gboolean
+mwb_session_file_update (MwbSessionFile *session,
+                         GError        **error)
+{
+  GMappedFile *mapped;
+  const guchar *data;
+  gsize len, offset;
+  gint32 version;
+
+  mapped = g_mapped_file_new (session->filename, FALSE, error);
+  if (!mapped)
+    return FALSE;
+
+  data = (const guchar *) g_mapped_file_get_contents (mapped);
+  len = g_mapped_file_get_length (mapped);
+
+  if (len < MWB_SESSION_FILE_HEADER_SIZE || memcmp (data, "SNSS", 4))
+    {
+      mwb_session_file_clear (session);
+      g_mapped_file_unref (mapped);
+      return TRUE;
+    }
+  memcpy (&version, data + 4, 4);
+  if (version != MWB_SESSION_FILE_VERSION)
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                   "%s: unknown session file version %d",
+                   session->filename, version);
+      mwb_session_file_clear (session);
+      g_mapped_file_unref (mapped);
+      return FALSE;
+    }
+
+  /* Start again unless the file has only had commands appended */
+  if (session->offset &&
+      (len < session->offset ||
+       memcmp (data + session->offset - session->tail_len,
+               session->tail, session->tail_len)))
+    mwb_session_file_clear (session);
+
+  offset = MAX (session->offset, MWB_SESSION_FILE_HEADER_SIZE);
+
+  /* A command the browser is still writing gets picked up next time */
+  while (offset + 3 <= len)
+    {
+      guint16 size;
+      guint8 id;
+      const guchar *payload;
+      gsize payload_len;
+
+      memcpy (&size, data + offset, 2);
+      if (size < 1 || offset + 2 + size > len)
+        break;
+
+      id = data[offset + 2];
+      payload = data + offset + 3;
+      payload_len = size - 1;
+
+      if (id == MWB_SESSION_COMMAND_UPDATE_TAB_NAVIGATION)
+        mwb_session_file_update_tab_navigation (session,
+                                                payload, payload_len);
+      else if (id == MWB_SESSION_COMMAND_TAB_CLOSED && payload_len >= 4)
+        {
+          /* The tab id followed by the time it was closed */
+          gint32 tab_id;
+
+          memcpy (&tab_id, payload, 4);
+          mwb_session_file_remove_tab (session, tab_id);
+        }
+
+      offset += 2 + size;
+    }
+
+  session->offset = offset;
+  session->tail_len = MIN (offset, (gsize) MWB_SESSION_FILE_TAIL_SIZE);
+  memcpy (session->tail, data + offset - session->tail_len,
+          session->tail_len);
+
+  g_mapped_file_unref (mapped);
+
+  return TRUE;
+}
+
+static int
+mwb_session_file_compare_tabs (const void *a, const void *b)
+{
+  gint id_a = (*(MwbSessionTab * const *) a)->tab_id;
+  gint id_b = (*(MwbSessionTab * const *) b)->tab_id;
+
+  return id_a < id_b ? -1 : id_a > id_b;
+}
+
+void
+mwb_session_file_foreach (MwbSessionFile        *session,
+                          MwbSessionFileTabFunc  func,
+                          gpointer               user_data)
+{
+  MwbSessionTab **sorted;
+  guint i, n = 0;
+
+  if (!session->n_tabs)
+    return;
+
+  sorted = g_new (MwbSessionTab *, session->n_tabs);
+  for (i = 0; i < session->size; i++)
+    if (session->tabs[i].state == MWB_SESSION_TAB_USED)
+      sorted[n++] = session->tabs + i;
+
+  qsort (sorted, n, sizeof (MwbSessionTab *), mwb_session_file_compare_tabs);
+
+  for (i = 0; i < n; i++)
+    func (sorted[i]->tab_id, sorted[i]->navigation_index,
+          sorted[i]->url, sorted[i]->title, user_data);
+
+  g_free (sorted);
+}
@@ -0,0 +1,56 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Reads the open tabs out of Chromium's "Current Session" file. The
+   file is a log of commands that only gets appended to until the
+   browser rewrites it, so an update only parses the commands added
+   since the last one unless the file was rewritten. Only the latest
+   navigation of each open tab is kept. */
+
+#ifndef _MWB_SESSION_FILE_H
+#define _MWB_SESSION_FILE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _MwbSessionFile MwbSessionFile;
+
+typedef void (* MwbSessionFileTabFunc) (gint         tab_id,
+                                        gint         navigation_index,
+                                        const gchar *url,
+                                        const gchar *title,
+                                        gpointer     user_data);
+
+MwbSessionFile *mwb_session_file_new     (const gchar *filename);
+void            mwb_session_file_free    (MwbSessionFile *session);
+
+/* Parses whatever was added to the file since the last update */
+gboolean        mwb_session_file_update  (MwbSessionFile *session,
+                                          GError        **error);
+
+guint           mwb_session_file_get_n_tabs (MwbSessionFile *session);
+
+/* Calls 'func' for each open tab in order of tab id */
+void            mwb_session_file_foreach (MwbSessionFile        *session,
+                                          MwbSessionFileTabFunc  func,
+                                          gpointer               user_data);
+
+G_END_DECLS
+
+#endif /* _MWB_SESSION_FILE_H */
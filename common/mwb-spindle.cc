@@ -24,6 +24,8 @@
 #include <math.h>
 
 #include "mwb-spindle.h"
+#include "mwb-texture-budget.h"
+#include "mwb-trace.h"
 
 /*
  * MwbSpindle is a ClutterContainer that displays one child at a
@@ -36,6 +38,13 @@
  * the largest child. All children are allocated the same size. The
  * children need to be able to cope with being painted while backface
  * culling is enabled to work properly.
+ *
+ * While rotating, each visible child is rendered once into an
+ * offscreen texture, its 'face', and the rotation just draws the
+ * textured quads. A face is only rendered again when something in
+ * the child queues a redraw, so the cost of the animation doesn't
+ * depend on what the children contain. Without offscreen support the
+ * children are painted directly every frame.
  */
 
 static void mwb_spindle_dispose (GObject *object);
@@ -57,6 +66,174 @@ struct _MwbSpindlePrivate
   gdouble position;
 };
 
+#define MWB_SPINDLE_FACE_KEY "mwb-spindle-face"
+
+/* Attached to each child under MWB_SPINDLE_FACE_KEY */
+typedef struct
+{
+  ClutterActor          *child;
+  gulong                 queue_redraw_handler;
+
+  /* COGL_INVALID_HANDLE until the face is first needed or after it
+     is evicted */
+  CoglHandle             texture;
+  CoglHandle             fbo;
+  gint                   width, height;
+
+  /* Cleared when the child queues a redraw. The paint opacity of the
+     spindle ends up in the texture so it is remembered too. */
+  gboolean               valid;
+  guint8                 opacity;
+
+  MwbTextureBudgetEntry *budget;
+} MwbSpindleFace;
+
+static void
+mwb_spindle_face_drop (MwbSpindleFace *face)
+{
+  if (face->fbo != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (face->fbo);
+      face->fbo = COGL_INVALID_HANDLE;
+    }
+  if (face->texture != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (face->texture);
+      face->texture = COGL_INVALID_HANDLE;
+    }
+
+  face->valid = FALSE;
+  mwb_texture_budget_set_bytes (face->budget, 0);
+}
+
+/* Faces are rendered again on demand so there is nothing to reload */
+static void
+mwb_spindle_face_evict (gpointer data)
+{
+  mwb_spindle_face_drop ((MwbSpindleFace *) data);
+}
+
+static void
+mwb_spindle_face_queue_redraw_cb (ClutterActor   *child,
+                                  ClutterActor   *origin,
+                                  MwbSpindleFace *face)
+{
+  face->valid = FALSE;
+}
+
+static void
+mwb_spindle_face_free (gpointer data)
+{
+  MwbSpindleFace *face = (MwbSpindleFace *) data;
+
+  mwb_spindle_face_drop (face);
+  mwb_texture_budget_remove (face->budget);
+  g_slice_free (MwbSpindleFace, face);
+}
+
+static void
+mwb_spindle_face_attach (ClutterActor *child)
+{
+  MwbSpindleFace *face = g_slice_new0 (MwbSpindleFace);
+
+  face->child = child;
+  face->texture = COGL_INVALID_HANDLE;
+  face->fbo = COGL_INVALID_HANDLE;
+  face->budget = mwb_texture_budget_add (0, FALSE,
+                                         mwb_spindle_face_evict, NULL,
+                                         face);
+  face->queue_redraw_handler
+    = g_signal_connect (child, "queue-redraw",
+                        G_CALLBACK (mwb_spindle_face_queue_redraw_cb), face);
+
+  g_object_set_data_full (G_OBJECT (child), MWB_SPINDLE_FACE_KEY,
+                          face, mwb_spindle_face_free);
+}
+
+static void
+mwb_spindle_face_detach (ClutterActor *child)
+{
+  MwbSpindleFace *face = (MwbSpindleFace *)
+    g_object_get_data (G_OBJECT (child), MWB_SPINDLE_FACE_KEY);
+
+  if (face)
+    {
+      g_signal_handler_disconnect (child, face->queue_redraw_handler);
+      g_object_set_data (G_OBJECT (child), MWB_SPINDLE_FACE_KEY, NULL);
+    }
+}
+
+/* Renders the child into its face unless that is up to date. Returns
+   FALSE if the face can't be used. */
+static gboolean
+mwb_spindle_face_update (MwbSpindleFace *face,
+                         gint            width,
+                         gint            height,
+                         guint8          opacity)
+{
+  CoglMatrix identity;
+  CoglColor transparent;
+
+  if (width <= 0 || height <= 0 ||
+      !cogl_features_available (COGL_FEATURE_OFFSCREEN))
+    return FALSE;
+
+  if (face->texture != COGL_INVALID_HANDLE &&
+      (face->width != width || face->height != height))
+    mwb_spindle_face_drop (face);
+
+  if (face->texture == COGL_INVALID_HANDLE)
+    {
+      face->texture = cogl_texture_new_with_size (width, height,
+                                                  COGL_TEXTURE_NO_SLICING,
+                                                  COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+      if (face->texture == COGL_INVALID_HANDLE)
+        return FALSE;
+
+      face->fbo = cogl_offscreen_new_to_texture (face->texture);
+      if (face->fbo == COGL_INVALID_HANDLE)
+        {
+          cogl_handle_unref (face->texture);
+          face->texture = COGL_INVALID_HANDLE;
+          return FALSE;
+        }
+
+      face->width = width;
+      face->height = height;
+      face->valid = FALSE;
+      mwb_texture_budget_set_bytes (face->budget, width * height * 4);
+    }
+
+  mwb_texture_budget_touch (face->budget);
+
+  if (face->valid && face->opacity == opacity)
+    return TRUE;
+
+  MWB_TRACE_BEGIN ("spindle-render-face");
+
+  cogl_push_framebuffer (face->fbo);
+
+  /* The child is allocated at the origin of the spindle so map the
+     allocation straight onto the texture */
+  cogl_ortho (0.0f, width, height, 0.0f, -1000.0f, 1000.0f);
+  cogl_matrix_init_identity (&identity);
+  cogl_set_modelview_matrix (&identity);
+
+  cogl_color_set_from_4ub (&transparent, 0, 0, 0, 0);
+  cogl_clear (&transparent, COGL_BUFFER_BIT_COLOR);
+
+  clutter_actor_paint (face->child);
+
+  cogl_pop_framebuffer ();
+
+  MWB_TRACE_END ("spindle-render-face");
+
+  face->valid = TRUE;
+  face->opacity = opacity;
+
+  return TRUE;
+}
+
 enum
 {
   PROP_0,
@@ -75,6 +252,7 @@ mwb_spindle_real_add (ClutterContainer *container,
 
   priv->children = g_slist_append (priv->children, actor);
   clutter_actor_set_parent (actor, CLUTTER_ACTOR (spindle));
+  mwb_spindle_face_attach (actor);
 
   clutter_actor_queue_relayout (CLUTTER_ACTOR (spindle));
 
@@ -93,6 +271,7 @@ mwb_spindle_real_remove (ClutterContainer *container,
   g_object_ref (actor);
 
   priv->children = g_slist_remove (priv->children, actor);
+  mwb_spindle_face_detach (actor);
   clutter_actor_unparent (actor);
 
   clutter_actor_queue_relayout (CLUTTER_ACTOR (spindle));
@@ -122,11 +301,46 @@ clutter_container_iface_init (ClutterContainerIface *iface)
 }
 
 static void
-mwb_spindle_paint (ClutterActor *actor)
+mwb_spindle_update_face (ClutterActor          *child,
+                         const ClutterGeometry *geom,
+                         guint8                 opacity)
+{
+  MwbSpindleFace *face = (MwbSpindleFace *)
+    g_object_get_data (G_OBJECT (child), MWB_SPINDLE_FACE_KEY);
+
+  if (face && CLUTTER_ACTOR_IS_VISIBLE (child))
+    mwb_spindle_face_update (face, geom->width, geom->height, opacity);
+}
+
+/* Paints the child, from its face if that was brought up to date */
+static void
+mwb_spindle_paint_child (ClutterActor          *child,
+                         const ClutterGeometry *geom,
+                         gboolean               use_face)
+{
+  MwbSpindleFace *face = use_face
+    ? (MwbSpindleFace *) g_object_get_data (G_OBJECT (child),
+                                            MWB_SPINDLE_FACE_KEY)
+    : NULL;
+
+  if (face && face->valid && face->texture != COGL_INVALID_HANDLE)
+    {
+      cogl_set_source_texture (face->texture);
+      cogl_rectangle (0, 0, geom->width, geom->height);
+    }
+  else
+    clutter_actor_paint (child);
+}
+
+static void
+mwb_spindle_real_paint (ClutterActor *actor,
+                        gboolean      use_faces)
 {
   MwbSpindlePrivate *priv = MWB_SPINDLE (actor)->priv;
   gint int_position = rint (priv->position);
 
+  MWB_TRACE_BEGIN ("spindle-paint");
+
   /* If the position is near enough to a whole number then just paint
      one of the children directly */
   if (fabs (int_position - priv->position) < 1e-5)
@@ -156,8 +370,21 @@ mwb_spindle_paint (ClutterActor *actor)
       if (child_pos)
         {
           gfloat apothem;
-          gboolean was_backface_culling_enabled =
-            cogl_get_backface_culling_enabled ();
+          gboolean was_backface_culling_enabled;
+
+          /* Bring the faces up to date before anything is rotated */
+          if (use_faces)
+            {
+              guint8 opacity = clutter_actor_get_paint_opacity (actor);
+
+              mwb_spindle_update_face ((ClutterActor*)child_pos->data,
+                                       &geom, opacity);
+              if (child_pos->next)
+                mwb_spindle_update_face ((ClutterActor*)child_pos->next->data,
+                                         &geom, opacity);
+            }
+
+          was_backface_culling_enabled = cogl_get_backface_culling_enabled ();
           cogl_set_backface_culling_enabled (TRUE);
 
           /* The 'apothem' is the distance from the center of the
@@ -180,7 +407,8 @@ mwb_spindle_paint (ClutterActor *actor)
           cogl_rotate (360.0f / n_children * fractional_part,
                        1.0f, 0.0f, 0.0f);
           cogl_translate (0.0f, geom.height / -2.0f, apothem);
-          clutter_actor_paint ((ClutterActor*)child_pos->data);
+          mwb_spindle_paint_child ((ClutterActor*)child_pos->data, &geom,
+                                   use_faces);
           cogl_pop_matrix ();
 
           /* Also paint the next child if there is one */
@@ -191,7 +419,8 @@ mwb_spindle_paint (ClutterActor *actor)
               cogl_rotate (360.0f / n_children * (fractional_part - 1.0f),
                            1.0f, 0.0f, 0.0f);
               cogl_translate (0.0f, geom.height / -2.0f, apothem);
-              clutter_actor_paint ((ClutterActor*)child_pos->next->data);
+              mwb_spindle_paint_child ((ClutterActor*)child_pos->next->data,
+                                       &geom, use_faces);
               cogl_pop_matrix ();
             }
 
@@ -200,6 +429,14 @@ mwb_spindle_paint (ClutterActor *actor)
           cogl_set_backface_culling_enabled (was_backface_culling_enabled);
         }
     }
+
+  MWB_TRACE_END ("spindle-paint");
+}
+
+static void
+mwb_spindle_paint (ClutterActor *actor)
+{
+  mwb_spindle_real_paint (actor, TRUE);
 }
 
 static void
@@ -209,7 +446,8 @@ mwb_spindle_pick (ClutterActor *actor,
   /* Chain up so we get a bounding box pained (if we are reactive) */
   CLUTTER_ACTOR_CLASS (mwb_spindle_parent_class)->pick (actor, color);
 
-  mwb_spindle_paint (actor);
+  /* The children have to be painted in their pick colors */
+  mwb_spindle_real_paint (actor, FALSE);
 }
 
 static void
@@ -285,6 +523,8 @@ mwb_spindle_allocate (ClutterActor *self,
   ClutterActorBox child_allocation;
   GSList *l;
 
+  MWB_TRACE_BEGIN ("spindle-allocate");
+
   /* chain up to set actor->allocation */
   CLUTTER_ACTOR_CLASS (mwb_spindle_parent_class)->allocate (self, box, flags);
 
@@ -296,6 +536,8 @@ mwb_spindle_allocate (ClutterActor *self,
 
   for (l = priv->children; l; l = l->next)
     clutter_actor_allocate ((ClutterActor*)l->data, &child_allocation, flags);
+
+  MWB_TRACE_END ("spindle-allocate");
 }
 
 static void
@@ -405,6 +647,7 @@ mwb_spindle_dispose (GObject *object)
   MwbSpindle *self = (MwbSpindle *) object;
   MwbSpindlePrivate *priv = self->priv;
 
+  g_slist_foreach (priv->children, (GFunc) mwb_spindle_face_detach, NULL);
   g_slist_foreach (priv->children, (GFunc) clutter_actor_destroy, NULL);
   g_slist_free (priv->children);
   priv->children = NULL;
@@ -0,0 +1,328 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include "mwb-stats.h"
+
+gint64
+mwb_stats_get_monotonic_time (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (gint64)ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+static gint
+mwb_stats_compare_samples (gconstpointer a, gconstpointer b)
+{
+  gint64 va = *(const gint64 *)a;
+  gint64 vb = *(const gint64 *)b;
+
+  return va < vb ? -1 : va > vb ? 1 : 0;
+}
+
+gint64
+mwb_stats_percentile (GArray *samples, gdouble percentile)
+{
+  guint index;
+
+  if (!samples || samples->len == 0)
+    return 0;
+
+  g_array_sort (samples, mwb_stats_compare_samples);
+
+  /* Nearest-rank */
+  index = (guint)(percentile / 100.0 * samples->len + 0.5);
+  if (index > 0)
+    index--;
+  if (index >= samples->len)
+    index = samples->len - 1;
+
+  return g_array_index (samples, gint64, index);
+}
+
+/* Big enough for a show with every one of the 256 tabs decoding a
+   thumbnail and favicon */
+#define MWB_STATS_RING_SIZE 1024
+
+/* The file is moved aside once it grows past this */
+#define MWB_STATS_FILE_MAX (256 * 1024)
+
+static const gchar *mwb_stats_span_names[MWB_STATS_N_SPANS] =
+  {
+    "db_connect",
+    "create_tabs",
+    "create_history",
+    "search_provider",
+    "texture_decode",
+    "first_paint",
+    "launch"
+  };
+
+static const gchar *mwb_stats_wakeup_names[MWB_STATS_N_WAKEUPS] =
+  {
+    "clear_timeout",
+    "animation",
+    "texture_load",
+    "texture_budget",
+    "model"
+  };
+
+static MwbStatsSpan mwb_stats_ring[MWB_STATS_RING_SIZE];
+static guint mwb_stats_ring_head = 0;
+static guint mwb_stats_ring_len = 0;
+
+static guint mwb_stats_show_id = 0;
+static gint64 mwb_stats_show_start = 0;
+static gboolean mwb_stats_first_paint_pending = FALSE;
+/* Spans only count between show begin and end. Ones ending after the
+   show are dropped rather than added to a summary already written. */
+static gboolean mwb_stats_showing = FALSE;
+/* Spans added during the current show, more than the ring holds means
+   the oldest were overwritten */
+static guint mwb_stats_show_spans = 0;
+
+/* Lines are appended by a single worker so the file I/O stays off
+   the main thread, in order */
+static GThreadPool *mwb_stats_writer = NULL;
+static gchar *mwb_stats_filename = NULL;
+
+/* Counted since the last show began or ended. At show begin they are
+   moved to the hidden_ ones for the line written when it ends. */
+static GPollFunc mwb_stats_poll_func = NULL;
+static guint mwb_stats_wakeups = 0;
+static guint mwb_stats_wakeups_by_type[MWB_STATS_N_WAKEUPS];
+static guint mwb_stats_hidden_wakeups = 0;
+static guint mwb_stats_hidden_wakeups_by_type[MWB_STATS_N_WAKEUPS];
+static gint64 mwb_stats_hidden_start = 0;
+static gint64 mwb_stats_hidden_duration = 0;
+
+static gint
+mwb_stats_poll (GPollFD *fds, guint nfds, gint timeout)
+{
+  gint result = mwb_stats_poll_func (fds, nfds, timeout);
+
+  /* A zero timeout only checks for events, it never slept */
+  if (timeout != 0)
+    mwb_stats_wakeups++;
+
+  return result;
+}
+
+void
+mwb_stats_count_wakeups (void)
+{
+  GMainContext *context = g_main_context_default ();
+
+  if (mwb_stats_poll_func)
+    return;
+
+  mwb_stats_poll_func = g_main_context_get_poll_func (context);
+  g_main_context_set_poll_func (context, mwb_stats_poll);
+}
+
+void
+mwb_stats_wakeup (MwbStatsWakeupType type)
+{
+  mwb_stats_wakeups_by_type[type]++;
+}
+
+void
+mwb_stats_show_begin (void)
+{
+  mwb_stats_show_id++;
+  mwb_stats_show_start = mwb_stats_get_monotonic_time ();
+  mwb_stats_first_paint_pending = TRUE;
+  mwb_stats_showing = TRUE;
+  mwb_stats_show_spans = 0;
+
+  /* Before the first show the panel is starting up, not hidden */
+  if (mwb_stats_hidden_start)
+    {
+      mwb_stats_hidden_duration = mwb_stats_show_start - mwb_stats_hidden_start;
+      mwb_stats_hidden_wakeups = mwb_stats_wakeups;
+      memcpy (mwb_stats_hidden_wakeups_by_type, mwb_stats_wakeups_by_type,
+              sizeof (mwb_stats_wakeups_by_type));
+    }
+  mwb_stats_wakeups = 0;
+  memset (mwb_stats_wakeups_by_type, 0, sizeof (mwb_stats_wakeups_by_type));
+}
+
+void
+mwb_stats_span_add (MwbStatsSpanType type, gint64 start)
+{
+  MwbStatsSpan *span = mwb_stats_ring + mwb_stats_ring_head;
+
+  if (!mwb_stats_showing)
+    return;
+
+  mwb_stats_show_spans++;
+
+  span->type = type;
+  span->show_id = mwb_stats_show_id;
+  span->start = start;
+  span->duration = mwb_stats_get_monotonic_time () - start;
+
+  mwb_stats_ring_head = (mwb_stats_ring_head + 1) % MWB_STATS_RING_SIZE;
+  if (mwb_stats_ring_len < MWB_STATS_RING_SIZE)
+    mwb_stats_ring_len++;
+}
+
+void
+mwb_stats_first_paint (void)
+{
+  if (G_LIKELY (!mwb_stats_first_paint_pending))
+    return;
+
+  mwb_stats_first_paint_pending = FALSE;
+  mwb_stats_span_add (MWB_STATS_SPAN_FIRST_PAINT, mwb_stats_show_start);
+}
+
+static gchar *
+mwb_stats_get_filename (void)
+{
+  const gchar *override = g_getenv ("MWB_STATS_FILE");
+
+  if (override && *override)
+    return g_strdup (override);
+
+  return g_build_filename (g_get_user_cache_dir (),
+                           "internet-panel",
+                           "show-stats.log",
+                           NULL);
+}
+
+static void
+mwb_stats_write_line (gpointer data, gpointer user_data)
+{
+  GString *line = (GString *) data;
+  gchar *dirname;
+  struct stat buf;
+  FILE *file;
+
+  dirname = g_path_get_dirname (mwb_stats_filename);
+  g_mkdir_with_parents (dirname, 0755);
+
+  if (g_stat (mwb_stats_filename, &buf) == 0
+      && buf.st_size > MWB_STATS_FILE_MAX)
+    {
+      gchar *old_filename = g_strconcat (mwb_stats_filename, ".old", NULL);
+      g_rename (mwb_stats_filename, old_filename);
+      g_free (old_filename);
+    }
+
+  if ((file = g_fopen (mwb_stats_filename, "a")))
+    {
+      fputs (line->str, file);
+      fclose (file);
+    }
+  else
+    g_warning ("[netpanel] unable to write stats to %s", mwb_stats_filename);
+
+  g_free (dirname);
+  g_string_free (line, TRUE);
+}
+
+void
+mwb_stats_show_end (void)
+{
+  gint64 total[MWB_STATS_N_SPANS] = { 0, };
+  gint64 max[MWB_STATS_N_SPANS] = { 0, };
+  guint count[MWB_STATS_N_SPANS] = { 0, };
+  GString *line;
+  guint i;
+
+  if (!mwb_stats_showing)
+    return;
+
+  mwb_stats_showing = FALSE;
+  mwb_stats_first_paint_pending = FALSE;
+
+  for (i = 0; i < mwb_stats_ring_len; i++)
+    {
+      MwbStatsSpan *span = mwb_stats_ring + i;
+
+      if (span->show_id != mwb_stats_show_id)
+        continue;
+
+      count[span->type]++;
+      total[span->type] += span->duration;
+      if (span->duration > max[span->type])
+        max[span->type] = span->duration;
+    }
+
+  /* One 'key=value' line per show in microseconds so the field logs
+     can be aggregated with awk */
+  line = g_string_new (NULL);
+  g_string_append_printf (line, "show=%u time=%ld total=%" G_GINT64_FORMAT,
+                          mwb_stats_show_id, (long)time (NULL),
+                          mwb_stats_get_monotonic_time ()
+                          - mwb_stats_show_start);
+  for (i = 0; i < MWB_STATS_N_SPANS; i++)
+    {
+      if (count[i] == 1)
+        g_string_append_printf (line, " %s=%" G_GINT64_FORMAT,
+                                mwb_stats_span_names[i], total[i]);
+      else if (count[i] > 1)
+        g_string_append_printf (line,
+                                " %s_n=%u %s_total=%" G_GINT64_FORMAT
+                                " %s_max=%" G_GINT64_FORMAT,
+                                mwb_stats_span_names[i], count[i],
+                                mwb_stats_span_names[i], total[i],
+                                mwb_stats_span_names[i], max[i]);
+    }
+  if (mwb_stats_show_spans > MWB_STATS_RING_SIZE)
+    g_string_append_printf (line, " dropped_spans=%u",
+                            mwb_stats_show_spans - MWB_STATS_RING_SIZE);
+  if (mwb_stats_poll_func && mwb_stats_hidden_duration)
+    {
+      g_string_append_printf (line,
+                              " hidden=%" G_GINT64_FORMAT " hidden_wakeups=%u",
+                              mwb_stats_hidden_duration,
+                              mwb_stats_hidden_wakeups);
+      for (i = 0; i < MWB_STATS_N_WAKEUPS; i++)
+        if (mwb_stats_hidden_wakeups_by_type[i])
+          g_string_append_printf (line, " hidden_wakeups_%s=%u",
+                                  mwb_stats_wakeup_names[i],
+                                  mwb_stats_hidden_wakeups_by_type[i]);
+    }
+  g_string_append_c (line, '\n');
+
+  if (G_UNLIKELY (mwb_stats_writer == NULL))
+    {
+      mwb_stats_filename = mwb_stats_get_filename ();
+      mwb_stats_writer = g_thread_pool_new (mwb_stats_write_line, NULL,
+                                            1, FALSE, NULL);
+    }
+  g_thread_pool_push (mwb_stats_writer, line, NULL);
+
+  /* Start counting the time hidden */
+  mwb_stats_hidden_start = mwb_stats_get_monotonic_time ();
+  mwb_stats_wakeups = 0;
+  memset (mwb_stats_wakeups_by_type, 0, sizeof (mwb_stats_wakeups_by_type));
+}
@@ -0,0 +1,95 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _MWB_STATS_H
+#define _MWB_STATS_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Microseconds from an arbitrary point, never goes backwards */
+gint64 mwb_stats_get_monotonic_time (void);
+
+/* 'samples' is a GArray of gint64. It gets sorted in place. */
+gint64 mwb_stats_percentile (GArray *samples, gdouble percentile);
+
+/* Timed phases of showing the panel. Spans are kept in a ring buffer
+   and summarised per show into a stats file, one line per show, which
+   is $MWB_STATS_FILE or ~/.cache/internet-panel/show-stats.log. */
+typedef enum
+{
+  MWB_STATS_SPAN_DB_CONNECT,
+  MWB_STATS_SPAN_CREATE_TABS,
+  MWB_STATS_SPAN_CREATE_HISTORY,
+  MWB_STATS_SPAN_SEARCH_PROVIDER,
+  MWB_STATS_SPAN_TEXTURE_DECODE,
+  MWB_STATS_SPAN_FIRST_PAINT,
+  MWB_STATS_SPAN_LAUNCH,
+
+  MWB_STATS_N_SPANS
+} MwbStatsSpanType;
+
+typedef struct
+{
+  MwbStatsSpanType type;
+  guint            show_id;
+  gint64           start;
+  gint64           duration;
+} MwbStatsSpan;
+
+/* Starts a new show, spans added after this are attributed to it */
+void mwb_stats_show_begin (void);
+
+/* Ends the current show. Spans added after this are dropped until the
+   next show begins. The summary is appended to the stats file from a
+   worker thread, with dropped_spans=N if the ring overflowed. */
+void mwb_stats_show_end (void);
+
+/* Records a span from 'start' (as returned by
+   mwb_stats_get_monotonic_time) until now */
+void mwb_stats_span_add (MwbStatsSpanType type, gint64 start);
+
+/* Records the time from mwb_stats_show_begin() to the first call of
+   this after it. Cheap enough to call from every paint. */
+void mwb_stats_first_paint (void);
+
+/* Main loop wakeups. Once mwb_stats_count_wakeups() is called every
+   time the main loop wakes from a poll that could have blocked is
+   counted, and the sources below count themselves when dispatched.
+   The counts for the time the panel was hidden are added to the line
+   of the show that follows it as hidden_wakeups=N and
+   hidden_wakeups_<source>=N, which should stay near zero. */
+typedef enum
+{
+  MWB_STATS_WAKEUP_CLEAR_TIMEOUT,
+  MWB_STATS_WAKEUP_ANIMATION,
+  MWB_STATS_WAKEUP_TEXTURE_LOAD,
+  MWB_STATS_WAKEUP_TEXTURE_BUDGET,
+  MWB_STATS_WAKEUP_MODEL,
+
+  MWB_STATS_N_WAKEUPS
+} MwbStatsWakeupType;
+
+void mwb_stats_count_wakeups (void);
+
+void mwb_stats_wakeup (MwbStatsWakeupType type);
+
+G_END_DECLS
+
+#endif /* _MWB_STATS_H */
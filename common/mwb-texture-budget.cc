@@ -0,0 +1,221 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <clutter/clutter.h>
+#include "mwb-texture-budget.h"
+#include "mwb-stats.h"
+
+#define MWB_TEXTURE_BUDGET_DEFAULT_KB 8192
+
+struct _MwbTextureBudgetEntry
+{
+  gsize                bytes;
+  gboolean             pinned;
+  gboolean             evicted;
+  guint                serial;
+  guint                reload_source;
+
+  MwbTextureBudgetFunc evict_func;
+  MwbTextureBudgetFunc reload_func;
+  gpointer             user_data;
+
+  /* Link in mwb_texture_budget_lru, least recently touched first */
+  GList               *link;
+};
+
+static GQueue mwb_texture_budget_lru = G_QUEUE_INIT;
+static gsize mwb_texture_budget_used = 0;
+static gsize mwb_texture_budget_limit = 0;
+static guint mwb_texture_budget_serial = 0;
+static guint mwb_texture_budget_enforce_source = 0;
+
+gsize
+mwb_texture_budget_get_limit (void)
+{
+  if (G_UNLIKELY (mwb_texture_budget_limit == 0))
+    {
+      const gchar *env = g_getenv ("MWB_TEXTURE_BUDGET_KB");
+      gsize kb = env ? strtoul (env, NULL, 10) : 0;
+
+      mwb_texture_budget_limit
+        = (kb ? kb : MWB_TEXTURE_BUDGET_DEFAULT_KB) * 1024;
+    }
+
+  return mwb_texture_budget_limit;
+}
+
+gsize
+mwb_texture_budget_get_used (void)
+{
+  return mwb_texture_budget_used;
+}
+
+static gboolean
+mwb_texture_budget_enforce (gpointer data)
+{
+  gsize limit = mwb_texture_budget_get_limit ();
+  GList *l, *next;
+
+  mwb_stats_wakeup (MWB_STATS_WAKEUP_TEXTURE_BUDGET);
+
+  mwb_texture_budget_enforce_source = 0;
+
+  for (l = mwb_texture_budget_lru.head;
+       l && mwb_texture_budget_used > limit;
+       l = next)
+    {
+      MwbTextureBudgetEntry *entry = (MwbTextureBudgetEntry *)l->data;
+
+      next = l->next;
+
+      /* Anything touched since the last check is on screen */
+      if (entry->serial == mwb_texture_budget_serial)
+        break;
+
+      if (entry->pinned || entry->evicted || !entry->evict_func)
+        continue;
+
+      entry->evicted = TRUE;
+      entry->evict_func (entry->user_data);
+      mwb_texture_budget_used -= entry->bytes;
+      entry->bytes = 0;
+    }
+
+  mwb_texture_budget_serial++;
+
+  return FALSE;
+}
+
+static void
+mwb_texture_budget_queue_enforce (void)
+{
+  if (mwb_texture_budget_used > mwb_texture_budget_get_limit () &&
+      !mwb_texture_budget_enforce_source)
+    mwb_texture_budget_enforce_source
+      = clutter_threads_add_idle_full (G_PRIORITY_LOW,
+                                       mwb_texture_budget_enforce,
+                                       NULL, NULL);
+}
+
+MwbTextureBudgetEntry *
+mwb_texture_budget_add (gsize                bytes,
+                        gboolean             pinned,
+                        MwbTextureBudgetFunc evict_func,
+                        MwbTextureBudgetFunc reload_func,
+                        gpointer             user_data)
+{
+  MwbTextureBudgetEntry *entry = g_slice_new0 (MwbTextureBudgetEntry);
+
+  entry->bytes = bytes;
+  entry->pinned = pinned;
+  entry->evict_func = evict_func;
+  entry->reload_func = reload_func;
+  entry->user_data = user_data;
+  entry->serial = mwb_texture_budget_serial;
+
+  g_queue_push_tail (&mwb_texture_budget_lru, entry);
+  entry->link = mwb_texture_budget_lru.tail;
+
+  mwb_texture_budget_used += bytes;
+  mwb_texture_budget_queue_enforce ();
+
+  return entry;
+}
+
+void
+mwb_texture_budget_remove (MwbTextureBudgetEntry *entry)
+{
+  if (!entry)
+    return;
+
+  if (entry->reload_source)
+    g_source_remove (entry->reload_source);
+
+  mwb_texture_budget_used -= entry->bytes;
+  g_queue_delete_link (&mwb_texture_budget_lru, entry->link);
+
+  g_slice_free (MwbTextureBudgetEntry, entry);
+}
+
+void
+mwb_texture_budget_set_bytes (MwbTextureBudgetEntry *entry,
+                              gsize                  bytes)
+{
+  mwb_texture_budget_used += bytes;
+  mwb_texture_budget_used -= entry->bytes;
+  entry->bytes = bytes;
+
+  if (bytes)
+    entry->evicted = FALSE;
+
+  mwb_texture_budget_queue_enforce ();
+}
+
+static gboolean
+mwb_texture_budget_reload_cb (gpointer data)
+{
+  MwbTextureBudgetEntry *entry = (MwbTextureBudgetEntry *)data;
+
+  mwb_stats_wakeup (MWB_STATS_WAKEUP_TEXTURE_BUDGET);
+
+  entry->reload_source = 0;
+
+  /* The reload function is expected to call set_bytes(). Clear the
+     flag first so an entry that reloads to nothing isn't retried on
+     every paint. */
+  if (entry->evicted && entry->reload_func)
+    {
+      entry->evicted = FALSE;
+      entry->reload_func (entry->user_data);
+    }
+
+  return FALSE;
+}
+
+void
+mwb_texture_budget_touch (MwbTextureBudgetEntry *entry)
+{
+  if (!entry)
+    return;
+
+  entry->serial = mwb_texture_budget_serial;
+
+  if (entry->link != mwb_texture_budget_lru.tail)
+    {
+      g_queue_unlink (&mwb_texture_budget_lru, entry->link);
+      g_queue_push_tail_link (&mwb_texture_budget_lru, entry->link);
+    }
+
+  /* Entries added in a burst all carry the serial of the check they
+     were added before, so that check can't tell which of them are on
+     screen. Checking again after each frame while over the limit
+     evicts the ones that frame didn't paint. */
+  mwb_texture_budget_queue_enforce ();
+
+  /* Usually called from paint, so don't decode here */
+  if (entry->evicted && entry->reload_func && !entry->reload_source)
+    entry->reload_source
+      = clutter_threads_add_idle_full (G_PRIORITY_DEFAULT_IDLE,
+                                       mwb_texture_budget_reload_cb,
+                                       entry, NULL);
+}
@@ -0,0 +1,62 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Accounts for the memory held by decoded textures and keeps it under
+   a byte budget, $MWB_TEXTURE_BUDGET_KB or 8MiB by default.
+
+   Every texture owner registers an entry with the number of bytes it
+   holds. Owners call mwb_texture_budget_touch() whenever the texture
+   is on screen, typically from paint. When the total goes over budget
+   the least recently touched entries that weren't touched since the
+   last check are evicted through their evict callback. Touching an
+   evicted entry queues its reload callback from an idle so it is
+   decoded again on demand. Pinned entries are counted but never
+   evicted. */
+
+#ifndef _MWB_TEXTURE_BUDGET_H
+#define _MWB_TEXTURE_BUDGET_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _MwbTextureBudgetEntry MwbTextureBudgetEntry;
+
+typedef void (* MwbTextureBudgetFunc) (gpointer user_data);
+
+MwbTextureBudgetEntry *
+mwb_texture_budget_add (gsize                bytes,
+                        gboolean             pinned,
+                        MwbTextureBudgetFunc evict_func,
+                        MwbTextureBudgetFunc reload_func,
+                        gpointer             user_data);
+
+void mwb_texture_budget_remove    (MwbTextureBudgetEntry *entry);
+
+/* Called by the owner after it (re)loads or drops the texture */
+void mwb_texture_budget_set_bytes (MwbTextureBudgetEntry *entry,
+                                   gsize                  bytes);
+
+void mwb_texture_budget_touch     (MwbTextureBudgetEntry *entry);
+
+gsize mwb_texture_budget_get_used  (void);
+gsize mwb_texture_budget_get_limit (void);
+
+G_END_DECLS
+
+#endif /* _MWB_TEXTURE_BUDGET_H */
@@ -0,0 +1,314 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include "mwb-tld-trie.h"
+
+/* Node 0 is the root. As the root is never a child, 0 also means 'no
+   node' for the child, sibling and best links. */
+typedef struct
+{
+  gchar  ch;
+  guint  parent;
+  guint  first_child;
+  guint  next_sibling;
+  guint  depth;
+
+  /* Longest proper suffix of this node's string that is also in the
+     trie, as in Aho-Corasick */
+  guint  fail;
+
+  /* Only set on nodes that end a suggestion */
+  gchar *key;
+  gint   score;
+
+  /* The highest scoring suggestion at or below this node */
+  guint  best;
+} MwbTldTrieNode;
+
+struct _MwbTldTrie
+{
+  GArray  *nodes;
+  guint    max_depth;
+
+  /* Set when a suggestion is added or its score changes, the failure
+     and best links get recalculated by the next lookup */
+  gboolean dirty;
+};
+
+#define NODE(trie, i) (&g_array_index ((trie)->nodes, MwbTldTrieNode, (i)))
+
+MwbTldTrie *
+mwb_tld_trie_new (void)
+{
+  MwbTldTrie *trie = g_slice_new0 (MwbTldTrie);
+  MwbTldTrieNode root;
+
+  trie->nodes = g_array_new (FALSE, FALSE, sizeof (MwbTldTrieNode));
+  memset (&root, 0, sizeof (root));
+  g_array_append_val (trie->nodes, root);
+
+  return trie;
+}
+
+void
+mwb_tld_trie_free (MwbTldTrie *trie)
+{
+  guint i;
+
+  for (i = 0; i < trie->nodes->len; i++)
+    g_free (NODE (trie, i)->key);
+  g_array_free (trie->nodes, TRUE);
+
+  g_slice_free (MwbTldTrie, trie);
+}
+
+static guint
+mwb_tld_trie_get_child (MwbTldTrie *trie, guint node, gchar ch)
+{
+  guint child;
+
+  for (child = NODE (trie, node)->first_child;
+       child;
+       child = NODE (trie, child)->next_sibling)
+    if (NODE (trie, child)->ch == ch)
+      return child;
+
+  return 0;
+}
+
+void
+mwb_tld_trie_add_score (MwbTldTrie  *trie,
+                        const gchar *tld,
+                        gsize        tld_len,
+                        gint         score)
+{
+  guint node = 0;
+  gsize i;
+
+  g_return_if_fail (tld_len > 0);
+
+  for (i = 0; i < tld_len; i++)
+    {
+      guint child = mwb_tld_trie_get_child (trie, node, tld[i]);
+
+      if (!child)
+        {
+          MwbTldTrieNode new_node;
+
+          memset (&new_node, 0, sizeof (new_node));
+          new_node.ch = tld[i];
+          new_node.parent = node;
+          new_node.depth = i + 1;
+          new_node.next_sibling = NODE (trie, node)->first_child;
+
+          child = trie->nodes->len;
+          g_array_append_val (trie->nodes, new_node);
+          NODE (trie, node)->first_child = child;
+        }
+
+      node = child;
+    }
+
+  if (!NODE (trie, node)->key)
+    NODE (trie, node)->key = g_strndup (tld, tld_len);
+  NODE (trie, node)->score += score;
+
+  trie->max_depth = MAX (trie->max_depth, tld_len);
+  trie->dirty = TRUE;
+}
+
+static void
+mwb_tld_trie_rebuild (MwbTldTrie *trie)
+{
+  GArray *order;
+  guint i;
+
+  /* Breadth first so every node's failure link is known before its
+     children need it */
+  order = g_array_sized_new (FALSE, FALSE, sizeof (guint), trie->nodes->len);
+  i = 0;
+  g_array_append_val (order, i);
+
+  for (i = 0; i < order->len; i++)
+    {
+      guint node = g_array_index (order, guint, i);
+      guint child;
+
+      for (child = NODE (trie, node)->first_child;
+           child;
+           child = NODE (trie, child)->next_sibling)
+        {
+          MwbTldTrieNode *c = NODE (trie, child);
+
+          if (node == 0)
+            c->fail = 0;
+          else
+            {
+              guint fail = NODE (trie, node)->fail;
+
+              while (fail && !mwb_tld_trie_get_child (trie, fail, c->ch))
+                fail = NODE (trie, fail)->fail;
+              c->fail = mwb_tld_trie_get_child (trie, fail, c->ch);
+            }
+
+          g_array_append_val (order, child);
+        }
+    }
+
+  for (i = 0; i < order->len; i++)
+    {
+      MwbTldTrieNode *n = NODE (trie, g_array_index (order, guint, i));
+      n->best = n->key ? g_array_index (order, guint, i) : 0;
+    }
+
+  /* In reverse so children are done before their parents */
+  for (i = order->len - 1; i > 0; i--)
+    {
+      guint node = g_array_index (order, guint, i);
+      MwbTldTrieNode *n = NODE (trie, node);
+      MwbTldTrieNode *parent = NODE (trie, n->parent);
+
+      if (n->best &&
+          (!parent->best ||
+           NODE (trie, parent->best)->score < NODE (trie, n->best)->score))
+        parent->best = n->best;
+    }
+
+  g_array_free (order, TRUE);
+
+  trie->dirty = FALSE;
+}
+
+const gchar *
+mwb_tld_trie_get_best (MwbTldTrie *trie)
+{
+  if (trie->dirty)
+    mwb_tld_trie_rebuild (trie);
+
+  return NODE (trie, 0)->best ? NODE (trie, NODE (trie, 0)->best)->key : NULL;
+}
+
+const gchar *
+mwb_tld_trie_lookup (MwbTldTrie  *trie,
+                     const gchar *search_text,
+                     gint        *overlap_ret)
+{
+  const gchar *p, *end;
+  guint node = 0;
+
+  if (trie->dirty)
+    mwb_tld_trie_rebuild (trie);
+
+  if (!NODE (trie, 0)->best)
+    return NULL;
+
+  /* Nothing further back than the longest suggestion can overlap */
+  end = search_text + strlen (search_text);
+  p = end - MIN ((gsize) (end - search_text), trie->max_depth);
+
+  for (; p < end; p++)
+    {
+      guint child;
+
+      while (!(child = mwb_tld_trie_get_child (trie, node, *p)) && node)
+        node = NODE (trie, node)->fail;
+      node = child;
+    }
+
+  /* Every node is the start of at least one suggestion so there is
+     always a best one */
+  if (overlap_ret)
+    *overlap_ret = NODE (trie, node)->depth;
+
+  return NODE (trie, NODE (trie, node)->best)->key;
+}
+
+GList *
+mwb_tld_trie_get_keys (MwbTldTrie *trie)
+{
+  GList *keys = NULL;
+  guint i;
+
+  for (i = 1; i < trie->nodes->len; i++)
+    if (NODE (trie, i)->key)
+      keys = g_list_prepend (keys, NODE (trie, i)->key);
+
+  return keys;
+}
+
+static gboolean
+mwb_tld_trie_is_second_level (const gchar *label, gsize len)
+{
+  static const gchar *second_level[] =
+    { "ac", "co", "com", "edu", "gov", "ne", "net", "or", "org" };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (second_level); i++)
+    if (strlen (second_level[i]) == len &&
+        !strncmp (label, second_level[i], len))
+      return TRUE;
+
+  return FALSE;
+}
+
+gboolean
+mwb_tld_trie_find_tld (const gchar  *url,
+                       const gchar **tld_ret,
+                       gsize        *tld_len_ret)
+{
+  const gchar *host, *host_end, *last_dot, *prev_dot, *p;
+  gboolean numeric = TRUE;
+
+  host = strstr (url, "://");
+  host = host ? host + 3 : url;
+  host_end = host + strcspn (host, "/:?#");
+
+  last_dot = NULL;
+  prev_dot = NULL;
+  for (p = host; p < host_end; p++)
+    if (*p == '.')
+      {
+        prev_dot = last_dot;
+        last_dot = p;
+      }
+
+  if (!last_dot || last_dot + 1 >= host_end)
+    return FALSE;
+
+  for (p = last_dot + 1; p < host_end; p++)
+    if (!g_ascii_isdigit (*p))
+      numeric = FALSE;
+  if (numeric)
+    return FALSE;
+
+  /* Country code domains often have a generic second level, eg.
+     .co.uk, as long as there's a name in front of it */
+  if (host_end - last_dot == 3 && prev_dot && prev_dot > host &&
+      mwb_tld_trie_is_second_level (prev_dot + 1, last_dot - prev_dot - 1))
+    last_dot = prev_dot;
+
+  *tld_ret = last_dot;
+  *tld_len_ret = host_end - last_dot;
+
+  return TRUE;
+}
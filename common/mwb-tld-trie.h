@@ -0,0 +1,69 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Scored TLD suggestions such as ".com" or ".co.uk" for completing a
+   typed domain. The suggestions form a trie with failure links, so
+   the suggestion with the longest overlap with the end of the search
+   text is found in a single pass over its tail, however many
+   suggestions there are. */
+
+#ifndef _MWB_TLD_TRIE_H
+#define _MWB_TLD_TRIE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _MwbTldTrie MwbTldTrie;
+
+MwbTldTrie  *mwb_tld_trie_new       (void);
+void         mwb_tld_trie_free      (MwbTldTrie *trie);
+
+/* Adds 'score' to the score of 'tld', which needs to start with a
+   dot. The suggestion is added first if it isn't in the trie yet. */
+void         mwb_tld_trie_add_score (MwbTldTrie  *trie,
+                                     const gchar *tld,
+                                     gsize        tld_len,
+                                     gint         score);
+
+/* The highest scoring suggestion or NULL if the trie is empty */
+const gchar *mwb_tld_trie_get_best  (MwbTldTrie *trie);
+
+/* Finds the suggestion whose start overlaps most with the end of
+   'search_text', preferring the higher score between suggestions with
+   the same overlap. An overlap of zero matches the best suggestion.
+   Returns NULL if the trie is empty. */
+const gchar *mwb_tld_trie_lookup    (MwbTldTrie  *trie,
+                                     const gchar *search_text,
+                                     gint        *overlap_ret);
+
+/* Returns the suggestions as strings owned by the trie. Free the list
+   with g_list_free(). */
+GList       *mwb_tld_trie_get_keys  (MwbTldTrie *trie);
+
+/* Finds the part of the host of 'url' that would be suggested: the
+   last label, along with the one before it if that is a short second
+   level name as in ".co.uk" or ".com.cn". Returns FALSE if the host
+   has no dot or looks like an IPv4 address. */
+gboolean     mwb_tld_trie_find_tld  (const gchar  *url,
+                                     const gchar **tld_ret,
+                                     gsize        *tld_len_ret);
+
+G_END_DECLS
+
+#endif /* _MWB_TLD_TRIE_H */
@@ -0,0 +1,487 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include "mwb-top-sites.h"
+#include "mwb-utils.h"
+
+#define MWB_TOP_SITES_FILENAME "topsites.db"
+
+/* Bump when the table changes meaning, it then gets rebuilt */
+#define MWB_TOP_SITES_VERSION 1
+
+/* More than are shown as some won't have a thumbnail */
+#define MWB_TOP_SITES_POOL 32
+
+#define MWB_TOP_SITES_SCHEMA_SQL \
+  "CREATE TABLE IF NOT EXISTS topsites.top_sites (" \
+  "rank INTEGER PRIMARY KEY, url_id INTEGER NOT NULL, url LONGVARCHAR, " \
+  "title LONGVARCHAR, visit_count INTEGER NOT NULL, " \
+  "favicon_url LONGVARCHAR, has_thumbnail INTEGER NOT NULL, " \
+  "favicon LONGVARCHAR);" \
+  "CREATE TABLE IF NOT EXISTS topsites.state (" \
+  "key LONGVARCHAR PRIMARY KEY, value INTEGER NOT NULL);"
+
+#define MWB_TOP_SITES_STATE_SQL "SELECT key, value FROM topsites.state"
+#define MWB_TOP_SITES_SET_STATE_SQL \
+  "INSERT OR REPLACE INTO topsites.state (key, value) VALUES (?1, ?2)"
+
+#define MWB_TOP_SITES_POOL_SQL \
+  "SELECT url_id, url, title, visit_count, favicon_url " \
+  "FROM topsites.top_sites ORDER BY rank"
+#define MWB_TOP_SITES_CHECK_SQL "SELECT visit_count FROM urls WHERE id = ?1"
+#define MWB_TOP_SITES_MAX_SQL "SELECT MAX(id) FROM urls"
+#define MWB_TOP_SITES_MAX_VISIT_SQL "SELECT MAX(last_visit_time) FROM urls"
+
+#define MWB_TOP_SITES_URLS_SQL \
+  "SELECT urls.id, urls.url, urls.title, urls.visit_count, " \
+  "urls.last_visit_time, favicons.url " \
+  "FROM urls LEFT JOIN favicons ON favicons.id = urls.favicon_id "
+#define MWB_TOP_SITES_CHANGED_SQL MWB_TOP_SITES_URLS_SQL \
+  "WHERE urls.id > ?1 OR urls.last_visit_time > ?2"
+#define MWB_TOP_SITES_REBUILD_SQL MWB_TOP_SITES_URLS_SQL \
+  "ORDER BY urls.visit_count DESC LIMIT ?1"
+
+#define MWB_TOP_SITES_INSERT_SQL \
+  "INSERT INTO topsites.top_sites (rank, url_id, url, title, visit_count, " \
+  "favicon_url, has_thumbnail, favicon) " \
+  "VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8)"
+
+typedef struct
+{
+  gint64 version;
+  gint64 places_mtime;
+  gint64 places_size;
+  gint64 thumbnails_mtime;
+  gint64 max_id;
+  gint64 last_visit_time;
+} MwbTopSitesState;
+
+typedef struct
+{
+  gint64  id;
+  gchar  *url;
+  gchar  *title;
+  gint    visit_count;
+  gchar  *favicon_url;
+} MwbTopSite;
+
+static const struct
+{
+  const gchar *key;
+  gsize        offset;
+} mwb_top_sites_state_keys[] =
+  {
+    { "version", G_STRUCT_OFFSET (MwbTopSitesState, version) },
+    { "places_mtime", G_STRUCT_OFFSET (MwbTopSitesState, places_mtime) },
+    { "places_size", G_STRUCT_OFFSET (MwbTopSitesState, places_size) },
+    { "thumbnails_mtime",
+      G_STRUCT_OFFSET (MwbTopSitesState, thumbnails_mtime) },
+    { "max_id", G_STRUCT_OFFSET (MwbTopSitesState, max_id) },
+    { "last_visit_time",
+      G_STRUCT_OFFSET (MwbTopSitesState, last_visit_time) }
+  };
+
+static gboolean
+mwb_top_sites_exec (sqlite3 *dbcon, const gchar *sql)
+{
+  gchar *errmsg = NULL;
+
+  if (sqlite3_exec (dbcon, sql, NULL, NULL, &errmsg) != SQLITE_OK)
+    {
+      g_warning ("[netpanel] top sites: %s", errmsg);
+      sqlite3_free (errmsg);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static sqlite3_stmt *
+mwb_top_sites_prepare (sqlite3 *dbcon, const gchar *sql)
+{
+  sqlite3_stmt *stmt;
+
+  if (sqlite3_prepare_v2 (dbcon, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+      g_warning ("[netpanel] sqlite3_prepare_v2 (): %s",
+                 sqlite3_errmsg (dbcon));
+      return NULL;
+    }
+
+  return stmt;
+}
+
+static gint64
+mwb_top_sites_query_int64 (sqlite3 *dbcon, const gchar *sql)
+{
+  sqlite3_stmt *stmt = mwb_top_sites_prepare (dbcon, sql);
+  gint64 value = 0;
+
+  if (stmt && sqlite3_step (stmt) == SQLITE_ROW)
+    value = sqlite3_column_int64 (stmt, 0);
+  sqlite3_finalize (stmt);
+
+  return value;
+}
+
+static void
+mwb_top_sites_read_state (sqlite3 *dbcon, MwbTopSitesState *state)
+{
+  sqlite3_stmt *stmt = mwb_top_sites_prepare (dbcon, MWB_TOP_SITES_STATE_SQL);
+  guint i;
+
+  memset (state, 0, sizeof (MwbTopSitesState));
+
+  while (stmt && sqlite3_step (stmt) == SQLITE_ROW)
+    {
+      const gchar *key = (const gchar *) sqlite3_column_text (stmt, 0);
+
+      for (i = 0; key && i < G_N_ELEMENTS (mwb_top_sites_state_keys); i++)
+        if (!strcmp (key, mwb_top_sites_state_keys[i].key))
+          G_STRUCT_MEMBER (gint64, state,
+                           mwb_top_sites_state_keys[i].offset)
+            = sqlite3_column_int64 (stmt, 1);
+    }
+  sqlite3_finalize (stmt);
+}
+
+static void
+mwb_top_sites_write_state (sqlite3 *dbcon, MwbTopSitesState *state)
+{
+  sqlite3_stmt *stmt = mwb_top_sites_prepare (dbcon,
+                                              MWB_TOP_SITES_SET_STATE_SQL);
+  guint i;
+
+  if (!stmt)
+    return;
+
+  for (i = 0; i < G_N_ELEMENTS (mwb_top_sites_state_keys); i++)
+    {
+      sqlite3_bind_text (stmt, 1, mwb_top_sites_state_keys[i].key, -1,
+                         SQLITE_STATIC);
+      sqlite3_bind_int64 (stmt, 2,
+                          G_STRUCT_MEMBER (gint64, state,
+                                           mwb_top_sites_state_keys[i].offset));
+      sqlite3_step (stmt);
+      sqlite3_reset (stmt);
+    }
+  sqlite3_finalize (stmt);
+}
+
+static void
+mwb_top_sites_clear (GArray *pool)
+{
+  guint i;
+
+  for (i = 0; i < pool->len; i++)
+    {
+      MwbTopSite *site = &g_array_index (pool, MwbTopSite, i);
+
+      g_free (site->url);
+      g_free (site->title);
+      g_free (site->favicon_url);
+    }
+  g_array_set_size (pool, 0);
+}
+
+/* Most visited first, the older URL first on a tie so the order is
+   stable */
+static gint
+mwb_top_sites_compare (gconstpointer a, gconstpointer b)
+{
+  const MwbTopSite *site_a = (const MwbTopSite *) a;
+  const MwbTopSite *site_b = (const MwbTopSite *) b;
+
+  if (site_a->visit_count != site_b->visit_count)
+    return site_b->visit_count - site_a->visit_count;
+
+  return site_a->id < site_b->id ? -1 : site_a->id > site_b->id;
+}
+
+/* Sorts the pool and drops all but the top ones */
+static void
+mwb_top_sites_trim (GArray *pool)
+{
+  guint i;
+
+  g_array_sort (pool, mwb_top_sites_compare);
+
+  for (i = MWB_TOP_SITES_POOL; i < pool->len; i++)
+    {
+      MwbTopSite *site = &g_array_index (pool, MwbTopSite, i);
+
+      g_free (site->url);
+      g_free (site->title);
+      g_free (site->favicon_url);
+    }
+  if (pool->len > MWB_TOP_SITES_POOL)
+    g_array_set_size (pool, MWB_TOP_SITES_POOL);
+}
+
+/* Adds the urls rows from 'stmt', replacing any already in the pool.
+   Returns the latest last_visit_time seen. */
+static gint64
+mwb_top_sites_merge (GArray *pool, sqlite3_stmt *stmt)
+{
+  gint64 last_visit_time = 0;
+  guint i;
+
+  while (sqlite3_step (stmt) == SQLITE_ROW)
+    {
+      MwbTopSite site, *old = NULL;
+
+      site.id = sqlite3_column_int64 (stmt, 0);
+      site.url = g_strdup ((const gchar *) sqlite3_column_text (stmt, 1));
+      site.title = g_strdup ((const gchar *) sqlite3_column_text (stmt, 2));
+      site.visit_count = sqlite3_column_int (stmt, 3);
+      site.favicon_url
+        = g_strdup ((const gchar *) sqlite3_column_text (stmt, 5));
+      last_visit_time = MAX (last_visit_time, sqlite3_column_int64 (stmt, 4));
+
+      for (i = 0; i < pool->len; i++)
+        if (g_array_index (pool, MwbTopSite, i).id == site.id)
+          old = &g_array_index (pool, MwbTopSite, i);
+
+      if (old)
+        {
+          g_free (old->url);
+          g_free (old->title);
+          g_free (old->favicon_url);
+          *old = site;
+        }
+      else
+        g_array_append_val (pool, site);
+
+      /* Keeps the lookup above cheap when lots of URLs changed */
+      if (pool->len >= MWB_TOP_SITES_POOL * 2)
+        mwb_top_sites_trim (pool);
+    }
+
+  return last_visit_time;
+}
+
+static void
+mwb_top_sites_write (sqlite3 *dbcon, GArray *pool)
+{
+  sqlite3_stmt *stmt;
+  guint i;
+
+  if (!mwb_top_sites_exec (dbcon, "DELETE FROM topsites.top_sites") ||
+      !(stmt = mwb_top_sites_prepare (dbcon, MWB_TOP_SITES_INSERT_SQL)))
+    return;
+
+  for (i = 0; i < pool->len; i++)
+    {
+      MwbTopSite *site = &g_array_index (pool, MwbTopSite, i);
+      gchar *thumbnail = NULL, *favicon = NULL;
+      gboolean has_thumbnail = FALSE;
+
+      if (site->url)
+        {
+          thumbnail = mwb_utils_get_cache_filename ("thumbnails",
+                                                    site->url, ".png");
+          has_thumbnail = g_file_test (thumbnail, G_FILE_TEST_EXISTS);
+        }
+      if (site->favicon_url)
+        {
+          favicon = mwb_utils_get_cache_filename ("favicons",
+                                                  site->favicon_url, ".ico");
+          if (!g_file_test (favicon, G_FILE_TEST_EXISTS))
+            {
+              g_free (favicon);
+              favicon = NULL;
+            }
+        }
+
+      sqlite3_bind_int (stmt, 1, i);
+      sqlite3_bind_int64 (stmt, 2, site->id);
+      sqlite3_bind_text (stmt, 3, site->url, -1, SQLITE_STATIC);
+      sqlite3_bind_text (stmt, 4, site->title, -1, SQLITE_STATIC);
+      sqlite3_bind_int (stmt, 5, site->visit_count);
+      sqlite3_bind_text (stmt, 6, site->favicon_url, -1, SQLITE_STATIC);
+      sqlite3_bind_int (stmt, 7, has_thumbnail);
+      sqlite3_bind_text (stmt, 8, favicon, -1, SQLITE_STATIC);
+
+      if (sqlite3_step (stmt) != SQLITE_DONE)
+        g_warning ("[netpanel] top sites: %s", sqlite3_errmsg (dbcon));
+      sqlite3_reset (stmt);
+
+      g_free (thumbnail);
+      g_free (favicon);
+    }
+
+  sqlite3_finalize (stmt);
+}
+
+/* Loads the pool, dropping URLs that have been deleted and refreshing
+   the visit counts. Returns FALSE if any were deleted as the pool then
+   has to be refilled from scratch. */
+static gboolean
+mwb_top_sites_load_pool (sqlite3 *dbcon, GArray *pool)
+{
+  sqlite3_stmt *stmt, *check;
+  gboolean complete = TRUE;
+
+  if (!(stmt = mwb_top_sites_prepare (dbcon, MWB_TOP_SITES_POOL_SQL)))
+    return FALSE;
+  if (!(check = mwb_top_sites_prepare (dbcon, MWB_TOP_SITES_CHECK_SQL)))
+    {
+      sqlite3_finalize (stmt);
+      return FALSE;
+    }
+
+  while (sqlite3_step (stmt) == SQLITE_ROW)
+    {
+      MwbTopSite site;
+
+      site.id = sqlite3_column_int64 (stmt, 0);
+
+      sqlite3_bind_int64 (check, 1, site.id);
+      if (sqlite3_step (check) != SQLITE_ROW)
+        complete = FALSE;
+      else
+        {
+          site.url = g_strdup ((const gchar *) sqlite3_column_text (stmt, 1));
+          site.title
+            = g_strdup ((const gchar *) sqlite3_column_text (stmt, 2));
+          site.visit_count = sqlite3_column_int (check, 0);
+          site.favicon_url
+            = g_strdup ((const gchar *) sqlite3_column_text (stmt, 4));
+          g_array_append_val (pool, site);
+        }
+      sqlite3_reset (check);
+    }
+
+  sqlite3_finalize (check);
+  sqlite3_finalize (stmt);
+
+  return complete;
+}
+
+static void
+mwb_top_sites_stat (const gchar *path, gint64 *mtime, gint64 *size)
+{
+  struct stat buf;
+
+  if (g_stat (path, &buf) == 0)
+    {
+      *mtime = buf.st_mtime;
+      if (size)
+        *size = buf.st_size;
+    }
+}
+
+gboolean
+mwb_top_sites_update (sqlite3     *dbcon,
+                      const gchar *places_db)
+{
+  MwbTopSitesState state, new_state;
+  sqlite3_stmt *stmt;
+  gchar *filename, *sql, *thumbnails;
+  gboolean rebuild;
+  GArray *pool;
+
+  if (!dbcon || !places_db)
+    return FALSE;
+
+  filename = g_build_filename (mwb_utils_get_netpanel_dir (),
+                               MWB_TOP_SITES_FILENAME, NULL);
+  sql = sqlite3_mprintf ("ATTACH DATABASE %Q AS topsites", filename);
+  g_free (filename);
+  if (!mwb_top_sites_exec (dbcon, sql))
+    {
+      sqlite3_free (sql);
+      return FALSE;
+    }
+  sqlite3_free (sql);
+
+  if (!mwb_top_sites_exec (dbcon, MWB_TOP_SITES_SCHEMA_SQL))
+    return FALSE;
+
+  mwb_top_sites_read_state (dbcon, &state);
+
+  new_state = state;
+  new_state.version = MWB_TOP_SITES_VERSION;
+  mwb_top_sites_stat (places_db, &new_state.places_mtime,
+                      &new_state.places_size);
+  thumbnails = g_build_filename (mwb_utils_get_netpanel_dir (),
+                                 "thumbnails", NULL);
+  mwb_top_sites_stat (thumbnails, &new_state.thumbnails_mtime, NULL);
+  g_free (thumbnails);
+
+  if (!memcmp (&state, &new_state, sizeof (MwbTopSitesState)))
+    return TRUE;
+
+  if (!mwb_top_sites_exec (dbcon, "BEGIN"))
+    return FALSE;
+
+  pool = g_array_new (FALSE, FALSE, sizeof (MwbTopSite));
+  new_state.max_id = mwb_top_sites_query_int64 (dbcon, MWB_TOP_SITES_MAX_SQL);
+
+  /* Fewer ids than before means the history was cleared */
+  rebuild = state.version != MWB_TOP_SITES_VERSION
+    || new_state.max_id < state.max_id
+    || !mwb_top_sites_load_pool (dbcon, pool);
+
+  if (rebuild)
+    {
+      mwb_top_sites_clear (pool);
+      new_state.last_visit_time
+        = mwb_top_sites_query_int64 (dbcon, MWB_TOP_SITES_MAX_VISIT_SQL);
+
+      if ((stmt = mwb_top_sites_prepare (dbcon, MWB_TOP_SITES_REBUILD_SQL)))
+        {
+          sqlite3_bind_int (stmt, 1, MWB_TOP_SITES_POOL);
+          mwb_top_sites_merge (pool, stmt);
+          sqlite3_finalize (stmt);
+        }
+    }
+  else if ((stmt = mwb_top_sites_prepare (dbcon, MWB_TOP_SITES_CHANGED_SQL)))
+    {
+      /* A visit is the only thing that raises visit_count, and it also
+         moves last_visit_time */
+      sqlite3_bind_int64 (stmt, 1, state.max_id);
+      sqlite3_bind_int64 (stmt, 2, state.last_visit_time);
+      new_state.last_visit_time = MAX (state.last_visit_time,
+                                       mwb_top_sites_merge (pool, stmt));
+      sqlite3_finalize (stmt);
+    }
+
+  mwb_top_sites_trim (pool);
+
+  mwb_top_sites_write (dbcon, pool);
+  mwb_top_sites_write_state (dbcon, &new_state);
+
+  mwb_top_sites_clear (pool);
+  g_array_free (pool, TRUE);
+
+  if (!mwb_top_sites_exec (dbcon, "COMMIT"))
+    {
+      mwb_top_sites_exec (dbcon, "ROLLBACK");
+      return FALSE;
+    }
+
+  return TRUE;
+}
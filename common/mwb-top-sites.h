@@ -0,0 +1,52 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* The most visited URLs kept ranked in a sidecar database, topsites.db
+   in the netpanel directory, attached to the places connection as
+   'topsites'. Each row says whether the page has a thumbnail and where
+   its favicon is, so showing the favorites is one scan of a few rows
+   with no sort and no file checks.
+
+   Updating only looks at the urls added or visited since the last
+   update, going by the highest id and last_visit_time seen, and does
+   nothing at all if neither the places file nor the thumbnails
+   directory changed. If urls were deleted the table is rebuilt. */
+
+#ifndef _MWB_TOP_SITES_H
+#define _MWB_TOP_SITES_H
+
+#include <glib.h>
+#include <sqlite3.h>
+
+G_BEGIN_DECLS
+
+/* Ranked by visit count, only the ones with a thumbnail are shown. The
+   favicon column is NULL unless the file exists. */
+#define MWB_TOP_SITES_SQL "SELECT url, title, favicon "\
+                          "FROM topsites.top_sites "\
+                          "WHERE has_thumbnail = 1 "\
+                          "ORDER BY rank LIMIT ?1"
+
+/* Attaches the sidecar to 'dbcon', the connection to 'places_db', and
+   brings it up to date */
+gboolean mwb_top_sites_update (sqlite3     *dbcon,
+                               const gchar *places_db);
+
+G_END_DECLS
+
+#endif /* _MWB_TOP_SITES_H */
@@ -0,0 +1,217 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <glib/gstdio.h>
+#include "mwb-trace.h"
+#include "mwb-stats.h"
+
+/* Must be a power of two */
+#define MWB_TRACE_RING_SIZE (1 << 16)
+
+typedef struct
+{
+  /* One more than the ring position the slot was last filled for, set
+     once the rest is written. 0 while it is being written. */
+  volatile gint seq;
+
+  const gchar  *name;
+  gint64        ts;
+  guint32       tid;
+  gchar         phase;
+} MwbTraceEvent;
+
+gboolean mwb_trace_enabled = FALSE;
+
+static MwbTraceEvent *mwb_trace_ring = NULL;
+/* Only ever incremented. Writers claim a slot with an atomic add so
+   threads never take a lock to record an event. */
+static volatile gint mwb_trace_ring_pos = 0;
+
+static gchar *mwb_trace_filename = NULL;
+static int mwb_trace_signal_pipe[2] = { -1, -1 };
+static GPollFunc mwb_trace_old_poll_func = NULL;
+
+static guint32
+mwb_trace_get_tid (void)
+{
+#ifdef SYS_gettid
+  return (guint32)syscall (SYS_gettid);
+#else
+  return (guint32)getpid ();
+#endif
+}
+
+void
+mwb_trace_event (const gchar *name, gchar phase)
+{
+  guint pos = (guint)g_atomic_int_exchange_and_add (&mwb_trace_ring_pos, 1);
+  MwbTraceEvent *event = mwb_trace_ring + (pos & (MWB_TRACE_RING_SIZE - 1));
+
+  g_atomic_int_set (&event->seq, 0);
+
+  event->name = name;
+  event->ts = mwb_stats_get_monotonic_time ();
+  event->tid = mwb_trace_get_tid ();
+  event->phase = phase;
+
+  g_atomic_int_set (&event->seq, (gint)(pos + 1));
+}
+
+/* Time spent blocked in poll() shows up as the gaps between work on
+   the main thread */
+static gint
+mwb_trace_poll (GPollFD *fds, guint nfds, gint timeout)
+{
+  gint ret;
+
+  mwb_trace_event ("main-loop-poll", 'B');
+  ret = mwb_trace_old_poll_func (fds, nfds, timeout);
+  mwb_trace_event ("main-loop-poll", 'E');
+
+  return ret;
+}
+
+void
+mwb_trace_dump (void)
+{
+  guint pos, start, i;
+  gboolean first = TRUE;
+  FILE *file;
+
+  if (!mwb_trace_enabled)
+    return;
+
+  if (!(file = g_fopen (mwb_trace_filename, "w")))
+    {
+      g_warning ("[netpanel] unable to write trace to %s",
+                 mwb_trace_filename);
+      return;
+    }
+
+  pos = (guint)g_atomic_int_get (&mwb_trace_ring_pos);
+  start = pos > MWB_TRACE_RING_SIZE ? pos - MWB_TRACE_RING_SIZE : 0;
+
+  fputs ("{\"traceEvents\":[\n", file);
+  for (i = start; i < pos; i++)
+    {
+      MwbTraceEvent *event
+        = mwb_trace_ring + (i & (MWB_TRACE_RING_SIZE - 1));
+      const gchar *name;
+      gint64 ts;
+      guint32 tid;
+      gchar phase;
+
+      /* Skip slots claimed but not filled in yet, which may still hold
+         an event from the previous time round the ring */
+      if (g_atomic_int_get (&event->seq) != (gint)(i + 1))
+        continue;
+
+      name = event->name;
+      ts = event->ts;
+      tid = event->tid;
+      phase = event->phase;
+
+      /* Or reclaimed while it was being copied */
+      if (g_atomic_int_get (&event->seq) != (gint)(i + 1))
+        continue;
+
+      fprintf (file,
+               "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%" G_GINT64_FORMAT
+               ",\"pid\":%d,\"tid\":%u}",
+               first ? "" : ",\n",
+               name, phase, ts, (int)getpid (), tid);
+      first = FALSE;
+    }
+  fputs ("\n]}\n", file);
+  fclose (file);
+
+  g_message ("[netpanel] trace written to %s", mwb_trace_filename);
+}
+
+static void
+mwb_trace_signal_handler (int signum)
+{
+  char c = 0;
+
+  /* Only async-signal-safe work here, the dump happens on the main
+     loop */
+  if (write (mwb_trace_signal_pipe[1], &c, 1) < 0)
+    return;
+}
+
+static gboolean
+mwb_trace_signal_cb (GIOChannel   *source,
+                     GIOCondition  condition,
+                     gpointer      data)
+{
+  char buf[16];
+
+  while (read (mwb_trace_signal_pipe[0], buf, sizeof (buf)) > 0);
+
+  mwb_trace_dump ();
+
+  return TRUE;
+}
+
+void
+mwb_trace_init (void)
+{
+  const gchar *env = g_getenv ("MWB_TRACE");
+  GIOChannel *channel;
+
+  if (!env || !*env || mwb_trace_enabled)
+    return;
+
+  if (g_str_equal (env, "1"))
+    mwb_trace_filename = g_strdup_printf ("%s/mwb-trace-%d.json",
+                                          g_get_tmp_dir (), (int)getpid ());
+  else
+    mwb_trace_filename = g_strdup (env);
+
+  mwb_trace_ring = g_new0 (MwbTraceEvent, MWB_TRACE_RING_SIZE);
+  mwb_trace_enabled = TRUE;
+
+  mwb_trace_old_poll_func = g_main_context_get_poll_func (NULL);
+  g_main_context_set_poll_func (NULL, mwb_trace_poll);
+
+  if (pipe (mwb_trace_signal_pipe) == 0)
+    {
+      fcntl (mwb_trace_signal_pipe[0], F_SETFL, O_NONBLOCK);
+      fcntl (mwb_trace_signal_pipe[1], F_SETFL, O_NONBLOCK);
+
+      channel = g_io_channel_unix_new (mwb_trace_signal_pipe[0]);
+      g_io_add_watch (channel, G_IO_IN, mwb_trace_signal_cb, NULL);
+      g_io_channel_unref (channel);
+
+      signal (SIGUSR1, mwb_trace_signal_handler);
+    }
+  else
+    g_warning ("[netpanel] unable to create trace signal pipe");
+
+  atexit (mwb_trace_dump);
+}
@@ -0,0 +1,58 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Begin/end event tracer. It does nothing unless $MWB_TRACE is set
+   when mwb_trace_init() runs, in which case events are recorded into
+   a ring buffer and written out in the Chrome trace event format at
+   exit and whenever the process gets SIGUSR1. $MWB_TRACE names the
+   output file, or is "1" for /tmp/mwb-trace-<pid>.json. The JSON can
+   be loaded into chrome://tracing. */
+
+#ifndef _MWB_TRACE_H
+#define _MWB_TRACE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Names must be string literals, only the pointer is recorded */
+#define MWB_TRACE_BEGIN(name)                   \
+  G_STMT_START {                                \
+    if (G_UNLIKELY (mwb_trace_enabled))         \
+      mwb_trace_event ((name), 'B');            \
+  } G_STMT_END
+
+#define MWB_TRACE_END(name)                     \
+  G_STMT_START {                                \
+    if (G_UNLIKELY (mwb_trace_enabled))         \
+      mwb_trace_event ((name), 'E');            \
+  } G_STMT_END
+
+extern gboolean mwb_trace_enabled;
+
+/* Call once from main() before entering the main loop */
+void mwb_trace_init (void);
+
+void mwb_trace_event (const gchar *name, gchar phase);
+
+/* Writes out the current contents of the ring buffer */
+void mwb_trace_dump (void);
+
+G_END_DECLS
+
+#endif /* _MWB_TRACE_H */
@@ -0,0 +1,118 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include "mwb-url-table.h"
+#include "mwb-utils.h"
+
+/* Keyed by the entries themselves, so growing the table reuses their
+   hashes and most mismatches are rejected without comparing strings */
+static GHashTable *mwb_url_table = NULL;
+
+static guint
+mwb_url_hash (gconstpointer key)
+{
+  return ((const MwbUrl *) key)->hash;
+}
+
+static gboolean
+mwb_url_equal (gconstpointer a, gconstpointer b)
+{
+  const MwbUrl *url_a = (const MwbUrl *) a;
+  const MwbUrl *url_b = (const MwbUrl *) b;
+
+  return url_a->hash == url_b->hash && !strcmp (url_a->str, url_b->str);
+}
+
+MwbUrl *
+mwb_url_intern (const gchar *str)
+{
+  MwbUrl key, *url;
+  gsize len;
+
+  if (G_UNLIKELY (mwb_url_table == NULL))
+    mwb_url_table = g_hash_table_new (mwb_url_hash, mwb_url_equal);
+
+  key.str = str;
+  key.hash = g_str_hash (str);
+
+  url = (MwbUrl *) g_hash_table_lookup (mwb_url_table, &key);
+  if (url)
+    return mwb_url_ref (url);
+
+  /* The string lives in the same block as the entry */
+  len = strlen (str);
+  url = (MwbUrl *) g_malloc (sizeof (MwbUrl) + len + 1);
+  memcpy (url + 1, str, len + 1);
+
+  url->str = (const gchar *) (url + 1);
+  url->hash = key.hash;
+  url->ref_count = 1;
+  url->asset_key = NULL;
+
+  g_hash_table_insert (mwb_url_table, url, url);
+
+  return url;
+}
+
+MwbUrl *
+mwb_url_ref (MwbUrl *url)
+{
+  url->ref_count++;
+
+  return url;
+}
+
+void
+mwb_url_unref (MwbUrl *url)
+{
+  if (--url->ref_count > 0)
+    return;
+
+  g_hash_table_remove (mwb_url_table, url);
+  g_free (url->asset_key);
+  g_free (url);
+}
+
+const gchar *
+mwb_url_get_asset_key (MwbUrl *url)
+{
+  if (!url->asset_key)
+    url->asset_key = g_compute_checksum_for_string (G_CHECKSUM_MD5,
+                                                    url->str, -1);
+
+  return url->asset_key;
+}
+
+gchar *
+mwb_url_get_cache_filename (MwbUrl      *url,
+                            const gchar *subdir,
+                            const gchar *suffix)
+{
+  gchar *filename = g_strconcat (mwb_url_get_asset_key (url), suffix, NULL);
+  gchar *path = g_build_filename (mwb_utils_get_netpanel_dir (),
+                                  subdir, filename, NULL);
+
+  g_free (filename);
+
+  return path;
+}
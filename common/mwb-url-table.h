@@ -0,0 +1,64 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* One shared, immutable entry per distinct URL. The tiles, buttons and
+   autocomplete rows showing a URL all hold a reference to the same
+   MwbUrl instead of their own copy of the string, and whatever is
+   derived from the URL, like the MD5 naming its cached thumbnail, is
+   worked out once per URL rather than once per lookup.
+
+   An entry lives as long as something holds a reference to it.
+   Interning the same string again while it is alive returns the same
+   entry, so two MwbUrls can be compared by pointer. Only to be used
+   from the main thread. */
+
+#ifndef _MWB_URL_TABLE_H
+#define _MWB_URL_TABLE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _MwbUrl MwbUrl;
+
+struct _MwbUrl
+{
+  /* Read-only */
+  const gchar *str;
+  guint        hash;
+
+  /*< private >*/
+  gint         ref_count;
+  gchar       *asset_key;
+};
+
+MwbUrl *mwb_url_intern (const gchar *str);
+MwbUrl *mwb_url_ref    (MwbUrl      *url);
+void    mwb_url_unref  (MwbUrl      *url);
+
+/* The MD5 the browser names the files it caches for the URL by */
+const gchar *mwb_url_get_asset_key (MwbUrl *url);
+
+/* Same as mwb_utils_get_cache_filename() without hashing the URL */
+gchar *mwb_url_get_cache_filename (MwbUrl      *url,
+                                   const gchar *subdir,
+                                   const gchar *suffix);
+
+G_END_DECLS
+
+#endif /* _MWB_URL_TABLE_H */
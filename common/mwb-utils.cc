@@ -172,6 +172,42 @@ mwb_utils_cursor_new_from_stock (const gchar *icon_name)
 
 #define NETPANEL_DIR ".config/internet-panel"
 
+const gchar *
+mwb_utils_get_netpanel_dir (void)
+{
+  static gchar *netpanel_dir = NULL;
+
+  if (G_UNLIKELY (netpanel_dir == NULL))
+    {
+      const gchar *override = g_getenv ("MWB_NETPANEL_DIR");
+
+      if (override && *override)
+        netpanel_dir = g_strdup (override);
+      else
+        netpanel_dir = g_build_filename (g_get_home_dir (),
+                                         NETPANEL_DIR,
+                                         NULL);
+    }
+
+  return netpanel_dir;
+}
+
+gchar *
+mwb_utils_get_cache_filename (const gchar *subdir,
+                              const gchar *url,
+                              const gchar *suffix)
+{
+  gchar *csum = g_compute_checksum_for_string (G_CHECKSUM_MD5, url, -1);
+  gchar *filename = g_strconcat (csum, suffix, NULL);
+  gchar *path = g_build_filename (mwb_utils_get_netpanel_dir (),
+                                  subdir, filename, NULL);
+
+  g_free (csum);
+  g_free (filename);
+
+  return path;
+}
+
 gchar*
 mwb_utils_places_db_get_filename()
 {
@@ -184,8 +220,7 @@ mwb_utils_places_db_get_filename()
   gchar *path = NULL;
   guint i, length = 0;
 
-  result = g_build_filename(g_get_home_dir(),
-                            NETPANEL_DIR, 
+  result = g_build_filename(mwb_utils_get_netpanel_dir (),
                             "chromium.db", 
                             NULL);
   return result;
@@ -245,14 +280,14 @@ mwb_utils_places_db_get_filename()
   return result;
 }
 
-int
-mwb_utils_places_db_connect(const gchar *places_db, sqlite3 **dbcon)
+static int
+mwb_utils_places_db_open (const gchar *places_db, sqlite3 **dbcon, int flags)
 {
   if (!places_db)
     return -1;
 
   g_assert (dbcon != NULL);
-  gint rc = sqlite3_open(places_db, dbcon);
+  gint rc = sqlite3_open_v2(places_db, dbcon, flags, NULL);
   if (rc)
     {
       g_warning ("[netpanel] unable to open places db: %s, places=%s\n",
@@ -266,6 +301,20 @@ mwb_utils_places_db_connect(const gchar *places_db, sqlite3 **dbcon)
   return 0;
 }
 
+int
+mwb_utils_places_db_connect(const gchar *places_db, sqlite3 **dbcon)
+{
+  return mwb_utils_places_db_open (places_db, dbcon,
+                                   SQLITE_OPEN_READWRITE
+                                   | SQLITE_OPEN_CREATE);
+}
+
+int
+mwb_utils_places_db_connect_readonly(const gchar *places_db, sqlite3 **dbcon)
+{
+  return mwb_utils_places_db_open (places_db, dbcon, SQLITE_OPEN_READONLY);
+}
+
 void 
 mwb_utils_places_db_close(sqlite3 *dbcon)
 {
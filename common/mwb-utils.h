@@ -82,12 +82,29 @@ mwb_utils_pixbuf_new_from_stock (const gchar *icon_name, gint size);
 GdkCursor *
 mwb_utils_cursor_new_from_stock (const gchar *icon_name);
 
+/* ~/.config/internet-panel unless overridden by $MWB_NETPANEL_DIR, so
+   benchmarks can point the panel at a generated profile */
+const gchar *
+mwb_utils_get_netpanel_dir (void);
+
+/* The browser caches thumbnails and favicons in the netpanel directory
+   named by the MD5 of their URL, eg. ("thumbnails", url, ".png") */
+gchar *
+mwb_utils_get_cache_filename (const gchar *subdir,
+                              const gchar *url,
+                              const gchar *suffix);
+
 gchar* 
 mwb_utils_places_db_get_filename ();
 
 int 
 mwb_utils_places_db_connect (const gchar *places_db, sqlite3 **dbcon);
 
+/* For the loaders that only ever read the browser's tables */
+int
+mwb_utils_places_db_connect_readonly (const gchar *places_db,
+                                      sqlite3 **dbcon);
+
 void 
 mwb_utils_places_db_close (sqlite3 *dbcon);
 
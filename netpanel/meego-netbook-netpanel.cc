@@ -36,13 +36,21 @@ extern "C" {
 #include <meego-panel/mpl-panel-client.h>
 #include "meego-netbook-netpanel.h"
 #include "mnb-netpanel-bar.h"
+#include "mnb-netpanel-launcher.h"
+#include "mnb-netpanel-model.h"
 #include "mnb-netpanel-scrollview.h"
+#include "mwb-assets.h"
+#include "mwb-lifecycle.h"
 #include "mwb-utils.h"
+#include "mwb-stats.h"
+#include "mwb-trace.h"
+#include "mwb-texture-budget.h"
+#include "mwb-url-table.h"
 }
 
 /* Number of favorites columns to display */
 #define NR_FAVORITE_MAX 16
-#define NR_FAVORITE 9
+#define NR_FAVORITE MNB_NETPANEL_MODEL_N_FAVORITES
 
 /* FIXME: Replace with stylable spacing */
 #define COL_SPACING 0
@@ -55,10 +63,6 @@ extern "C" {
 #define START_PAGE "meego://start/"
 #define NEWTAB_URL "http://"
 
-#define FAVORITE_SQL  "SELECT url, title FROM urls " \
-                      "ORDER BY visit_count DESC LIMIT 9"
-#define TAB_SQL       "SELECT tab_id, url, title FROM current_tabs " \
-                      "LIMIT 256"
 
 #define CMD_SELECT_TAB 1
 #define CMD_NEW_TAB    2
@@ -67,7 +71,8 @@ static gboolean
 meego_netbook_netpanel_open_tab (MeegoNetbookNetpanel *self, const gint type, void *data);
 
 static void
-meego_netbook_netpanel_restore_tab (MeegoNetbookNetpanel *self, gchar* tab_url);
+meego_netbook_netpanel_restore_tab (MeegoNetbookNetpanel *self,
+                                    const gchar *tab_url);
 
 G_DEFINE_TYPE (MeegoNetbookNetpanel, meego_netbook_netpanel, MX_TYPE_WIDGET)
 
@@ -94,17 +99,20 @@ struct _MeegoNetbookNetpanelPrivate
   MxWidget    **tabs;
   MxWidget    **tab_titles;
 
-  gchar         **fav_urls;
+  MwbUrl        **fav_urls;
   gchar         **fav_titles;
 
-  GList          *session_urls;
-
   MplPanelClient *panel_client;
 
   /*  SQLite connection */
   gchar          *places_db;
   sqlite3        *dbcon;
 
+  /* The tiles are built from 'snapshots' while the panel is shown, a
+     section without one yet is filled in when the model has it */
+  MnbNetpanelModel         *model;
+  MnbNetpanelModelSnapshot *snapshots[MNB_NETPANEL_MODEL_N_SECTIONS];
+
   gchar          *search_url;
 };
 
@@ -125,7 +133,7 @@ meego_netbook_netpanel_dispose (GObject *object)
   if (priv->fav_urls)
     {
       for (i = 0; i < priv->n_favs; i++)
-        g_free (priv->fav_urls[i]);
+        mwb_url_unref (priv->fav_urls[i]);
       g_free (priv->fav_urls);
       priv->fav_urls = NULL;
     }
@@ -174,18 +182,25 @@ meego_netbook_netpanel_dispose (GObject *object)
       priv->places_db = NULL;
     }
 
+  for (i = 0; i < MNB_NETPANEL_MODEL_N_SECTIONS; i++)
+    if (priv->snapshots[i])
+      {
+        mnb_netpanel_model_snapshot_unref (priv->snapshots[i]);
+        priv->snapshots[i] = NULL;
+      }
+
+  if (priv->model)
+    {
+      mnb_netpanel_model_free (priv->model);
+      priv->model = NULL;
+    }
+
   if (priv->search_url)
     {
       g_free (priv->search_url);
       priv->search_url = NULL;
     }
 
-  while (priv->session_urls)
-    {
-      g_free (priv->session_urls->data);
-      priv->session_urls = g_list_delete_link (priv->session_urls,
-                                               priv->session_urls);
-    }
 
   G_OBJECT_CLASS (meego_netbook_netpanel_parent_class)->dispose (object);
 }
@@ -209,6 +224,8 @@ meego_netbook_netpanel_allocate (ClutterActor           *actor,
   guint i;
   MeegoNetbookNetpanelPrivate *priv = MEEGO_NETBOOK_NETPANEL (actor)->priv;
 
+  MWB_TRACE_BEGIN ("netpanel-allocate");
+
   CLUTTER_ACTOR_CLASS (meego_netbook_netpanel_parent_class)->
     allocate (actor, box, flags);
 
@@ -328,6 +345,8 @@ meego_netbook_netpanel_allocate (ClutterActor           *actor,
       clutter_actor_allocate (CLUTTER_ACTOR (priv->favs_view),
                               &child_box, flags);
     }
+
+  MWB_TRACE_END ("netpanel-allocate");
 }
 
 static void
@@ -437,7 +456,7 @@ meego_netbook_netpanel_get_preferred_height (ClutterActor *self,
 }
 
 static void
-meego_netbook_netpanel_paint (ClutterActor *actor)
+meego_netbook_netpanel_paint_children (ClutterActor *actor)
 {
   MeegoNetbookNetpanelPrivate *priv = MEEGO_NETBOOK_NETPANEL (actor)->priv;
 
@@ -457,10 +476,32 @@ meego_netbook_netpanel_paint (ClutterActor *actor)
   clutter_actor_paint (CLUTTER_ACTOR (priv->entry_table));
 }
 
+static void
+meego_netbook_netpanel_paint (ClutterActor *actor)
+{
+  MWB_TRACE_BEGIN ("netpanel-paint");
+
+  meego_netbook_netpanel_paint_children (actor);
+
+  mwb_stats_first_paint ();
+
+  MWB_TRACE_END ("netpanel-paint");
+}
+
+/* Only the views and the entry take pointer events, the section
+   labels and the background are left out of the pick buffer */
 static void
 meego_netbook_netpanel_pick (ClutterActor *actor, const ClutterColor *color)
 {
-  meego_netbook_netpanel_paint (actor);
+  MeegoNetbookNetpanelPrivate *priv = MEEGO_NETBOOK_NETPANEL (actor)->priv;
+
+  if (priv->tabs_view)
+    clutter_actor_paint (CLUTTER_ACTOR (priv->tabs_view));
+  if (priv->favs_view)
+    clutter_actor_paint (CLUTTER_ACTOR (priv->favs_view));
+
+  /* The entry goes last so the automagic dropdown is on top */
+  clutter_actor_paint (CLUTTER_ACTOR (priv->entry_table));
 }
 
 void
@@ -487,11 +528,14 @@ meego_netbook_netpanel_launch_url (MeegoNetbookNetpanel *netpanel,
 {
   MeegoNetbookNetpanelPrivate *priv = MEEGO_NETBOOK_NETPANEL (netpanel)->priv;
 
-  gchar *exec, *ptr, *remaining, *esc_url=NULL;
-  gchar *prefix = g_strdup ("");
+  gint64 start = mwb_stats_get_monotonic_time ();
+  gchar *target = NULL;
+  gboolean searched = FALSE;
 
   if(!bool_exec)
     {
+      gchar *esc_url;
+
       if (strlen(url)>0 && !strstr (url, "."))
         {
           gchar *temp = g_strdup(priv->search_url);
@@ -500,68 +544,51 @@ meego_netbook_netpanel_launch_url (MeegoNetbookNetpanel *netpanel,
             {
               gchar *s2 = &priv->search_url[(size_t)(s1-temp)+strlen("{searchTerms}")];
               *s1='\0';
-              esc_url = g_strdup_printf("%s%s%s", temp, url, s2);
-              if(strchr (esc_url, ' '))
+              target = g_strdup_printf("%s%s%s", temp, url, s2);
+              if(strchr (target, ' '))
                 {
-                  g_strdelimit(esc_url, " ", '+');
+                  g_strdelimit(target, " ", '+');
                 }
+              searched = TRUE;
             }
           g_free(temp);
         }
 
-      if(!esc_url)
+      if(!target)
         {
-          esc_url = g_strescape (url, NULL);
+          target = g_strdup (url);
         }
-      if(!g_str_has_prefix(esc_url, "http://") && !g_str_has_prefix(esc_url, "https://"))
+      if(!g_str_has_prefix(target, "http://") && !g_str_has_prefix(target, "https://"))
         {
-          gchar *tmp_url = g_strdup_printf("%s%s", "http://", esc_url);
-          g_free(esc_url);
-          esc_url = tmp_url;
+          gchar *tmp_url = g_strdup_printf("%s%s", "http://", target);
+          g_free(target);
+          target = tmp_url;
         }
+
+      /* The browser expects typed URLs escaped on its FIFO */
+      esc_url = searched ? g_strdup (target) : g_strescape (target, NULL);
       if(meego_netbook_netpanel_open_tab(netpanel, CMD_NEW_TAB, (void*)esc_url))
         {
           g_free(esc_url);
+          g_free(target);
           return;
         }
+      g_free(esc_url);
     }
-  else
-    {
-      if (!url || url[0] == '\0')
-        esc_url = g_strdup ("http://");
-      else
-        esc_url = g_strescape (url, NULL);
-    }
-
-  /* Change any % to %% to work around g_app_info_launch */
-  remaining = esc_url;
-  while ((ptr = strchr (remaining, '%')))
-    {
-      gchar *tmp = prefix;
-      *ptr = '\0';
-      prefix = g_strdup_printf ("%s%s%%%%", tmp, remaining);
-      g_free (tmp);
-      *ptr = '%';
-      remaining = ptr + 1;
-    }
-
-  exec = g_strdup_printf ("gvfs-open \"%s%s\"",
-                          prefix, remaining);
+  else if (url && url[0] != '\0')
+    target = g_strdup (url);
 
-//   printf("exec %s\n", exec);
-
-  g_free (prefix);
-
-  if (priv->panel_client)
+  if (!mnb_netpanel_launcher_launch (priv->panel_client, target))
+    g_warning (G_STRLOC ": Error launching browser for url '%s'",
+               target ? target : "");
+  else
     {
-      if (!mpl_panel_client_launch_application (priv->panel_client, exec))
-        g_warning (G_STRLOC ": Error launching browser for url '%s'", esc_url);
-      else
+      mwb_stats_span_add (MWB_STATS_SPAN_LAUNCH, start);
+      if (priv->panel_client)
         mpl_panel_client_hide (priv->panel_client);
     }
 
-  g_free (exec);
-  g_free (esc_url);
+  g_free (target);
 }
 
 static void
@@ -582,7 +609,7 @@ fav_button_clicked_cb (MxWidget *button, MeegoNetbookNetpanel *self)
   MeegoNetbookNetpanelPrivate *priv = self->priv;
   guint fav = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (button), "fav"));
 
-  meego_netbook_netpanel_launch_url (self, priv->fav_urls[fav], FALSE);
+  meego_netbook_netpanel_launch_url (self, priv->fav_urls[fav]->str, FALSE);
 }
 
 static void
@@ -736,7 +763,8 @@ meego_netbook_netpanel_open_tab (MeegoNetbookNetpanel *self, const gint type, vo
 
       g_io_channel_unref (output);
       output = NULL;
-      mpl_panel_client_hide (priv->panel_client);
+      if (priv->panel_client)
+        mpl_panel_client_hide (priv->panel_client);
       g_free(plugin_pipe);
       return TRUE;
     }
@@ -796,7 +824,8 @@ meego_netbook_netpanel_select_tab (MeegoNetbookNetpanel *self, gint tab_id)
 */
 
 static void
-meego_netbook_netpanel_restore_tab (MeegoNetbookNetpanel *self, gchar* tab_url)
+meego_netbook_netpanel_restore_tab (MeegoNetbookNetpanel *self,
+                                    const gchar *tab_url)
 {
   MeegoNetbookNetpanelPrivate *priv = MEEGO_NETBOOK_NETPANEL (self)->priv;
 
@@ -809,7 +838,7 @@ meego_netbook_netpanel_restore_tab (MeegoNetbookNetpanel *self, gchar* tab_url)
   // FIXME: need define the protocol of startup command
   if (!g_file_test (plugin_cmd, G_FILE_TEST_EXISTS))
     {
-      g_file_set_contents (plugin_cmd, (gchar *)tab_url, strlen(tab_url), NULL);
+      g_file_set_contents (plugin_cmd, tab_url, strlen(tab_url), NULL);
     }
   // Launch the Chrome to restore tabs and execute startup commands
   meego_netbook_netpanel_launch_url(self, "", TRUE);
@@ -821,12 +850,12 @@ session_tab_button_clicked_cb (MxWidget *button, MeegoNetbookNetpanel *self)
 {
   MeegoNetbookNetpanelPrivate *priv = MEEGO_NETBOOK_NETPANEL (self)->priv;
 
-  gchar *tab_url = (gchar *)g_object_get_data (G_OBJECT (button), "url");
+  MwbUrl *tab_url = (MwbUrl *)g_object_get_data (G_OBJECT (button), "url");
   guint tab_id = (guint)g_object_get_data (G_OBJECT (button), "tab_id");
 
   if (!meego_netbook_netpanel_open_tab (self, CMD_SELECT_TAB, (void*)&tab_id))
     {
-      meego_netbook_netpanel_restore_tab (self, tab_url);
+      meego_netbook_netpanel_restore_tab (self, tab_url->str);
     }
 }
 
@@ -889,85 +918,84 @@ create_favs_placeholder (MeegoNetbookNetpanel *self)
   clutter_actor_set_parent (CLUTTER_ACTOR (bin), CLUTTER_ACTOR (self));
 }
 
+/* Owned by the tile's vbox so it lives as long as the textures can
+   be evicted and reloaded */
 typedef struct _TextureData{
   ClutterActor *tex;
   ClutterActor *favi;
-  gchar *url;
+  MwbUrl *url;
   gchar *ff;
+  guint load_source;
+  MwbTextureBudgetEntry *budget;
+  /* Decoded ahead of time by the model, used for the first load only */
+  GdkPixbuf *thumbnail;
+  GdkPixbuf *favicon;
 }TextureData;
 
-#define NETPANEL_DIR ".config/internet-panel"
+/* Images shown on many tiles, like the fallback thumbnail, are decoded
+   once and shared */
+static void
+set_image_from_asset (ClutterActor *image, const gchar *name)
+{
+  CoglHandle texture = mwb_assets_get_texture (name);
 
-static gchar *
-get_favicon_filename(MeegoNetbookNetpanel *self, const char *url)
+  if (texture == COGL_INVALID_HANDLE)
+    return;
+
+  mx_image_set_from_cogl_texture (MX_IMAGE (image), texture);
+  cogl_handle_unref (texture);
+}
+
+static gboolean
+set_image_from_pixbuf (ClutterActor *image, GdkPixbuf *pixbuf)
 {
-  MeegoNetbookNetpanelPrivate *priv = self->priv;
-  gchar *result = NULL;
-
-  gchar *id_stmt = g_strdup_printf("select favicon_id from urls where url='%s'", url);
-  sqlite3_stmt *f1_stmt = NULL;
-  int rc = sqlite3_prepare_v2 (priv->dbcon,
-                           id_stmt,
-                           -1,
-                           &f1_stmt, NULL);
-  int f_id = 0;
-  if (!rc && sqlite3_step (f1_stmt) == SQLITE_ROW)
-    {
-      f_id = sqlite3_column_int(f1_stmt, 0);
-    }
-  sqlite3_finalize(f1_stmt);
+  GError *error = NULL;
 
-  gchar *fv_stmt = g_strdup_printf("select url from favicons where id=%d", f_id);
-  if( f_id!= 0 )
+  mx_image_set_from_data (MX_IMAGE (image),
+                          gdk_pixbuf_get_pixels (pixbuf),
+                          gdk_pixbuf_get_has_alpha (pixbuf)
+                          ? COGL_PIXEL_FORMAT_RGBA_8888
+                          : COGL_PIXEL_FORMAT_RGB_888,
+                          gdk_pixbuf_get_width (pixbuf),
+                          gdk_pixbuf_get_height (pixbuf),
+                          gdk_pixbuf_get_rowstride (pixbuf),
+                          &error);
+  if (error)
     {
-      sqlite3_stmt *f2_stmt = NULL;
-      rc = sqlite3_prepare_v2 (priv->dbcon,
-                               fv_stmt,
-                               -1,
-                               &f2_stmt, NULL);
-      if (!rc && sqlite3_step (f2_stmt) == SQLITE_ROW)
-        {
-          gchar *csum = g_compute_checksum_for_string (G_CHECKSUM_MD5,
-                                (gchar*)sqlite3_column_text(f2_stmt, 0), -1);
-          gchar *thumbnail_filename = g_strconcat (csum, ".ico", NULL);
-          result = g_build_filename (g_get_home_dir (),
-                                     NETPANEL_DIR,
-                                     "favicons",
-                                     thumbnail_filename,
-                                     NULL);
-          g_free(csum);
-          g_free(thumbnail_filename);
-        }
-      sqlite3_finalize(f2_stmt);
+      g_warning ("[netpanel] unable to upload image: %s", error->message);
+      g_error_free (error);
+      return FALSE;
     }
 
-  g_free(id_stmt);
-  g_free(fv_stmt);
-
-  return result;
+  return TRUE;
 }
 
 static gboolean
 add_texture_to_scrollview(void*data)
 {
 
+  TextureData *tex_data = (TextureData*)data;
   ClutterActor *tex = ((TextureData*)data)->tex;
   ClutterActor *favi = ((TextureData*)data)->favi;
-  gchar *url = ((TextureData*)data)->url;
+  MwbUrl *url = ((TextureData*)data)->url;
   gchar *ff = ((TextureData*)data)->ff;
 
-  gchar *csum = g_compute_checksum_for_string (G_CHECKSUM_MD5, url, -1);
-  gchar *thumbnail_filename = g_strconcat (csum, ".png", NULL);
-  gchar *path = g_build_filename (g_get_home_dir (),
-                                  NETPANEL_DIR,
-                                  "thumbnails",
-                                  thumbnail_filename,
-                                  NULL);
-  g_free(csum);
-  g_free(thumbnail_filename);
+  mwb_stats_wakeup (MWB_STATS_WAKEUP_TEXTURE_LOAD);
+
+  gchar *path = mwb_url_get_cache_filename (url, "thumbnails", ".png");
   GError *error = NULL;
+  gint64 decode_start = mwb_stats_get_monotonic_time ();
+  gsize bytes = 0;
+
+  MWB_TRACE_BEGIN ("add-texture-to-scrollview");
 
-  if (path)
+  if (tex_data->thumbnail &&
+      set_image_from_pixbuf (tex, tex_data->thumbnail))
+    {
+      bytes += CELL_WIDTH * CELL_HEIGHT * 4;
+      g_free (path);
+    }
+  else if (path)
     {
       mx_image_set_from_file_at_size (MX_IMAGE (tex), path,
                                       CELL_WIDTH, CELL_HEIGHT,
@@ -979,24 +1007,17 @@ add_texture_to_scrollview(void*data)
                      error->message);
           g_error_free (error);
         }
+      else
+        bytes += CELL_WIDTH * CELL_HEIGHT * 4;
     }
   if (!path || error)
-    {
-      error = NULL;
-      mx_image_set_from_file_at_size (MX_IMAGE (tex),
-                                      THEMEDIR "/fallback-page.png",
-                                      CELL_WIDTH, CELL_HEIGHT,
-                                      &error);
-      if (error)
-        {
-          g_warning ("[netpanel] unable to open fallback thumbnail: %s\n",
-                     error->message);
-          g_error_free (error);
-        }
-    }
+    set_image_from_asset (tex, "fallback-page.png");
 
   error = NULL;
-  if(ff)
+  if (tex_data->favicon &&
+      set_image_from_pixbuf (favi, tex_data->favicon))
+    bytes += FAVI_SIZE * FAVI_SIZE * 4;
+  else if(ff)
     {
       mx_image_set_from_file_at_size (MX_IMAGE (favi), ff,
                                       FAVI_SIZE, FAVI_SIZE,
@@ -1007,18 +1028,75 @@ add_texture_to_scrollview(void*data)
                      error->message);
           g_error_free (error);
         }
+      else
+        bytes += FAVI_SIZE * FAVI_SIZE * 4;
+    }
+
+  /* Reloading after an eviction decodes the files again */
+  if (tex_data->thumbnail)
+    {
+      g_object_unref (tex_data->thumbnail);
+      tex_data->thumbnail = NULL;
+    }
+  if (tex_data->favicon)
+    {
+      g_object_unref (tex_data->favicon);
+      tex_data->favicon = NULL;
     }
 
-  g_free(url);
-  g_free(ff);
-  g_free(data);
+  tex_data->load_source = 0;
+  mwb_texture_budget_set_bytes (tex_data->budget, bytes);
+
+  mwb_stats_span_add (MWB_STATS_SPAN_TEXTURE_DECODE, decode_start);
+
+  MWB_TRACE_END ("add-texture-to-scrollview");
+
   return FALSE;
 }
 
+/* Called when the tile has been offscreen for a while and the texture
+   budget is exceeded. It gets reloaded by add_texture_to_scrollview
+   when it next scrolls into view. */
+static void
+texture_data_evict (gpointer data)
+{
+  TextureData *tex_data = (TextureData*)data;
+
+  mx_image_clear (MX_IMAGE (tex_data->tex));
+  if (tex_data->ff)
+    mx_image_clear (MX_IMAGE (tex_data->favi));
+}
+
+static void
+texture_data_reload (gpointer data)
+{
+  add_texture_to_scrollview (data);
+}
+
+static void
+texture_data_free (gpointer data)
+{
+  TextureData *tex_data = (TextureData*)data;
+
+  if (tex_data->load_source)
+    g_source_remove (tex_data->load_source);
+  mwb_texture_budget_remove (tex_data->budget);
+
+  if (tex_data->thumbnail)
+    g_object_unref (tex_data->thumbnail);
+  if (tex_data->favicon)
+    g_object_unref (tex_data->favicon);
+  mwb_url_unref (tex_data->url);
+  g_free (tex_data->ff);
+  g_free (tex_data);
+}
+
 static MxWidget *
 add_thumbnail_to_scrollview (MnbNetpanelScrollview *scrollview,
-                             const gchar *url, const gchar *title,
-                             const gchar *favicon_filename, const int priority)
+                             MwbUrl *url, const gchar *title,
+                             const gchar *favicon_filename,
+                             GdkPixbuf *thumbnail, GdkPixbuf *favicon,
+                             const int priority)
 {
   GError *error = NULL;
   ClutterActor *vbox, *hbox;
@@ -1027,7 +1105,7 @@ add_thumbnail_to_scrollview (MnbNetpanelScrollview *scrollview,
   gchar *path;
   gboolean new_tab = FALSE;
 
-  if (!title && !strcmp (url, START_PAGE))
+  if (!title && !strcmp (url->str, START_PAGE))
     {
       title = _("New tab");
       new_tab = TRUE;
@@ -1064,57 +1142,67 @@ add_thumbnail_to_scrollview (MnbNetpanelScrollview *scrollview,
   clutter_container_add_actor (CLUTTER_CONTAINER (hbox), favi_tex);
 
   if (!title)
-    title = url;
+    title = url->str;
   label = mx_label_new_with_text (title);
   clutter_actor_set_name (label, "title");
   clutter_container_add_actor (CLUTTER_CONTAINER (hbox), label);
 
-  mnb_netpanel_scrollview_add_item (scrollview, 0, vbox);
+  mnb_netpanel_scrollview_add_item (scrollview, 0, vbox, button);
 
   TextureData *tex_data = (TextureData*) g_malloc0 (sizeof (TextureData));
   tex_data->tex = tex;
   tex_data->favi = favi_tex;
-  tex_data->url = g_strdup (url);
+  tex_data->url = mwb_url_ref (url);
   tex_data->ff = g_strdup (favicon_filename);
-  clutter_threads_add_idle_full (priority, add_texture_to_scrollview,
-                                 (void*) tex_data, NULL);
+  if (thumbnail)
+    tex_data->thumbnail = (GdkPixbuf*) g_object_ref (thumbnail);
+  if (favicon)
+    tex_data->favicon = (GdkPixbuf*) g_object_ref (favicon);
+  tex_data->budget = mwb_texture_budget_add (0, FALSE,
+                                             texture_data_evict,
+                                             texture_data_reload,
+                                             tex_data);
+  g_object_set_data_full (G_OBJECT (vbox), "texture-data",
+                          tex_data, texture_data_free);
+  mnb_netpanel_scrollview_set_item_budget (scrollview, vbox,
+                                           tex_data->budget);
+  tex_data->load_source
+    = clutter_threads_add_idle_full (priority, add_texture_to_scrollview,
+                                     (void*) tex_data, NULL);
 
   return MX_WIDGET (button);
 }
 
 static void
-favs_exception (void *context, int errno)
-{
-  MeegoNetbookNetpanel *self = (MeegoNetbookNetpanel*)context;
-  MeegoNetbookNetpanelPrivate *priv = self->priv;
-
-  create_favs_placeholder(self);
-}
-
-static void
-favs_received (void *context, const char* url, const char *title, const int priority)
+favs_received (void *context, const MnbNetpanelModelItem *item,
+               const int priority)
 {
   MeegoNetbookNetpanel *self = (MeegoNetbookNetpanel*)context;
   MeegoNetbookNetpanelPrivate *priv = self->priv;
 
   MxWidget *button;
   MnbNetpanelScrollview *scrollview;
+  MwbUrl *url;
 
   scrollview = MNB_NETPANEL_SCROLLVIEW (priv->favs_view);
 
   // it is possible that when this callback is called
   // the scrollview is destroied by hide
-  if (!scrollview)
+  if (!scrollview || !item->url)
     return;
 
-  gchar *favicon_filename = get_favicon_filename(self, url);
-  button = add_thumbnail_to_scrollview (scrollview, url, title, favicon_filename,  priority);
-  g_free(favicon_filename);
+  url = mwb_url_intern (item->url);
+  button = add_thumbnail_to_scrollview (scrollview, url, item->title,
+                                        item->favicon_filename,
+                                        item->thumbnail, item->favicon,
+                                        priority);
 
-  if (button)
+  if (!button)
+    mwb_url_unref (url);
+  else
     {
-      priv->fav_urls[priv->n_favs] = g_strdup (url);
-      priv->fav_titles[priv->n_favs] = g_strdup (title);
+      priv->fav_urls[priv->n_favs] = url;
+      priv->fav_titles[priv->n_favs] = g_strdup (item->title);
 
       g_object_set_data (G_OBJECT (button), "fav", GUINT_TO_POINTER (priv->n_favs));
       g_signal_connect (button, "clicked",
@@ -1132,23 +1220,13 @@ static void tabs_exception(void* context, int errno)
   ClutterActor *vbox, *hbox;
   ClutterActor *button, *tex;
   ClutterActor *label, *favi_tex;
-  GError *error = NULL;
 
   vbox = mx_box_layout_new ();
   mx_box_layout_set_orientation (MX_BOX_LAYOUT (vbox),
                                  MX_ORIENTATION_VERTICAL);
 
   tex = mx_image_new ();
-  mx_image_set_from_file_at_size (MX_IMAGE (tex),
-                                  THEMEDIR "/newtab-thumbnail.png",
-                                  CELL_WIDTH, CELL_HEIGHT,
-                                  &error);
-  if (error)
-    {
-      g_warning ("[netpanel] unable to open new tab thumbnail: %s\n",
-                 error->message);
-      g_error_free (error);
-    }
+  set_image_from_asset (tex, "newtab-thumbnail.png");
 
   button = mx_button_new ();
   mx_stylable_set_style_class (MX_STYLABLE (button), "weblink");
@@ -1172,13 +1250,12 @@ static void tabs_exception(void* context, int errno)
   clutter_actor_set_name (label, "title");
   clutter_container_add_actor (CLUTTER_CONTAINER (hbox), label);
 
-  mnb_netpanel_scrollview_add_item (scrollview, 0, vbox);
+  mnb_netpanel_scrollview_add_item (scrollview, 0, vbox, button);
 }
 
-static void tabs_received(void* context, int tab_id,
-                                     const char* url,
-                                     const char* title,
-                                     const int priority)
+static void tabs_received(void* context,
+                          const MnbNetpanelModelItem *item,
+                          const int priority)
 {
     MeegoNetbookNetpanel* self = (MeegoNetbookNetpanel*)context;
     MeegoNetbookNetpanelPrivate *priv = self->priv;
@@ -1187,32 +1264,32 @@ static void tabs_received(void* context, int tab_id,
     if (!scrollview)
       return;
 
-    if (url)
+    if (item->url)
       {
         MxWidget *button;
+        MwbUrl *url;
 
-        if (!strcmp (url, "NULL") || (url[0] == '\0'))
-          {
-            url = g_strdup (START_PAGE);
-          }
-
-        gchar *prev_url = (gchar *)malloc(strlen(url) + 3 + 8);
-        //sprintf(prev_url, "%s#%d,%d", url, tab_id, navigation_index);
-        sprintf(prev_url, "%s", url);
+        if (!strcmp (item->url, "NULL") || (item->url[0] == '\0'))
+          url = mwb_url_intern (START_PAGE);
+        else
+          url = mwb_url_intern (item->url);
 
-        gchar *favicon_filename = get_favicon_filename(self, url);
-        button = add_thumbnail_to_scrollview (scrollview, url, title, favicon_filename,  priority);
-        g_free(favicon_filename);
-        //free(prev_url);
+        button = add_thumbnail_to_scrollview (scrollview, url, item->title,
+                                              item->favicon_filename,
+                                              item->thumbnail, item->favicon,
+                                              priority);
 
+        /* The button keeps the URL for restoring the tab */
         if (button)
         {
-            g_object_set_data (G_OBJECT (button), "url", (char*)prev_url);
-            g_object_set_data (G_OBJECT (button), "tab_id", (void*)tab_id);
+            g_object_set_data_full (G_OBJECT (button), "url", url,
+                                    (GDestroyNotify) mwb_url_unref);
+            g_object_set_data (G_OBJECT (button), "tab_id", (void*)item->tab_id);
             g_signal_connect (button, "clicked",
                               G_CALLBACK (session_tab_button_clicked_cb), self);
-            priv->session_urls = g_list_prepend (priv->session_urls, (char*)prev_url);
         }
+        else
+          mwb_url_unref (url);
     }
 }
 
@@ -1226,43 +1303,27 @@ create_tabs(MeegoNetbookNetpanel *self)
   if (!priv->favs_view)
     create_favs_placeholder (self);
 
-
-  sqlite3_stmt *tab_stmt;
-  int rc = sqlite3_prepare_v2 (priv->dbcon,
-                           TAB_SQL,
-                           -1,
-                           &tab_stmt, NULL);
-  if (rc)
-    g_warning ("[netpanel] sqlite3_prepare_v2():tab_stmt %s",
-               sqlite3_errmsg(priv->dbcon));
+  GArray *tabs = priv->snapshots[MNB_NETPANEL_MODEL_TABS]->items;
+  guint i;
 
   int priority = G_PRIORITY_DEFAULT_IDLE - NR_FAVORITE - DISPLAY_TABS_MAX;
-  if (priv->dbcon && tab_stmt && sqlite3_step (tab_stmt) == SQLITE_ROW)
-    {
-      do
-        {
-          priority = ++priority>(G_PRIORITY_DEFAULT_IDLE-NR_FAVORITE)?G_PRIORITY_DEFAULT_IDLE:priority;
-          tabs_received (self,
-                         sqlite3_column_int(tab_stmt, 0),
-                         (gchar*)sqlite3_column_text(tab_stmt, 1),
-                         (gchar*)sqlite3_column_text(tab_stmt, 2),
-                         priority);
-        }
-      while (sqlite3_step (tab_stmt) == SQLITE_ROW);
-    }
-  else
+  for (i = 0; i < tabs->len; i++)
     {
-      tabs_exception (self, 0);
+      priority = ++priority>(G_PRIORITY_DEFAULT_IDLE-NR_FAVORITE)?G_PRIORITY_DEFAULT_IDLE:priority;
+      tabs_received (self,
+                     &g_array_index (tabs, MnbNetpanelModelItem, i),
+                     priority);
     }
 
-  sqlite3_finalize(tab_stmt);
+  if (!tabs->len)
+    tabs_exception (self, 0);
 }
 
 static void
 create_history (MeegoNetbookNetpanel *self)
 {
   MeegoNetbookNetpanelPrivate *priv = self->priv;
-  gint rc, i;
+  gint i;
 
   if (!priv->tabs_view)
     create_tabs_view (self);
@@ -1272,7 +1333,7 @@ create_history (MeegoNetbookNetpanel *self)
   if (priv->fav_urls)
     {
       for (i = 0; i < priv->n_favs; i++)
-        g_free (priv->fav_urls[i]);
+        mwb_url_unref (priv->fav_urls[i]);
       g_free (priv->fav_urls);
       priv->fav_urls = NULL;
     }
@@ -1284,66 +1345,82 @@ create_history (MeegoNetbookNetpanel *self)
       priv->fav_titles = NULL;
     }
 
-  priv->fav_urls = (gchar**)g_malloc0 (NR_FAVORITE_MAX * sizeof (gchar*));
+  priv->fav_urls = (MwbUrl**)g_malloc0 (NR_FAVORITE_MAX * sizeof (MwbUrl*));
   priv->fav_titles = (gchar**)g_malloc0 (NR_FAVORITE_MAX * sizeof (gchar*));
   priv->n_favs = 0;
 
-  sqlite3_stmt *fav_stmt;
-  rc = sqlite3_prepare_v2 (priv->dbcon,
-                           FAVORITE_SQL,
-                           -1,
-                           &fav_stmt, NULL);
-  if (rc)
-    g_warning ("[netpanel] sqlite3_prepare_v2():fav_stmt %s",
-               sqlite3_errmsg(priv->dbcon));
+  GArray *favorites = priv->snapshots[MNB_NETPANEL_MODEL_FAVORITES]->items;
 
   int priority = G_PRIORITY_DEFAULT_IDLE - NR_FAVORITE + 1;
-  if (priv->dbcon && fav_stmt && sqlite3_step (fav_stmt) == SQLITE_ROW)
+  for (i = 0; i < (gint) favorites->len; i++)
+    favs_received (self,
+                   &g_array_index (favorites, MnbNetpanelModelItem, i),
+                   priority++);
+
+  if (!favorites->len)
+    create_favs_placeholder (self);
+}
+
+static void
+load_section (MeegoNetbookNetpanel *self, MnbNetpanelModelSection section)
+{
+  gint64 start = mwb_stats_get_monotonic_time ();
+
+  if (section == MNB_NETPANEL_MODEL_TABS)
     {
-      do
-        {
-          if (priv->n_favs < NR_FAVORITE)
-            {
-              /*XXX: Duplicated computing */
-              gchar* url = (gchar*)sqlite3_column_text(fav_stmt, 0);
-              gchar *csum = g_compute_checksum_for_string (G_CHECKSUM_MD5, url, -1);
-              gchar *thumbnail_filename = g_strconcat (csum, ".png", NULL);
-              gchar *path = g_build_filename (g_get_home_dir (),
-                                              NETPANEL_DIR,
-                                              "thumbnails",
-                                              thumbnail_filename,
-                                              NULL);
-
-              if(g_file_test(path, G_FILE_TEST_EXISTS))
-                favs_received (self,
-                               (gchar*) sqlite3_column_text (fav_stmt, 0),  // url
-                               (gchar*) sqlite3_column_text (fav_stmt, 1),  // title
-                               priority++);
-              g_free(csum);
-              g_free(thumbnail_filename);
-              g_free(path);
-            }
-        }
-      while (sqlite3_step (fav_stmt) == SQLITE_ROW);
+      create_tabs (self);
+      mwb_stats_span_add (MWB_STATS_SPAN_CREATE_TABS, start);
     }
   else
     {
-      create_favs_placeholder (self);
+      create_history (self);
+      mwb_stats_span_add (MWB_STATS_SPAN_CREATE_HISTORY, start);
     }
+}
 
-  sqlite3_finalize(fav_stmt);
+static void
+model_ready_cb (MnbNetpanelModel        *model,
+                MnbNetpanelModelSection  section,
+                gpointer                 data)
+{
+  MeegoNetbookNetpanel *self = MEEGO_NETBOOK_NETPANEL (data);
+  MeegoNetbookNetpanelPrivate *priv = self->priv;
+
+  /* Sections already on screen keep what they show until the panel
+     hides, only one still waiting for its first snapshot is loaded */
+  if (!CLUTTER_ACTOR_IS_VISIBLE (self) || priv->snapshots[section])
+    return;
+
+  priv->snapshots[section] = mnb_netpanel_model_get_snapshot (model, section);
+  if (priv->snapshots[section])
+    load_section (self, section);
 }
 
 static void
 request_live_previews (MeegoNetbookNetpanel *self)
 {
   MeegoNetbookNetpanelPrivate *priv = self->priv;
+  guint i;
 
   priv->display_tab = 0;
   priv->display_fav = 0;
 
-  create_tabs(self);
-  create_history (self);
+  /* The model threads keep these up to date while the panel is hidden */
+  for (i = 0; i < MNB_NETPANEL_MODEL_N_SECTIONS; i++)
+    {
+      MnbNetpanelModelSection section = (MnbNetpanelModelSection) i;
+
+      if (priv->snapshots[i])
+        mnb_netpanel_model_snapshot_unref (priv->snapshots[i]);
+      priv->snapshots[i] = mnb_netpanel_model_get_snapshot (priv->model,
+                                                            section);
+      if (priv->snapshots[i])
+        load_section (self, section);
+      else if (section == MNB_NETPANEL_MODEL_TABS)
+        create_tabs_view (self);
+      else
+        create_favs_view (self);
+    }
 }
 
 static void
@@ -1404,11 +1481,20 @@ meego_netbook_netpanel_show (ClutterActor *actor)
 {
   MeegoNetbookNetpanel *netpanel = MEEGO_NETBOOK_NETPANEL (actor);
   MeegoNetbookNetpanelPrivate *priv = netpanel->priv;
+  gint64 start;
 
+  mwb_stats_show_begin ();
+  mwb_lifecycle_resume ();
+
+  mnb_netpanel_launcher_prepare ();
+  mnb_netpanel_model_set_visible (priv->model, TRUE);
+
+  start = mwb_stats_get_monotonic_time ();
   if (!priv->places_db)
     priv->places_db = mwb_utils_places_db_get_filename ();
 
   mwb_utils_places_db_connect(priv->places_db, &priv->dbcon);
+  mwb_stats_span_add (MWB_STATS_SPAN_DB_CONNECT, start);
 
 //   mwb_utils_db_stmt_prepare(priv->dbcon, &priv->fav_stmt,
 //           &priv->tab_stmt, &priv->thumbnail_stmt);
@@ -1419,7 +1505,9 @@ meego_netbook_netpanel_show (ClutterActor *actor)
 
   request_live_previews (netpanel);
 
+  start = mwb_stats_get_monotonic_time ();
   meego_netbook_netpanel_set_search_provider(netpanel);
+  mwb_stats_span_add (MWB_STATS_SPAN_SEARCH_PROVIDER, start);
 
   CLUTTER_ACTOR_CLASS (meego_netbook_netpanel_parent_class)->show (actor);
 }
@@ -1431,6 +1519,8 @@ meego_netbook_netpanel_hide (ClutterActor *actor)
   MeegoNetbookNetpanelPrivate *priv = netpanel->priv;
   guint i;
 
+  mwb_stats_show_end ();
+
   meego_netbook_netpanel_clear (netpanel);
 
   if (priv->tabs)
@@ -1455,7 +1545,7 @@ meego_netbook_netpanel_hide (ClutterActor *actor)
   if (priv->fav_urls)
     {
       for (i = 0; i < priv->n_favs; i++)
-        g_free (priv->fav_urls[i]);
+        mwb_url_unref (priv->fav_urls[i]);
     }
 
   if (priv->fav_titles)
@@ -1485,17 +1575,22 @@ meego_netbook_netpanel_hide (ClutterActor *actor)
       priv->favs_view = NULL;
     }
 
-  while (priv->session_urls)
-    {
-      g_free (priv->session_urls->data);
-      priv->session_urls = g_list_delete_link (priv->session_urls,
-                                               priv->session_urls);
-    }
 
   mnb_netpanel_bar_clear_dbcon (G_OBJECT (priv->entry));
 
   mwb_utils_places_db_close (priv->dbcon);
 
+  for (i = 0; i < MNB_NETPANEL_MODEL_N_SECTIONS; i++)
+    if (priv->snapshots[i])
+      {
+        mnb_netpanel_model_snapshot_unref (priv->snapshots[i]);
+        priv->snapshots[i] = NULL;
+      }
+  mnb_netpanel_model_set_visible (priv->model, FALSE);
+
+  /* Nothing should tick from here until the panel is shown again */
+  mwb_lifecycle_suspend ();
+
   CLUTTER_ACTOR_CLASS (meego_netbook_netpanel_parent_class)->hide (actor);
 }
 
@@ -1618,6 +1713,9 @@ meego_netbook_netpanel_init (MeegoNetbookNetpanel *self)
       g_warning ("[netpanel]: no places database found");
     }
   priv->dbcon = NULL;
+
+  priv->model = mnb_netpanel_model_new (CELL_WIDTH, CELL_HEIGHT, FAVI_SIZE,
+                                        model_ready_cb, self);
 //   priv->fav_stmt = NULL;
 //   priv->tab_stmt = NULL;
 //   priv->thumbnail_stmt = NULL;
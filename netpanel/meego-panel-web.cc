@@ -27,9 +27,34 @@
 #include <meego-panel/mpl-panel-common.h>
 
 #include "meego-netbook-netpanel.h"
+#include "mnb-netpanel-benchmark.h"
+#include "mwb-assets.h"
+#include "mwb-trace.h"
+#include "mwb-stats.h"
 
 #include <config.h>
 
+/* When embedded, the panel registers with the shell straight away and
+   builds its widgets on the first show-begin or, failing that, a while
+   after startup once the rest of the session has settled */
+#define LAZY_PANEL_PREBUILD_DELAY_S 30
+
+typedef struct
+{
+  MplPanelClient       *client;
+  ClutterActor         *stage;
+  ClutterActor         *base_pane;
+  MeegoNetbookNetpanel *netpanel;
+  guint                 build_source;
+  gulong                show_begin_handler;
+  guint                 width, height;
+} LazyPanel;
+
+static LazyPanel lazy_panel;
+
+static gboolean print_startup_timings = FALSE;
+static gint64   startup_time;
+
 static void
 _client_set_size_cb (MplPanelClient *client,
                      guint           width,
@@ -37,9 +62,15 @@ _client_set_size_cb (MplPanelClient *client,
                      gpointer        userdata)
 {
   g_debug (G_STRLOC ": %d %d", width, height);
-  clutter_actor_set_size ((ClutterActor *)userdata,
-                          width,
-                          height);
+
+  /* Remembered in case the widgets aren't built yet */
+  lazy_panel.width = width;
+  lazy_panel.height = height;
+
+  if (lazy_panel.base_pane)
+    clutter_actor_set_size (lazy_panel.base_pane,
+                            width,
+                            height);
 }
 
 static gboolean
@@ -60,14 +91,157 @@ stage_delete_event (ClutterStage *stage,
 }
 
 
+static void
+print_startup_timing (const gchar *what)
+{
+  if (print_startup_timings)
+    g_print ("startup: %s after %.1f ms\n", what,
+             (mwb_stats_get_monotonic_time () - startup_time) / 1000.0);
+}
+
+static void
+stage_first_paint_cb (ClutterActor *stage,
+                      gpointer      userdata)
+{
+  /* Only count a paint with the panel's contents on it */
+  if (!lazy_panel.netpanel ||
+      !CLUTTER_ACTOR_IS_MAPPED (lazy_panel.netpanel))
+    return;
+
+  print_startup_timing ("first usable paint");
+  g_signal_handlers_disconnect_by_func (stage,
+                                        (gpointer) stage_first_paint_cb,
+                                        userdata);
+}
+
+static ClutterActor *
+create_panel_content (ClutterActor         *stage,
+                      MeegoNetbookNetpanel *netpanel)
+{
+  ClutterActor  *content_pane;
+  ClutterActor  *base_pane;
+  ClutterActor  *label;
+
+  base_pane = mx_box_layout_new();
+  clutter_actor_set_name (base_pane, "base-pane");
+  mx_box_layout_set_orientation (MX_BOX_LAYOUT (base_pane), MX_ORIENTATION_VERTICAL);
+  clutter_container_add_actor (CLUTTER_CONTAINER (stage), base_pane);
+
+  label = mx_label_new_with_text (_("Internet"));
+  clutter_actor_set_name (label, "panel-label");
+  clutter_container_add_actor (CLUTTER_CONTAINER (base_pane), label);
+
+  content_pane = mx_box_layout_new ();
+  clutter_actor_set_name (content_pane, "pane");
+  mx_box_layout_set_orientation (MX_BOX_LAYOUT (content_pane), MX_ORIENTATION_VERTICAL);
+  clutter_container_add_actor (CLUTTER_CONTAINER (base_pane), content_pane);
+  clutter_container_child_set (CLUTTER_CONTAINER (base_pane), content_pane,
+                               "expand", TRUE,
+                               "x-fill", TRUE,
+                               "y-fill", TRUE,
+                               NULL);
+
+  clutter_container_add_actor (CLUTTER_CONTAINER (content_pane),
+                               CLUTTER_ACTOR (netpanel));
+  clutter_container_child_set (CLUTTER_CONTAINER (content_pane), CLUTTER_ACTOR (netpanel),
+                               "expand", TRUE,
+                               "x-fill", TRUE,
+                               "y-fill", TRUE,
+                               NULL);
+
+  return base_pane;
+}
+
+static void
+load_style (void)
+{
+  /* The atlas has every theme image pre-decoded, the shell's cache
+     only helps without it */
+  if (!mwb_assets_init (THEMEDIR))
+    mx_texture_cache_load_cache (mx_texture_cache_get_default (),
+                                 MX_CACHE);
+  mx_style_load_from_file (mx_style_get_default (),
+                             THEMEDIR "/panel.css",
+                             NULL);
+}
+
+static void
+lazy_panel_build (void)
+{
+  if (lazy_panel.netpanel)
+    return;
+
+  if (lazy_panel.build_source)
+    {
+      g_source_remove (lazy_panel.build_source);
+      lazy_panel.build_source = 0;
+    }
+  g_signal_handler_disconnect (lazy_panel.client,
+                               lazy_panel.show_begin_handler);
+
+  load_style ();
+
+  lazy_panel.netpanel = MEEGO_NETBOOK_NETPANEL (meego_netbook_netpanel_new ());
+
+  /* Showing the panel connects to the database and loads the
+     thumbnails, that waits for show-begin */
+  g_object_set (lazy_panel.netpanel, "show-on-set-parent", FALSE, NULL);
+
+  lazy_panel.base_pane = create_panel_content (lazy_panel.stage,
+                                               lazy_panel.netpanel);
+  if (lazy_panel.width && lazy_panel.height)
+    clutter_actor_set_size (lazy_panel.base_pane,
+                            lazy_panel.width,
+                            lazy_panel.height);
+
+  meego_netbook_netpanel_set_panel_client (lazy_panel.netpanel,
+                                           lazy_panel.client);
+
+  g_signal_connect (lazy_panel.stage,
+                    "button-press-event",
+                    (GCallback)stage_button_press_event,
+                    lazy_panel.netpanel);
+
+  print_startup_timing ("widgets built");
+}
+
+static void
+lazy_panel_show_begin_cb (MplPanelClient *client,
+                          gpointer        userdata)
+{
+  lazy_panel_build ();
+
+  /* The netpanel's own show-begin handler was connected during this
+     emission so it won't run for it */
+  clutter_actor_show (CLUTTER_ACTOR (lazy_panel.netpanel));
+}
+
+static gboolean
+lazy_panel_build_timeout_cb (gpointer userdata)
+{
+  lazy_panel.build_source = 0;
+
+  clutter_threads_enter ();
+  lazy_panel_build ();
+  clutter_threads_leave ();
+
+  return FALSE;
+}
+
 static gboolean standalone = FALSE;
 static char const *geometry = NULL;
 static int         dpi = 0;
+static char const *benchmark = NULL;
 
 static GOptionEntry entries[] = {
   {"standalone", 's', 0, G_OPTION_ARG_NONE, &standalone, "Do not embed into the mutter-meego panel", NULL},
   { "geometry", 'g', 0, G_OPTION_ARG_STRING, &geometry,
     "Window geometry in standalone mode", NULL },
+  { "benchmark", 'b', 0, G_OPTION_ARG_FILENAME, &benchmark,
+    "Replay <script> in standalone mode, print timings and exit",
+    "<script>" },
+  { "print-startup-timings", 0, 0, G_OPTION_ARG_NONE, &print_startup_timings,
+    "Print the time taken to register with the shell and to paint", NULL },
 #if CLUTTER_CHECK_VERSION(1, 3, 0)
   { "clutter-font-dpi", 'd', 0, G_OPTION_ARG_INT, &dpi,
     "Set clutter font resolution to <dpi>", "<dpi>" },
@@ -82,10 +256,11 @@ main (int    argc,
 {
   MplPanelClient *client;
   ClutterActor *stage;
-  MeegoNetbookNetpanel *netpanel;
   GOptionContext *context;
   GError *error = NULL;
 
+  startup_time = mwb_stats_get_monotonic_time ();
+
   setlocale (LC_ALL, "");
   bindtextdomain (GETTEXT_PACKAGE, LOCALEDIR);
   bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
@@ -103,10 +278,25 @@ main (int    argc,
 
   g_option_context_free (context);
 
+  if (benchmark)
+    {
+      standalone = TRUE;
+
+      if (!mnb_netpanel_benchmark_setup (&error))
+        {
+          g_critical (G_STRLOC ": %s", error->message);
+          g_clear_error (&error);
+          return 1;
+        }
+    }
+
   g_thread_init(NULL);
   clutter_threads_init();
 
+  mwb_trace_init ();
+
   mpl_panel_clutter_init_with_gtk (&argc, &argv);
+  mwb_stats_count_wakeups ();
 
   if (dpi)
     {
@@ -116,12 +306,6 @@ main (int    argc,
 #endif
     }
 
-  mx_texture_cache_load_cache (mx_texture_cache_get_default (),
-                                 MX_CACHE);
-  mx_style_load_from_file (mx_style_get_default (),
-                             THEMEDIR "/panel.css",
-                             NULL);
-
   if (!standalone)
   {
     client = mpl_panel_clutter_new (MPL_PANEL_INTERNET,
@@ -130,55 +314,34 @@ main (int    argc,
                                     "internet-button",
                                     TRUE);
 
+    print_startup_timing ("registered with the shell");
 
     mpl_panel_clutter_setup_events_with_gtk (MPL_PANEL_CLUTTER(client));
 
     mpl_panel_client_set_height_request (client, 600);
 
     stage = mpl_panel_clutter_get_stage (MPL_PANEL_CLUTTER (client));
-    netpanel = MEEGO_NETBOOK_NETPANEL (meego_netbook_netpanel_new ());
-
-    ClutterActor  *content_pane;
-    ClutterActor  *base_pane;
-    ClutterActor  *label;
-
-    base_pane = mx_box_layout_new();
-    clutter_actor_set_name (base_pane, "base-pane");
-    mx_box_layout_set_orientation (MX_BOX_LAYOUT (base_pane), MX_ORIENTATION_VERTICAL);
-    clutter_container_add_actor (CLUTTER_CONTAINER (stage), base_pane);
-
-    label = mx_label_new_with_text (_("Internet"));
-    clutter_actor_set_name (label, "panel-label");
-    clutter_container_add_actor (CLUTTER_CONTAINER (base_pane), label);
-
-    content_pane = mx_box_layout_new ();
-    clutter_actor_set_name (content_pane, "pane");
-    mx_box_layout_set_orientation (MX_BOX_LAYOUT (content_pane), MX_ORIENTATION_VERTICAL);
-    clutter_container_add_actor (CLUTTER_CONTAINER (base_pane), content_pane);
-    clutter_container_child_set (CLUTTER_CONTAINER (base_pane), content_pane,
-                                 "expand", TRUE,
-                                 "x-fill", TRUE,
-                                 "y-fill", TRUE,
-                                 NULL);
-
-    clutter_container_add_actor (CLUTTER_CONTAINER (content_pane),
-                                 CLUTTER_ACTOR (netpanel));
-    clutter_container_child_set (CLUTTER_CONTAINER (content_pane), CLUTTER_ACTOR (netpanel),
-                                 "expand", TRUE,
-                                 "x-fill", TRUE,
-                                 "y-fill", TRUE,
-                                 NULL);
-
-    meego_netbook_netpanel_set_panel_client (netpanel, client);
+
+    lazy_panel.client = client;
+    lazy_panel.stage = stage;
+    lazy_panel.show_begin_handler =
+      g_signal_connect (client,
+                        "show-begin",
+                        (GCallback)lazy_panel_show_begin_cb,
+                        NULL);
+    lazy_panel.build_source =
+      g_timeout_add_seconds (LAZY_PANEL_PREBUILD_DELAY_S,
+                             lazy_panel_build_timeout_cb,
+                             NULL);
+
     g_signal_connect (client,
                       "set-size",
                       (GCallback)_client_set_size_cb,
-                      base_pane);
+                      NULL);
   } else {
     Window xwin;
-    ClutterActor  *content_pane;
-    ClutterActor  *base_pane;
-    ClutterActor  *label;
+
+    load_style ();
 
     stage = clutter_stage_get_default ();
     clutter_actor_realize (stage);
@@ -199,49 +362,39 @@ main (int    argc,
       }
 
     mpl_panel_clutter_setup_events_with_gtk_for_xid (xwin);
-    netpanel = MEEGO_NETBOOK_NETPANEL (meego_netbook_netpanel_new ());
-
-    base_pane = mx_box_layout_new();
-    clutter_actor_set_name (base_pane, "base-pane");
-    mx_box_layout_set_orientation (MX_BOX_LAYOUT (base_pane), MX_ORIENTATION_VERTICAL);
-    clutter_container_add_actor (CLUTTER_CONTAINER (stage), base_pane);
-
-    label = mx_label_new_with_text (_("Internet"));
-    clutter_actor_set_name (label, "panel-label");
-    clutter_container_add_actor (CLUTTER_CONTAINER (base_pane), label);
-
-    content_pane = mx_box_layout_new ();
-    clutter_actor_set_name (content_pane, "pane");
-    mx_box_layout_set_orientation (MX_BOX_LAYOUT (content_pane), MX_ORIENTATION_VERTICAL);
-    clutter_container_add_actor (CLUTTER_CONTAINER (base_pane), content_pane);
-    clutter_container_child_set (CLUTTER_CONTAINER (base_pane), content_pane,
-                                 "expand", TRUE,
-                                 "x-fill", TRUE,
-                                 "y-fill", TRUE,
-                                 NULL);
-
-    clutter_container_add_actor (CLUTTER_CONTAINER (content_pane),
-                                 CLUTTER_ACTOR (netpanel));
-    clutter_container_child_set (CLUTTER_CONTAINER (content_pane), CLUTTER_ACTOR (netpanel),
-                                 "expand", TRUE,
-                                 "x-fill", TRUE,
-                                 "y-fill", TRUE,
-                                 NULL);
+    lazy_panel.netpanel = MEEGO_NETBOOK_NETPANEL (meego_netbook_netpanel_new ());
+    lazy_panel.base_pane = create_panel_content (stage, lazy_panel.netpanel);
+
     clutter_actor_set_size (stage, 1016, 500);
-    clutter_actor_set_size (base_pane, 1016, 500);
-    clutter_actor_show (CLUTTER_ACTOR (netpanel));
+    clutter_actor_set_size (lazy_panel.base_pane, 1016, 500);
+    clutter_actor_show (CLUTTER_ACTOR (lazy_panel.netpanel));
     clutter_actor_show_all (stage);
 
     g_signal_connect (stage,
                     "delete-event",
                     (GCallback)stage_delete_event,
                     NULL);
+
+    g_signal_connect (stage,
+                      "button-press-event",
+                      (GCallback)stage_button_press_event,
+                      lazy_panel.netpanel);
   }
 
-  g_signal_connect (stage,
-                    "button-press-event",
-                    (GCallback)stage_button_press_event,
-                    netpanel);
+  if (print_startup_timings)
+    g_signal_connect_after (stage,
+                            "paint",
+                            (GCallback)stage_first_paint_cb,
+                            NULL);
+
+  if (benchmark &&
+      !mnb_netpanel_benchmark_start (stage, lazy_panel.netpanel, benchmark,
+                                     &error))
+    {
+      g_critical (G_STRLOC ": %s", error->message);
+      g_clear_error (&error);
+      return 1;
+    }
 
   clutter_main ();
 
@@ -22,13 +22,18 @@
 #include "config.h"
 #endif
 
+#include <sys/stat.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <gtk/gtk.h>
 #include <gdk/gdkx.h>
 
 #include "mnb-netpanel-bar.h"
 #include "mwb-utils.h"
 #include "mwb-ac-list.h"
+#include "mwb-host-index.h"
+#include "mwb-lifecycle.h"
+#include "mwb-stats.h"
 
 G_DEFINE_TYPE (MnbNetpanelBar, mnb_netpanel_bar, MPL_TYPE_ENTRY)
 
@@ -54,13 +59,42 @@ struct _MnbNetpanelBarPrivate
   ClutterTimeline *ac_list_timeline;
   gdouble          ac_list_anim_progress;
   gboolean         ac_list_tag;
+  guint            lifecycle_id;
+
+  /* Inline completion is answered from the host index only, it is
+     rebuilt in a thread when the panel gets a database connection and
+     the places file has changed since the last build */
+  MwbHostIndex    *host_index;
+  gboolean         host_index_loading;
+  gchar           *host_index_db;
+  gint64           host_index_mtime;
+  gint64           host_index_size;
+  /* Set while the entry text is being replaced with a completion */
+  gboolean         inline_completing;
+  /* Length of the text typed so far, without any completion */
+  gsize            typed_len;
 };
 
+typedef struct
+{
+  MnbNetpanelBar *self;
+  gchar          *places_db;
+  gint64          mtime;
+  gint64          size;
+  MwbHostIndex   *host_index;
+} MnbNetpanelBarHostIndexLoad;
+
 static void
 mnb_netpanel_bar_dispose (GObject *object)
 {
   MnbNetpanelBarPrivate *priv = MNB_NETPANEL_BAR (object)->priv;
 
+  if (priv->lifecycle_id)
+    {
+      mwb_lifecycle_remove (priv->lifecycle_id);
+      priv->lifecycle_id = 0;
+    }
+
   if (priv->ac_list_timeline)
     {
       clutter_timeline_stop (priv->ac_list_timeline);
@@ -82,6 +116,12 @@ mnb_netpanel_bar_dispose (GObject *object)
 static void
 mnb_netpanel_bar_finalize (GObject *object)
 {
+  MnbNetpanelBarPrivate *priv = MNB_NETPANEL_BAR (object)->priv;
+
+  if (priv->host_index)
+    mwb_host_index_free (priv->host_index);
+  g_free (priv->host_index_db);
+
   G_OBJECT_CLASS (mnb_netpanel_bar_parent_class)->finalize (object);
 }
 
@@ -169,6 +209,7 @@ mnb_netpanel_bar_ac_list_new_frame_cb (ClutterTimeline *timeline,
                                        MnbNetpanelBar  *self)
 {
   MnbNetpanelBarPrivate *priv = self->priv;
+  mwb_stats_wakeup (MWB_STATS_WAKEUP_ANIMATION);
   priv->ac_list_anim_progress = clutter_timeline_get_progress (timeline);
   clutter_actor_queue_redraw (CLUTTER_ACTOR (self));
 }
@@ -195,6 +236,14 @@ mnb_netpanel_bar_ac_list_completed_cb (ClutterTimeline *timeline,
   clutter_actor_queue_redraw (CLUTTER_ACTOR (self));
 }
 
+static void
+mnb_netpanel_bar_suspend (gpointer data)
+{
+  MnbNetpanelBarPrivate *priv = MNB_NETPANEL_BAR (data)->priv;
+
+  mwb_lifecycle_finish_timeline (priv->ac_list_timeline);
+}
+
 static void
 mnb_netpanel_bar_set_show_auto_complete (MnbNetpanelBar *self,
                                          gboolean        show)
@@ -386,17 +435,64 @@ mnb_netpanel_bar_select_all (MnbNetpanelBar *self)
   clutter_text_set_selection (CLUTTER_TEXT (actor), 0, length);
 }
 
+/* Appends the best completion from the host index to what has been
+   typed, selected so the next key press replaces it */
+static void
+mnb_netpanel_bar_inline_complete (MnbNetpanelBar *self,
+                                  ClutterText    *text_actor,
+                                  const gchar    *text)
+{
+  MnbNetpanelBarPrivate *priv = self->priv;
+  const gchar *completion;
+  gchar *completed;
+  gint typed_chars;
+
+  if (!priv->host_index)
+    return;
+
+  /* Only complete when typing at the end of the text */
+  typed_chars = g_utf8_strlen (text, -1);
+  if (clutter_text_get_cursor_position (text_actor) != -1 &&
+      clutter_text_get_cursor_position (text_actor) != typed_chars)
+    return;
+
+  completion = mwb_host_index_complete (priv->host_index, text);
+  if (!completion)
+    return;
+
+  completed = g_strconcat (text, completion, NULL);
+
+  priv->inline_completing = TRUE;
+  mpl_entry_set_text (MPL_ENTRY (self), completed);
+  clutter_text_set_selection (text_actor, typed_chars, -1);
+  priv->inline_completing = FALSE;
+
+  g_free (completed);
+}
+
 static void
 mnb_netpanel_bar_text_changed_cb (GObject        *obj,
                                   MnbNetpanelBar *self)
 {
   MnbNetpanelBarPrivate *priv = self->priv;
+  const gchar *text;
+  gsize len;
+
+  if (priv->inline_completing)
+    return;
+
+  text = mpl_entry_get_text (MPL_ENTRY (self));
+  len = strlen (text);
 
   if (priv->ac_list_tag && CLUTTER_ACTOR_IS_VISIBLE (CLUTTER_ACTOR (priv->ac_list)))
-    {
-      const gchar *text = mpl_entry_get_text (MPL_ENTRY (self));
-      mwb_ac_list_set_search_text (MWB_AC_LIST (priv->ac_list), text);
-    }
+    mwb_ac_list_set_search_text (MWB_AC_LIST (priv->ac_list), text);
+
+  /* Deleting, including deleting the selected completion, must not
+     bring it straight back */
+  if (priv->ac_list_tag && len > priv->typed_len)
+    mnb_netpanel_bar_inline_complete (self, CLUTTER_TEXT (obj), text);
+
+  priv->typed_len = len;
 }
 
 static void
@@ -499,6 +595,9 @@ mnb_netpanel_bar_init (MnbNetpanelBar *self)
   clutter_actor_set_parent (CLUTTER_ACTOR (priv->ac_list),
                             CLUTTER_ACTOR (self));
   clutter_actor_hide (CLUTTER_ACTOR (priv->ac_list));
+
+  priv->lifecycle_id = mwb_lifecycle_add (mnb_netpanel_bar_suspend,
+                                          NULL, self);
 }
 
 MxWidget*
@@ -509,13 +608,103 @@ mnb_netpanel_bar_new (const gchar *label)
                                     NULL));
 }
 
+static gboolean
+mnb_netpanel_bar_host_index_loaded_cb (gpointer data)
+{
+  MnbNetpanelBarHostIndexLoad *load = (MnbNetpanelBarHostIndexLoad *) data;
+  MnbNetpanelBarPrivate *priv = load->self->priv;
+
+  if (load->host_index)
+    {
+      if (priv->host_index)
+        mwb_host_index_free (priv->host_index);
+      priv->host_index = load->host_index;
+
+      g_free (priv->host_index_db);
+      priv->host_index_db = load->places_db;
+      priv->host_index_mtime = load->mtime;
+      priv->host_index_size = load->size;
+    }
+  else
+    g_free (load->places_db);
+  priv->host_index_loading = FALSE;
+
+  g_object_unref (load->self);
+  g_free (load);
+
+  return FALSE;
+}
+
+/* Uses its own connection so the main thread never waits on it */
+static gpointer
+mnb_netpanel_bar_host_index_thread (gpointer data)
+{
+  MnbNetpanelBarHostIndexLoad *load = (MnbNetpanelBarHostIndexLoad *) data;
+  sqlite3 *dbcon = NULL;
+
+  if (!mwb_utils_places_db_connect (load->places_db, &dbcon))
+    {
+      load->host_index = mwb_host_index_new_from_db (dbcon);
+      mwb_utils_places_db_close (dbcon);
+    }
+
+  clutter_threads_add_idle (mnb_netpanel_bar_host_index_loaded_cb, load);
+
+  return NULL;
+}
+
 void
 mnb_netpanel_bar_set_dbcon (GObject *object, void *dbcon)
 {
   MnbNetpanelBar *self = MNB_NETPANEL_BAR(object);
   MnbNetpanelBarPrivate *priv = self->priv;
+  MnbNetpanelBarHostIndexLoad *load;
+  gchar *places_db;
+  struct stat buf;
+  GError *error = NULL;
 
   mwb_ac_list_db_stmt_prepare (MWB_AC_LIST (priv->ac_list), dbcon);
+
+  if (!dbcon || priv->host_index_loading)
+    return;
+
+  /* The history is only written while the browser runs, so most shows
+     find the places file as it was and can keep the current index */
+  places_db = mwb_utils_places_db_get_filename ();
+  if (g_stat (places_db, &buf))
+    {
+      buf.st_mtime = 0;
+      buf.st_size = 0;
+    }
+
+  if (priv->host_index &&
+      !g_strcmp0 (places_db, priv->host_index_db) &&
+      priv->host_index_mtime == buf.st_mtime &&
+      priv->host_index_size == buf.st_size)
+    {
+      g_free (places_db);
+      return;
+    }
+
+  load = g_new0 (MnbNetpanelBarHostIndexLoad, 1);
+  load->self = MNB_NETPANEL_BAR (g_object_ref (self));
+  load->places_db = places_db;
+  load->mtime = buf.st_mtime;
+  load->size = buf.st_size;
+
+  if (!g_thread_create (mnb_netpanel_bar_host_index_thread,
+                        load, FALSE, &error))
+    {
+      g_warning ("[netpanel] unable to start host index thread: %s",
+                 error->message);
+      g_error_free (error);
+      g_object_unref (load->self);
+      g_free (load->places_db);
+      g_free (load);
+      return;
+    }
+
+  priv->host_index_loading = TRUE;
 }
 
 void
@@ -0,0 +1,578 @@
+/* mnb-netpanel-benchmark.cc */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+#include "mnb-netpanel-benchmark.h"
+#include "mwb-stats.h"
+
+typedef enum
+{
+  ACTION_SHOW,
+  ACTION_HIDE,
+  ACTION_KEY,
+  ACTION_SCROLL,
+  ACTION_CLICK,
+  ACTION_WAIT,
+
+  N_ACTIONS
+} ActionType;
+
+static const gchar *action_names[N_ACTIONS] =
+  {
+    "show", "hide", "key", "scroll", "click", "wait"
+  };
+
+typedef struct
+{
+  ActionType type;
+  gunichar   unicode;
+  guint      keyval;
+  gfloat     x, y;
+  ClutterScrollDirection direction;
+  guint      wait_ms;
+} Action;
+
+typedef struct
+{
+  ClutterActor         *stage;
+  MeegoNetbookNetpanel *netpanel;
+
+  GArray               *actions;
+  guint                 next_action;
+
+  gint64                action_start;
+  gint64                paint_start;
+
+  GArray               *latencies[N_ACTIONS];
+  GArray               *frame_times;
+} MnbNetpanelBenchmark;
+
+static gchar *benchmark_tmp_dir = NULL;
+static int benchmark_fifo_fd = -1;
+static guint benchmark_n_fifo_bytes = 0;
+
+static const struct
+{
+  const gchar *name;
+  guint        keyval;
+} benchmark_keys[] =
+  {
+    { "Return",    CLUTTER_Return },
+    { "Escape",    CLUTTER_Escape },
+    { "BackSpace", CLUTTER_BackSpace },
+    { "Tab",       CLUTTER_Tab },
+    { "Up",        CLUTTER_Up },
+    { "Down",      CLUTTER_Down },
+    { "Left",      CLUTTER_Left },
+    { "Right",     CLUTTER_Right },
+    { "Home",      CLUTTER_Home },
+    { "End",       CLUTTER_End }
+  };
+
+static gboolean
+benchmark_fifo_cb (GIOChannel   *source,
+                   GIOCondition  condition,
+                   gpointer      data)
+{
+  gchar buf[256];
+  gssize len;
+
+  while ((len = read (benchmark_fifo_fd, buf, sizeof (buf))) > 0)
+    benchmark_n_fifo_bytes += len;
+
+  return TRUE;
+}
+
+gboolean
+mnb_netpanel_benchmark_setup (GError **error)
+{
+  const gchar *base = g_getenv ("TMPDIR");
+  const gchar *trace;
+  gchar *fifo;
+  GIOChannel *channel;
+
+  benchmark_tmp_dir = g_build_filename (base && *base ? base : "/tmp",
+                                        "meego-panel-web-bench-XXXXXX",
+                                        NULL);
+  if (!mkdtemp (benchmark_tmp_dir))
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   "Unable to create %s", benchmark_tmp_dir);
+      return FALSE;
+    }
+
+  /* The default trace file would otherwise go in the directory
+     removed on exit, before the trace is written at exit */
+  trace = g_getenv ("MWB_TRACE");
+  if (trace && g_str_equal (trace, "1"))
+    {
+      gchar *name = g_strdup_printf ("mwb-trace-%d.json", (int)getpid ());
+      gchar *path = g_build_filename (base && *base ? base : "/tmp",
+                                      name, NULL);
+
+      g_setenv ("MWB_TRACE", path, TRUE);
+      g_free (path);
+      g_free (name);
+    }
+
+  g_setenv ("TMPDIR", benchmark_tmp_dir, TRUE);
+
+  /* Same name meego_netbook_netpanel_open_tab() writes to. Keeping the
+     read end open lets its O_NONBLOCK open succeed. */
+  fifo = g_build_filename (benchmark_tmp_dir, "chrome-meego-plugin.fifo",
+                           NULL);
+  if (mkfifo (fifo, 0600) ||
+      (benchmark_fifo_fd = open (fifo, O_RDONLY | O_NONBLOCK)) < 0)
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   "Unable to create %s", fifo);
+      g_free (fifo);
+      return FALSE;
+    }
+  g_free (fifo);
+
+  channel = g_io_channel_unix_new (benchmark_fifo_fd);
+  g_io_add_watch (channel, G_IO_IN, benchmark_fifo_cb, NULL);
+  g_io_channel_unref (channel);
+
+  return TRUE;
+}
+
+static void
+benchmark_cleanup (void)
+{
+  GDir *dir;
+  const gchar *name;
+
+  if (benchmark_fifo_fd >= 0)
+    close (benchmark_fifo_fd);
+
+  if ((dir = g_dir_open (benchmark_tmp_dir, 0, NULL)))
+    {
+      while ((name = g_dir_read_name (dir)))
+        {
+          gchar *path = g_build_filename (benchmark_tmp_dir, name, NULL);
+          g_unlink (path);
+          g_free (path);
+        }
+      g_dir_close (dir);
+    }
+  g_rmdir (benchmark_tmp_dir);
+}
+
+static guint
+benchmark_unicode_to_keyval (gunichar unicode)
+{
+  /* Latin-1 keysyms match their code points, everything else uses
+     the direct Unicode keysym range */
+  if ((unicode >= 0x20 && unicode <= 0x7e) ||
+      (unicode >= 0xa0 && unicode <= 0xff))
+    return unicode;
+
+  return unicode | 0x01000000;
+}
+
+static gboolean
+benchmark_parse (MnbNetpanelBenchmark *benchmark,
+                 const gchar          *script,
+                 GError              **error)
+{
+  gchar *contents;
+  gchar **lines;
+  gint repeat = 0;
+  guint repeat_start = 0;
+  guint i;
+
+  if (!g_file_get_contents (script, &contents, NULL, error))
+    return FALSE;
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (i = 0; lines[i]; i++)
+    {
+      gchar *line = g_strstrip (lines[i]);
+      gchar **argv;
+      Action action;
+
+      if (*line == '\0' || *line == '#')
+        continue;
+
+      memset (&action, 0, sizeof (action));
+      argv = g_strsplit_set (line, " \t", 2);
+
+      if (g_str_equal (argv[0], "show"))
+        {
+          action.type = ACTION_SHOW;
+          g_array_append_val (benchmark->actions, action);
+        }
+      else if (g_str_equal (argv[0], "hide"))
+        {
+          action.type = ACTION_HIDE;
+          g_array_append_val (benchmark->actions, action);
+        }
+      else if (g_str_equal (argv[0], "type") && argv[1])
+        {
+          const gchar *p;
+
+          /* Each character is a separate key press action */
+          action.type = ACTION_KEY;
+          for (p = argv[1]; *p; p = g_utf8_next_char (p))
+            {
+              action.unicode = g_utf8_get_char (p);
+              action.keyval = benchmark_unicode_to_keyval (action.unicode);
+              g_array_append_val (benchmark->actions, action);
+            }
+        }
+      else if (g_str_equal (argv[0], "key") && argv[1])
+        {
+          guint k;
+
+          action.type = ACTION_KEY;
+          for (k = 0; k < G_N_ELEMENTS (benchmark_keys); k++)
+            if (g_str_equal (argv[1], benchmark_keys[k].name))
+              action.keyval = benchmark_keys[k].keyval;
+
+          if (action.keyval == 0)
+            {
+              g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                           "%s:%u: unknown key '%s'", script, i + 1, argv[1]);
+              g_strfreev (argv);
+              g_strfreev (lines);
+              return FALSE;
+            }
+          g_array_append_val (benchmark->actions, action);
+        }
+      else if ((g_str_equal (argv[0], "scroll") ||
+                g_str_equal (argv[0], "click")) && argv[1])
+        {
+          gchar direction[16] = "down";
+          gint n;
+
+          n = sscanf (argv[1], "%f %f %15s", &action.x, &action.y, direction);
+          if (n < 2)
+            {
+              g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                           "%s:%u: expected '%s <x> <y>'",
+                           script, i + 1, argv[0]);
+              g_strfreev (argv);
+              g_strfreev (lines);
+              return FALSE;
+            }
+
+          if (g_str_equal (argv[0], "click"))
+            action.type = ACTION_CLICK;
+          else
+            {
+              action.type = ACTION_SCROLL;
+              if (g_str_equal (direction, "up"))
+                action.direction = CLUTTER_SCROLL_UP;
+              else if (g_str_equal (direction, "left"))
+                action.direction = CLUTTER_SCROLL_LEFT;
+              else if (g_str_equal (direction, "right"))
+                action.direction = CLUTTER_SCROLL_RIGHT;
+              else
+                action.direction = CLUTTER_SCROLL_DOWN;
+            }
+          g_array_append_val (benchmark->actions, action);
+        }
+      else if (g_str_equal (argv[0], "wait") && argv[1])
+        {
+          action.type = ACTION_WAIT;
+          action.wait_ms = strtoul (argv[1], NULL, 10);
+          g_array_append_val (benchmark->actions, action);
+        }
+      else if (g_str_equal (argv[0], "repeat") && argv[1] && !repeat)
+        {
+          repeat = MAX (atoi (argv[1]), 1);
+          repeat_start = benchmark->actions->len;
+        }
+      else if (g_str_equal (argv[0], "end") && repeat)
+        {
+          guint len = benchmark->actions->len - repeat_start;
+          gint r;
+
+          for (r = 1; r < repeat; r++)
+            {
+              guint a;
+
+              for (a = 0; a < len; a++)
+                {
+                  Action copy = g_array_index (benchmark->actions, Action,
+                                               repeat_start + a);
+                  g_array_append_val (benchmark->actions, copy);
+                }
+            }
+          repeat = 0;
+        }
+      else
+        {
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                       "%s:%u: can't parse '%s'", script, i + 1, line);
+          g_strfreev (argv);
+          g_strfreev (lines);
+          return FALSE;
+        }
+
+      g_strfreev (argv);
+    }
+
+  g_strfreev (lines);
+
+  return TRUE;
+}
+
+static void
+benchmark_put_key (MnbNetpanelBenchmark *benchmark,
+                   Action               *action,
+                   ClutterEventType      type)
+{
+  ClutterEvent *event = clutter_event_new (type);
+
+  event->key.stage = CLUTTER_STAGE (benchmark->stage);
+  event->key.time = clutter_get_current_event_time ();
+  event->key.keyval = action->keyval;
+  event->key.unicode_value = action->unicode;
+  event->key.modifier_state = (ClutterModifierType)0;
+
+  clutter_event_put (event);
+  clutter_event_free (event);
+}
+
+static void
+benchmark_put_button (MnbNetpanelBenchmark *benchmark,
+                      Action               *action,
+                      ClutterEventType      type)
+{
+  ClutterEvent *event = clutter_event_new (type);
+
+  event->button.stage = CLUTTER_STAGE (benchmark->stage);
+  event->button.time = clutter_get_current_event_time ();
+  event->button.x = action->x;
+  event->button.y = action->y;
+  event->button.button = 1;
+  event->button.click_count = 1;
+
+  clutter_event_put (event);
+  clutter_event_free (event);
+}
+
+static void
+benchmark_put_scroll (MnbNetpanelBenchmark *benchmark,
+                      Action               *action)
+{
+  ClutterEvent *event = clutter_event_new (CLUTTER_SCROLL);
+
+  event->scroll.stage = CLUTTER_STAGE (benchmark->stage);
+  event->scroll.time = clutter_get_current_event_time ();
+  event->scroll.x = action->x;
+  event->scroll.y = action->y;
+  event->scroll.direction = action->direction;
+
+  clutter_event_put (event);
+  clutter_event_free (event);
+}
+
+static void
+benchmark_print (const gchar *label, GArray *samples)
+{
+  if (samples->len == 0)
+    return;
+
+  printf ("  %-12s %6u %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT
+          " %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT "\n",
+          label, samples->len,
+          mwb_stats_percentile (samples, 50),
+          mwb_stats_percentile (samples, 90),
+          mwb_stats_percentile (samples, 99),
+          mwb_stats_percentile (samples, 100));
+}
+
+static void benchmark_paint_begin_cb (ClutterActor         *stage,
+                                      MnbNetpanelBenchmark *benchmark);
+static void benchmark_paint_end_cb (ClutterActor         *stage,
+                                    MnbNetpanelBenchmark *benchmark);
+
+static void
+benchmark_finish (MnbNetpanelBenchmark *benchmark)
+{
+  guint i;
+
+  g_signal_handlers_disconnect_by_func (benchmark->stage,
+                                        (gpointer)benchmark_paint_begin_cb,
+                                        benchmark);
+  g_signal_handlers_disconnect_by_func (benchmark->stage,
+                                        (gpointer)benchmark_paint_end_cb,
+                                        benchmark);
+
+  printf ("  %-12s %6s %10s %10s %10s %10s\n",
+          "action", "n", "p50 us", "p90 us", "p99 us", "max us");
+  for (i = 0; i < N_ACTIONS; i++)
+    if (i != ACTION_WAIT)
+      benchmark_print (action_names[i], benchmark->latencies[i]);
+  benchmark_print ("frame", benchmark->frame_times);
+  printf ("  %u bytes of tab commands sent to the stub browser\n",
+          benchmark_n_fifo_bytes);
+
+  for (i = 0; i < N_ACTIONS; i++)
+    g_array_free (benchmark->latencies[i], TRUE);
+  g_array_free (benchmark->frame_times, TRUE);
+  g_array_free (benchmark->actions, TRUE);
+  g_free (benchmark);
+
+  benchmark_cleanup ();
+
+  clutter_main_quit ();
+}
+
+static gboolean benchmark_next_action (gpointer data);
+
+/* Runs at low priority, so only once the events, relayout, redraw and
+   any idle work (eg. thumbnail decoding) caused by the action are
+   done */
+static gboolean
+benchmark_action_done (gpointer data)
+{
+  MnbNetpanelBenchmark *benchmark = (MnbNetpanelBenchmark *)data;
+  Action *action = &g_array_index (benchmark->actions, Action,
+                                   benchmark->next_action - 1);
+  gint64 latency = mwb_stats_get_monotonic_time () - benchmark->action_start;
+
+  g_array_append_val (benchmark->latencies[action->type], latency);
+
+  return benchmark_next_action (benchmark);
+}
+
+static gboolean
+benchmark_next_action (gpointer data)
+{
+  MnbNetpanelBenchmark *benchmark = (MnbNetpanelBenchmark *)data;
+  Action *action;
+
+  if (benchmark->next_action >= benchmark->actions->len)
+    {
+      benchmark_finish (benchmark);
+      return FALSE;
+    }
+
+  action = &g_array_index (benchmark->actions, Action,
+                           benchmark->next_action++);
+  benchmark->action_start = mwb_stats_get_monotonic_time ();
+
+  switch (action->type)
+    {
+    case ACTION_SHOW:
+      /* The same vfunc the panel client's show-begin ends up in */
+      clutter_actor_show (CLUTTER_ACTOR (benchmark->netpanel));
+      break;
+
+    case ACTION_HIDE:
+      clutter_actor_hide (CLUTTER_ACTOR (benchmark->netpanel));
+      break;
+
+    case ACTION_KEY:
+      benchmark_put_key (benchmark, action, CLUTTER_KEY_PRESS);
+      benchmark_put_key (benchmark, action, CLUTTER_KEY_RELEASE);
+      break;
+
+    case ACTION_SCROLL:
+      benchmark_put_scroll (benchmark, action);
+      break;
+
+    case ACTION_CLICK:
+      benchmark_put_button (benchmark, action, CLUTTER_BUTTON_PRESS);
+      benchmark_put_button (benchmark, action, CLUTTER_BUTTON_RELEASE);
+      break;
+
+    case ACTION_WAIT:
+      g_timeout_add (action->wait_ms, benchmark_next_action, benchmark);
+      return FALSE;
+
+    default:
+      break;
+    }
+
+  clutter_actor_queue_redraw (benchmark->stage);
+  g_idle_add_full (G_PRIORITY_LOW, benchmark_action_done, benchmark, NULL);
+
+  return FALSE;
+}
+
+static void
+benchmark_paint_begin_cb (ClutterActor         *stage,
+                          MnbNetpanelBenchmark *benchmark)
+{
+  benchmark->paint_start = mwb_stats_get_monotonic_time ();
+}
+
+static void
+benchmark_paint_end_cb (ClutterActor         *stage,
+                        MnbNetpanelBenchmark *benchmark)
+{
+  gint64 frame_time = mwb_stats_get_monotonic_time () - benchmark->paint_start;
+
+  g_array_append_val (benchmark->frame_times, frame_time);
+}
+
+gboolean
+mnb_netpanel_benchmark_start (ClutterActor         *stage,
+                              MeegoNetbookNetpanel *netpanel,
+                              const gchar          *script,
+                              GError              **error)
+{
+  MnbNetpanelBenchmark *benchmark = g_new0 (MnbNetpanelBenchmark, 1);
+  guint i;
+
+  benchmark->stage = stage;
+  benchmark->netpanel = netpanel;
+  benchmark->actions = g_array_new (FALSE, FALSE, sizeof (Action));
+  for (i = 0; i < N_ACTIONS; i++)
+    benchmark->latencies[i] = g_array_new (FALSE, FALSE, sizeof (gint64));
+  benchmark->frame_times = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+  if (!benchmark_parse (benchmark, script, error))
+    {
+      for (i = 0; i < N_ACTIONS; i++)
+        g_array_free (benchmark->latencies[i], TRUE);
+      g_array_free (benchmark->frame_times, TRUE);
+      g_array_free (benchmark->actions, TRUE);
+      g_free (benchmark);
+      return FALSE;
+    }
+
+  g_signal_connect (stage, "paint",
+                    G_CALLBACK (benchmark_paint_begin_cb), benchmark);
+  g_signal_connect_after (stage, "paint",
+                          G_CALLBACK (benchmark_paint_end_cb), benchmark);
+
+  /* Let the initial show and paint settle first */
+  g_idle_add_full (G_PRIORITY_LOW, benchmark_next_action, benchmark, NULL);
+
+  return TRUE;
+}
@@ -0,0 +1,56 @@
+/* mnb-netpanel-benchmark.h */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Replays a script against a standalone panel and prints frame time
+   and per-action latency percentiles. A script has one action per
+   line:
+
+     show | hide          show or hide the panel
+     type <text>          type text into the focused entry, one key
+                          press per character
+     key <keyname>        press a key, eg. Return, Escape or Down
+     scroll <x> <y> up|down|left|right
+     click <x> <y>        button 1 press and release at stage coords
+     wait <ms>
+     repeat <n> ... end   repeat the enclosed actions, not nested
+
+   Blank lines and lines starting with '#' are ignored. */
+
+#ifndef _MNB_NETPANEL_BENCHMARK_H
+#define _MNB_NETPANEL_BENCHMARK_H
+
+#include <clutter/clutter.h>
+#include "meego-netbook-netpanel.h"
+
+G_BEGIN_DECLS
+
+/* Points $TMPDIR at a private directory holding a stub of the
+   browser's command FIFO, so tile clicks neither block nor reach a
+   real browser. Has to run before anything calls g_get_tmp_dir(). */
+gboolean mnb_netpanel_benchmark_setup (GError **error);
+
+/* Starts playback once the main loop runs. Quits the main loop when
+   the script is done. */
+gboolean mnb_netpanel_benchmark_start (ClutterActor         *stage,
+                                       MeegoNetbookNetpanel *netpanel,
+                                       const gchar          *script,
+                                       GError              **error);
+
+G_END_DECLS
+
+#endif /* _MNB_NETPANEL_BENCHMARK_H */
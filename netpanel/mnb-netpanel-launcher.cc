@@ -0,0 +1,125 @@
+/* mnb-netpanel-launcher.cc */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <gio/gio.h>
+#include <gdk/gdk.h>
+#include <clutter/clutter.h>
+
+#include "mnb-netpanel-launcher.h"
+
+static GAppInfo *browser = NULL;
+static gboolean browser_resolved = FALSE;
+
+void
+mnb_netpanel_launcher_prepare (void)
+{
+  if (browser_resolved)
+    return;
+
+  browser_resolved = TRUE;
+  browser = g_app_info_get_default_for_uri_scheme ("http");
+  if (!browser)
+    g_warning ("[netpanel] no default browser, using gvfs-open");
+}
+
+/* The command line goes through g_shell_parse_argv() and then has its
+   field codes expanded, so in one pass the URL gets the characters
+   that are special inside double quotes escaped and '%' doubled */
+static gchar *
+mnb_netpanel_launcher_build_command (const gchar *url)
+{
+  GString *exec = g_string_sized_new (strlen (url) + 16);
+  const gchar *p;
+
+  g_string_append (exec, "gvfs-open \"");
+  for (p = url; *p; p++)
+    switch (*p)
+      {
+      case '"':
+      case '\\':
+      case '$':
+      case '`':
+        g_string_append_c (exec, '\\');
+        g_string_append_c (exec, *p);
+        break;
+
+      case '%':
+        g_string_append (exec, "%%");
+        break;
+
+      default:
+        g_string_append_c (exec, *p);
+        break;
+      }
+  g_string_append_c (exec, '"');
+
+  return g_string_free (exec, FALSE);
+}
+
+static gboolean
+mnb_netpanel_launcher_launch_browser (const gchar *url)
+{
+  GdkAppLaunchContext *context;
+  GList uris = { (gpointer) url, NULL, NULL };
+  GError *error = NULL;
+  gboolean result;
+
+  context = gdk_app_launch_context_new ();
+  gdk_app_launch_context_set_timestamp (context,
+                                        clutter_get_current_event_time ());
+
+  result = g_app_info_launch_uris (browser, url ? &uris : NULL,
+                                   G_APP_LAUNCH_CONTEXT (context), &error);
+  if (!result)
+    {
+      g_warning ("[netpanel] unable to launch %s: %s",
+                 g_app_info_get_name (browser), error->message);
+      g_error_free (error);
+    }
+
+  g_object_unref (context);
+
+  return result;
+}
+
+gboolean
+mnb_netpanel_launcher_launch (MplPanelClient *panel_client,
+                              const gchar    *url)
+{
+  gchar *exec;
+  gboolean result;
+
+  mnb_netpanel_launcher_prepare ();
+
+  if (browser && mnb_netpanel_launcher_launch_browser (url))
+    return TRUE;
+
+  if (!panel_client)
+    return FALSE;
+
+  exec = mnb_netpanel_launcher_build_command (url ? url : "http://");
+  result = mpl_panel_client_launch_application (panel_client, exec);
+  g_free (exec);
+
+  return result;
+}
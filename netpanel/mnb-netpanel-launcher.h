@@ -0,0 +1,42 @@
+/* mnb-netpanel-launcher.h */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Starts the browser for URLs that can't be handed to a running one.
+   The default handler for http is looked up once and launched
+   directly. If there is none, or launching it fails, the URL goes to
+   'gvfs-open' through the shell as before. */
+
+#ifndef _MNB_NETPANEL_LAUNCHER_H
+#define _MNB_NETPANEL_LAUNCHER_H
+
+#include <glib.h>
+#include <meego-panel/mpl-panel-client.h>
+
+G_BEGIN_DECLS
+
+/* Looks up the default browser if that hasn't been done yet, so the
+   first click doesn't pay for it */
+void     mnb_netpanel_launcher_prepare (void);
+
+/* Starts the browser on 'url', or on nothing if 'url' is NULL */
+gboolean mnb_netpanel_launcher_launch  (MplPanelClient *panel_client,
+                                        const gchar    *url);
+
+G_END_DECLS
+
+#endif /* _MNB_NETPANEL_LAUNCHER_H */
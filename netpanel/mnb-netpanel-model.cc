@@ -0,0 +1,530 @@
+/* mnb-netpanel-model.cc */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gio/gio.h>
+#include <sqlite3.h>
+#include <clutter/clutter.h>
+
+#include "mnb-netpanel-model.h"
+#include "mwb-stats.h"
+#include "mwb-top-sites.h"
+#include "mwb-utils.h"
+
+/* The favicon comes along with each tab, a subquery rather than a join
+   so a URL that is in history twice doesn't show its tab twice */
+#define TAB_SQL "SELECT tab_id, url, title, " \
+                "(SELECT favicons.url FROM urls " \
+                "JOIN favicons ON favicons.id = urls.favicon_id " \
+                "WHERE urls.url = current_tabs.url LIMIT 1) " \
+                "FROM current_tabs LIMIT ?1"
+#define TAB_MAX 256
+
+/* Roughly what fits in the panel without scrolling, the rest are
+   decoded by their tiles */
+#define DECODE_TABS_MAX 8
+
+/* The browser writes the database and thumbnails in bursts */
+#define REFRESH_DELAY 500
+
+typedef struct
+{
+  MnbNetpanelModel         *model;
+  MnbNetpanelModelSection   section;
+  GThread                  *thread;
+
+  /* Protected by the model's lock */
+  gboolean                  dirty;
+  MnbNetpanelModelSnapshot *latest;
+  guint                     ready_source;
+} MnbNetpanelModelWorker;
+
+struct _MnbNetpanelModel
+{
+  gint                      thumbnail_width;
+  gint                      thumbnail_height;
+  gint                      favicon_size;
+
+  MnbNetpanelModelReadyFunc ready_func;
+  gpointer                  ready_data;
+
+  MnbNetpanelModelWorker    workers[MNB_NETPANEL_MODEL_N_SECTIONS];
+
+  /* Protects the workers' state and 'quit' */
+  GMutex                   *lock;
+  GCond                    *cond;
+  gboolean                  quit;
+
+  /* Only used from the main thread */
+  gboolean                  visible;
+  guint                     refresh_source;
+  GFileMonitor             *places_monitor;
+  GFileMonitor             *thumbnails_monitor;
+};
+
+static void
+mnb_netpanel_model_items_free (GArray *items)
+{
+  guint i;
+
+  for (i = 0; i < items->len; i++)
+    {
+      MnbNetpanelModelItem *item
+        = &g_array_index (items, MnbNetpanelModelItem, i);
+
+      g_free (item->url);
+      g_free (item->title);
+      g_free (item->favicon_filename);
+      if (item->thumbnail)
+        g_object_unref (item->thumbnail);
+      if (item->favicon)
+        g_object_unref (item->favicon);
+    }
+
+  g_array_free (items, TRUE);
+}
+
+void
+mnb_netpanel_model_snapshot_unref (MnbNetpanelModelSnapshot *snapshot)
+{
+  if (!g_atomic_int_dec_and_test (&snapshot->ref_count))
+    return;
+
+  mnb_netpanel_model_items_free (snapshot->items);
+  g_slice_free (MnbNetpanelModelSnapshot, snapshot);
+}
+
+static void
+mnb_netpanel_model_add_item (GArray      *items,
+                             gint         tab_id,
+                             const gchar *url,
+                             const gchar *title,
+                             gchar       *favicon_filename)
+{
+  MnbNetpanelModelItem item = { 0, };
+
+  item.tab_id = tab_id;
+  item.url = g_strdup (url);
+  item.title = g_strdup (title);
+  item.favicon_filename = favicon_filename;
+
+  g_array_append_val (items, item);
+}
+
+static void
+mnb_netpanel_model_read_tabs (GArray *tabs)
+{
+  gchar *places_db = mwb_utils_places_db_get_filename ();
+  sqlite3 *dbcon = NULL;
+  sqlite3_stmt *stmt;
+
+  /* Nothing here writes, so this never waits on the favorites */
+  if (mwb_utils_places_db_connect_readonly (places_db, &dbcon))
+    {
+      g_free (places_db);
+      return;
+    }
+  g_free (places_db);
+
+  if (sqlite3_prepare_v2 (dbcon, TAB_SQL, -1, &stmt, NULL) != SQLITE_OK)
+    {
+      g_warning ("[netpanel] sqlite3_prepare_v2():tab_stmt %s",
+                 sqlite3_errmsg (dbcon));
+      mwb_utils_places_db_close (dbcon);
+      return;
+    }
+  sqlite3_bind_int (stmt, 1, TAB_MAX);
+
+  while (sqlite3_step (stmt) == SQLITE_ROW)
+    {
+      const gchar *favicon_url = (const gchar *) sqlite3_column_text (stmt, 3);
+      gchar *favicon_filename = NULL;
+
+      if (favicon_url)
+        {
+          favicon_filename = mwb_utils_get_cache_filename ("favicons",
+                                                           favicon_url,
+                                                           ".ico");
+          if (!g_file_test (favicon_filename, G_FILE_TEST_EXISTS))
+            {
+              g_free (favicon_filename);
+              favicon_filename = NULL;
+            }
+        }
+
+      mnb_netpanel_model_add_item (tabs,
+                                   sqlite3_column_int (stmt, 0),
+                                   (const gchar *) sqlite3_column_text (stmt, 1),
+                                   (const gchar *) sqlite3_column_text (stmt, 2),
+                                   favicon_filename);
+    }
+
+  sqlite3_finalize (stmt);
+  mwb_utils_places_db_close (dbcon);
+}
+
+static void
+mnb_netpanel_model_read_favorites (GArray *favorites)
+{
+  gchar *places_db = mwb_utils_places_db_get_filename ();
+  sqlite3 *dbcon = NULL;
+  sqlite3_stmt *stmt;
+
+  /* Read-write as topsites.db is attached to it */
+  if (mwb_utils_places_db_connect (places_db, &dbcon))
+    {
+      g_free (places_db);
+      return;
+    }
+
+  /* Only does any work if the history or the thumbnails changed */
+  mwb_top_sites_update (dbcon, places_db);
+  g_free (places_db);
+
+  if (sqlite3_prepare_v2 (dbcon, MWB_TOP_SITES_SQL, -1,
+                          &stmt, NULL) != SQLITE_OK)
+    {
+      g_warning ("[netpanel] sqlite3_prepare_v2():fav_stmt %s",
+                 sqlite3_errmsg (dbcon));
+      mwb_utils_places_db_close (dbcon);
+      return;
+    }
+  sqlite3_bind_int (stmt, 1, MNB_NETPANEL_MODEL_N_FAVORITES);
+
+  while (sqlite3_step (stmt) == SQLITE_ROW)
+    mnb_netpanel_model_add_item (favorites, 0,
+                                 (const gchar *) sqlite3_column_text (stmt, 0),
+                                 (const gchar *) sqlite3_column_text (stmt, 1),
+                                 g_strdup ((const gchar *)
+                                           sqlite3_column_text (stmt, 2)));
+
+  sqlite3_finalize (stmt);
+  mwb_utils_places_db_close (dbcon);
+}
+
+static void
+mnb_netpanel_model_decode (MnbNetpanelModel     *model,
+                           MnbNetpanelModelItem *item)
+{
+  gchar *path;
+
+  if (!item->url)
+    return;
+
+  /* A missing file is fine, the tile shows the fallback */
+  path = mwb_utils_get_cache_filename ("thumbnails", item->url, ".png");
+  item->thumbnail = gdk_pixbuf_new_from_file_at_size (path,
+                                                      model->thumbnail_width,
+                                                      model->thumbnail_height,
+                                                      NULL);
+  g_free (path);
+
+  if (item->favicon_filename)
+    item->favicon = gdk_pixbuf_new_from_file_at_size (item->favicon_filename,
+                                                      model->favicon_size,
+                                                      model->favicon_size,
+                                                      NULL);
+}
+
+static MnbNetpanelModelSnapshot *
+mnb_netpanel_model_build (MnbNetpanelModel        *model,
+                          MnbNetpanelModelSection  section)
+{
+  MnbNetpanelModelSnapshot *snapshot;
+  guint i, n_decode;
+
+  snapshot = g_slice_new (MnbNetpanelModelSnapshot);
+  snapshot->ref_count = 1;
+  snapshot->items = g_array_new (FALSE, FALSE, sizeof (MnbNetpanelModelItem));
+
+  if (section == MNB_NETPANEL_MODEL_TABS)
+    {
+      mnb_netpanel_model_read_tabs (snapshot->items);
+      n_decode = MIN (snapshot->items->len, DECODE_TABS_MAX);
+    }
+  else
+    {
+      mnb_netpanel_model_read_favorites (snapshot->items);
+      n_decode = snapshot->items->len;
+    }
+
+  for (i = 0; i < n_decode; i++)
+    mnb_netpanel_model_decode (model, &g_array_index (snapshot->items,
+                                                      MnbNetpanelModelItem,
+                                                      i));
+
+  return snapshot;
+}
+
+static gboolean
+mnb_netpanel_model_ready_cb (gpointer data)
+{
+  MnbNetpanelModelWorker *worker = (MnbNetpanelModelWorker *) data;
+  MnbNetpanelModel *model = worker->model;
+
+  mwb_stats_wakeup (MWB_STATS_WAKEUP_MODEL);
+
+  g_mutex_lock (model->lock);
+  worker->ready_source = 0;
+  g_mutex_unlock (model->lock);
+
+  if (model->ready_func)
+    model->ready_func (model, worker->section, model->ready_data);
+
+  return FALSE;
+}
+
+static gpointer
+mnb_netpanel_model_thread (gpointer data)
+{
+  MnbNetpanelModelWorker *worker = (MnbNetpanelModelWorker *) data;
+  MnbNetpanelModel *model = worker->model;
+
+  g_mutex_lock (model->lock);
+
+  while (!model->quit)
+    {
+      MnbNetpanelModelSnapshot *snapshot, *old;
+
+      if (!worker->dirty)
+        {
+          g_cond_wait (model->cond, model->lock);
+          continue;
+        }
+
+      worker->dirty = FALSE;
+      g_mutex_unlock (model->lock);
+
+      snapshot = mnb_netpanel_model_build (model, worker->section);
+
+      g_mutex_lock (model->lock);
+      old = worker->latest;
+      worker->latest = snapshot;
+      if (!worker->ready_source)
+        worker->ready_source
+          = clutter_threads_add_idle (mnb_netpanel_model_ready_cb, worker);
+
+      if (old)
+        {
+          g_mutex_unlock (model->lock);
+          mnb_netpanel_model_snapshot_unref (old);
+          g_mutex_lock (model->lock);
+        }
+    }
+
+  g_mutex_unlock (model->lock);
+
+  return NULL;
+}
+
+static void
+mnb_netpanel_model_refresh (MnbNetpanelModel *model)
+{
+  guint i;
+
+  g_mutex_lock (model->lock);
+  for (i = 0; i < MNB_NETPANEL_MODEL_N_SECTIONS; i++)
+    model->workers[i].dirty = TRUE;
+  g_cond_broadcast (model->cond);
+  g_mutex_unlock (model->lock);
+}
+
+static gboolean
+mnb_netpanel_model_refresh_cb (gpointer data)
+{
+  MnbNetpanelModel *model = (MnbNetpanelModel *) data;
+
+  mwb_stats_wakeup (MWB_STATS_WAKEUP_MODEL);
+
+  model->refresh_source = 0;
+  mnb_netpanel_model_refresh (model);
+
+  return FALSE;
+}
+
+static void
+mnb_netpanel_model_changed_cb (GFileMonitor      *monitor,
+                               GFile             *file,
+                               GFile             *other_file,
+                               GFileMonitorEvent  event,
+                               MnbNetpanelModel  *model)
+{
+  /* Hiding refreshes anyway */
+  if (model->visible)
+    return;
+
+  if (model->refresh_source)
+    g_source_remove (model->refresh_source);
+  model->refresh_source
+    = clutter_threads_add_timeout (REFRESH_DELAY,
+                                   mnb_netpanel_model_refresh_cb, model);
+}
+
+static GFileMonitor *
+mnb_netpanel_model_monitor (MnbNetpanelModel *model,
+                            const gchar      *path,
+                            gboolean          directory)
+{
+  GFile *file = g_file_new_for_path (path);
+  GError *error = NULL;
+  GFileMonitor *monitor;
+
+  monitor = directory
+    ? g_file_monitor_directory (file, G_FILE_MONITOR_NONE, NULL, &error)
+    : g_file_monitor_file (file, G_FILE_MONITOR_NONE, NULL, &error);
+  g_object_unref (file);
+
+  if (!monitor)
+    {
+      g_warning ("[netpanel] unable to monitor %s: %s", path, error->message);
+      g_error_free (error);
+      return NULL;
+    }
+
+  g_signal_connect (monitor, "changed",
+                    G_CALLBACK (mnb_netpanel_model_changed_cb), model);
+
+  return monitor;
+}
+
+MnbNetpanelModel *
+mnb_netpanel_model_new (gint                      thumbnail_width,
+                        gint                      thumbnail_height,
+                        gint                      favicon_size,
+                        MnbNetpanelModelReadyFunc ready_func,
+                        gpointer                  data)
+{
+  MnbNetpanelModel *model = g_slice_new0 (MnbNetpanelModel);
+  gchar *path;
+  guint i;
+
+  model->thumbnail_width = thumbnail_width;
+  model->thumbnail_height = thumbnail_height;
+  model->favicon_size = favicon_size;
+  model->ready_func = ready_func;
+  model->ready_data = data;
+  model->lock = g_mutex_new ();
+  model->cond = g_cond_new ();
+
+  /* Watched even if they don't exist yet, the browser creates them */
+  path = g_build_filename (mwb_utils_get_netpanel_dir (), "chromium.db", NULL);
+  model->places_monitor = mnb_netpanel_model_monitor (model, path, FALSE);
+  g_free (path);
+  path = g_build_filename (mwb_utils_get_netpanel_dir (), "thumbnails", NULL);
+  model->thumbnails_monitor = mnb_netpanel_model_monitor (model, path, TRUE);
+  g_free (path);
+
+  for (i = 0; i < MNB_NETPANEL_MODEL_N_SECTIONS; i++)
+    {
+      MnbNetpanelModelWorker *worker = &model->workers[i];
+      GError *error = NULL;
+
+      worker->model = model;
+      worker->section = (MnbNetpanelModelSection) i;
+      worker->dirty = TRUE;
+      worker->thread = g_thread_create (mnb_netpanel_model_thread, worker,
+                                        TRUE, &error);
+      if (!worker->thread)
+        {
+          g_warning ("[netpanel] unable to start model thread: %s",
+                     error->message);
+          g_error_free (error);
+        }
+    }
+
+  return model;
+}
+
+void
+mnb_netpanel_model_free (MnbNetpanelModel *model)
+{
+  guint i;
+
+  g_mutex_lock (model->lock);
+  model->quit = TRUE;
+  g_cond_broadcast (model->cond);
+  g_mutex_unlock (model->lock);
+
+  for (i = 0; i < MNB_NETPANEL_MODEL_N_SECTIONS; i++)
+    {
+      MnbNetpanelModelWorker *worker = &model->workers[i];
+
+      if (worker->thread)
+        g_thread_join (worker->thread);
+      if (worker->ready_source)
+        g_source_remove (worker->ready_source);
+      if (worker->latest)
+        mnb_netpanel_model_snapshot_unref (worker->latest);
+    }
+
+  if (model->refresh_source)
+    g_source_remove (model->refresh_source);
+  if (model->places_monitor)
+    g_object_unref (model->places_monitor);
+  if (model->thumbnails_monitor)
+    g_object_unref (model->thumbnails_monitor);
+
+  g_cond_free (model->cond);
+  g_mutex_free (model->lock);
+  g_slice_free (MnbNetpanelModel, model);
+}
+
+void
+mnb_netpanel_model_set_visible (MnbNetpanelModel *model,
+                                gboolean          visible)
+{
+  if (model->visible == visible)
+    return;
+
+  model->visible = visible;
+
+  if (!visible)
+    mnb_netpanel_model_refresh (model);
+  else if (model->refresh_source)
+    {
+      g_source_remove (model->refresh_source);
+      model->refresh_source = 0;
+    }
+}
+
+MnbNetpanelModelSnapshot *
+mnb_netpanel_model_get_snapshot (MnbNetpanelModel        *model,
+                                 MnbNetpanelModelSection  section)
+{
+  MnbNetpanelModelWorker *worker = &model->workers[section];
+  MnbNetpanelModelSnapshot *snapshot;
+
+  /* Without the thread there's nobody else to build it */
+  if (!worker->thread)
+    {
+      if (worker->latest)
+        mnb_netpanel_model_snapshot_unref (worker->latest);
+      worker->latest = mnb_netpanel_model_build (model, section);
+    }
+
+  g_mutex_lock (model->lock);
+  snapshot = worker->latest;
+  if (snapshot)
+    g_atomic_int_inc (&snapshot->ref_count);
+  g_mutex_unlock (model->lock);
+
+  return snapshot;
+}
@@ -0,0 +1,106 @@
+/* mnb-netpanel-model.h */
+/*
+ * Copyright (c) 2010 Intel Corp.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* What the panel shows, the open tabs and the favorite pages, kept up
+   to date by background threads while the panel is hidden.
+
+   Each section has its own thread and its own connection, so a slow
+   favorites update never holds up the tabs or the other way round.
+   A thread rebuilds a complete snapshot of its section whenever the
+   places database or the thumbnails directory changes, then swaps it
+   in as the latest one and tells the main loop it is ready. Showing
+   the panel takes a reference to the latest snapshot of each section
+   and builds the tiles from it, so it never queries the database or
+   decodes the first thumbnails itself. While the panel is shown the
+   snapshots in use stay as they are and changes are only picked up
+   after it hides. */
+
+#ifndef _MNB_NETPANEL_MODEL_H
+#define _MNB_NETPANEL_MODEL_H
+
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+#define MNB_NETPANEL_MODEL_N_FAVORITES 9
+
+typedef struct _MnbNetpanelModel MnbNetpanelModel;
+
+typedef struct
+{
+  gint       tab_id;
+  gchar     *url;
+  gchar     *title;
+
+  /* NULL if the file doesn't exist */
+  gchar     *favicon_filename;
+
+  /* Decoded at tile size for the tiles shown first, otherwise NULL and
+     the tile loads the files itself */
+  GdkPixbuf *thumbnail;
+  GdkPixbuf *favicon;
+} MnbNetpanelModelItem;
+
+typedef enum
+{
+  MNB_NETPANEL_MODEL_TABS,
+  MNB_NETPANEL_MODEL_FAVORITES,
+
+  MNB_NETPANEL_MODEL_N_SECTIONS
+} MnbNetpanelModelSection;
+
+typedef struct
+{
+  volatile gint  ref_count;
+
+  /* Array of MnbNetpanelModelItem */
+  GArray        *items;
+} MnbNetpanelModelSnapshot;
+
+/* Called from the main loop each time a section has a new snapshot */
+typedef void (* MnbNetpanelModelReadyFunc) (MnbNetpanelModel        *model,
+                                            MnbNetpanelModelSection  section,
+                                            gpointer                 data);
+
+MnbNetpanelModel *
+mnb_netpanel_model_new (gint                      thumbnail_width,
+                        gint                      thumbnail_height,
+                        gint                      favicon_size,
+                        MnbNetpanelModelReadyFunc ready_func,
+                        gpointer                  data);
+
+void mnb_netpanel_model_free (MnbNetpanelModel *model);
+
+/* Pauses refreshing while the panel is shown. Hiding it again
+   refreshes as the browser has most likely changed something. */
+void mnb_netpanel_model_set_visible (MnbNetpanelModel *model,
+                                     gboolean          visible);
+
+/* Returns a reference to the latest complete snapshot of 'section', or
+   NULL if the first one is still being built, in which case the ready
+   function is called once it is there */
+MnbNetpanelModelSnapshot *
+mnb_netpanel_model_get_snapshot (MnbNetpanelModel        *model,
+                                 MnbNetpanelModelSection  section);
+
+void mnb_netpanel_model_snapshot_unref (MnbNetpanelModelSnapshot *snapshot);
+
+G_END_DECLS
+
+#endif /* _MNB_NETPANEL_MODEL_H */
@@ -19,6 +19,8 @@
 #include "mnb-netpanel-scrollview.h"
 #include "meego-netbook-netpanel.h"
 #include "mwb-utils.h"
+#include "mwb-trace.h"
+#include "mwb-texture-budget.h"
 
 /* FIXME: replace with styles or properties */
 #define MAX_DISPLAY 4
@@ -36,8 +38,11 @@ G_DEFINE_TYPE (MnbNetpanelScrollview, mnb_netpanel_scrollview, MX_TYPE_WIDGET)
 typedef struct
 {
   ClutterActor *box;
+  /* Inside the box, gets the crossing and button events */
+  ClutterActor *button;
   guint order;
   gfloat position;
+  MwbTextureBudgetEntry *budget;
 } ItemProps;
 
 struct _MnbNetpanelScrollviewPrivate
@@ -50,6 +55,14 @@ struct _MnbNetpanelScrollviewPrivate
   gint            scroll_page;
   gint            scroll_item;
   gint            scroll_total;
+
+  /* The item button the pointer is over */
+  ClutterActor   *hover_button;
+  /* Where the pointer was last seen over the view, in stage
+     coordinates, to find the hovered item again after scrolling */
+  gboolean        pointer_inside;
+  gfloat          pointer_x;
+  gfloat          pointer_y;
 };
 
 static void
@@ -58,6 +71,8 @@ mnb_netpanel_scrollview_dispose (GObject *object)
   MnbNetpanelScrollview *self = MNB_NETPANEL_SCROLLVIEW (object);
   MnbNetpanelScrollviewPrivate *priv = self->priv;
 
+  priv->hover_button = NULL;
+
   while (priv->items)
     {
       ItemProps *props = (ItemProps*)priv->items->data;
@@ -101,6 +116,8 @@ mnb_netpanel_scrollview_allocate (ClutterActor           *actor,
   if (!priv->items)
     return;
 
+  MWB_TRACE_BEGIN ("scrollview-allocate");
+
   mx_widget_get_padding (MX_WIDGET (actor), &padding);
   padding.left   = MWB_PIXBOUND (padding.left);
   padding.top    = MWB_PIXBOUND (padding.top);
@@ -160,6 +177,8 @@ mnb_netpanel_scrollview_allocate (ClutterActor           *actor,
       clutter_actor_allocate (CLUTTER_ACTOR (priv->scroll_bar), &child_box,
                               flags);
     }
+
+  MWB_TRACE_END ("scrollview-allocate");
 }
 
 static void
@@ -254,6 +273,8 @@ mnb_netpanel_scrollview_paint (ClutterActor *actor)
   MnbNetpanelScrollviewPrivate *priv = MNB_NETPANEL_SCROLLVIEW (actor)->priv;
   ClutterActorBox alloc_box;
 
+  MWB_TRACE_BEGIN ("scrollview-paint");
+
   /* Chain up to get the background */
   CLUTTER_ACTOR_CLASS (mnb_netpanel_scrollview_parent_class)->paint (actor);
 
@@ -278,6 +299,8 @@ mnb_netpanel_scrollview_paint (ClutterActor *actor)
 
       if (CLUTTER_ACTOR_IS_MAPPED (props->box))
         {
+          if (props->budget)
+            mwb_texture_budget_touch (props->budget);
           clutter_actor_paint (props->box);
         }
     }
@@ -289,12 +312,20 @@ mnb_netpanel_scrollview_paint (ClutterActor *actor)
     clutter_actor_paint (CLUTTER_ACTOR (priv->scroll_bar));
 
   cogl_clip_pop ();
+
+  MWB_TRACE_END ("scrollview-paint");
 }
 
+/* Only the view itself and the scroll bar go in the pick buffer. The
+   item under the pointer is found from the item layout and its button
+   gets the events passed on, so picking never has to go through the
+   thumbnails. */
 static void
 mnb_netpanel_scrollview_pick (ClutterActor       *actor,
                               const ClutterColor *color)
 {
+  MnbNetpanelScrollviewPrivate *priv = MNB_NETPANEL_SCROLLVIEW (actor)->priv;
+
   cogl_set_source_color4ub (color->red,
                             color->green,
                             color->blue,
@@ -303,7 +334,155 @@ mnb_netpanel_scrollview_pick (ClutterActor       *actor,
                   clutter_actor_get_width (actor),
                   clutter_actor_get_height (actor));
 
-  mnb_netpanel_scrollview_paint (actor);
+  if (CLUTTER_ACTOR_IS_MAPPED (priv->scroll_bar))
+    clutter_actor_paint (CLUTTER_ACTOR (priv->scroll_bar));
+}
+
+static ClutterActor *
+mnb_netpanel_scrollview_get_button_at_pos (MnbNetpanelScrollview *self,
+                                           gfloat                 stage_x,
+                                           gfloat                 stage_y)
+{
+  MnbNetpanelScrollviewPrivate *priv = self->priv;
+  ClutterActor *actor = CLUTTER_ACTOR (self);
+  gfloat x, y;
+  GList *item;
+
+  if (!clutter_actor_transform_stage_point (actor, stage_x, stage_y, &x, &y)
+      || x < 0 || x >= clutter_actor_get_width (actor)
+      || y < 0 || y >= clutter_actor_get_height (actor))
+    return NULL;
+
+  /* Items are laid out left to right, scrolled by the offset */
+  x += priv->scroll_offset;
+
+  for (item = priv->items; item != NULL; item = item->next)
+    {
+      ItemProps *props = (ItemProps*)item->data;
+      ClutterActorBox box, button_box;
+
+      if (props->position > x)
+        break;
+
+      if (!props->button
+          || !CLUTTER_ACTOR_IS_MAPPED (props->button)
+          || !clutter_actor_get_reactive (props->button))
+        continue;
+
+      clutter_actor_get_allocation_box (props->box, &box);
+      if (x >= box.x2 || y < box.y1 || y >= box.y2)
+        continue;
+
+      clutter_actor_get_allocation_box (props->button, &button_box);
+      if (x - box.x1 >= button_box.x1 && x - box.x1 < button_box.x2
+          && y - box.y1 >= button_box.y1 && y - box.y1 < button_box.y2)
+        return props->button;
+    }
+
+  return NULL;
+}
+
+static void
+mnb_netpanel_scrollview_send_crossing (ClutterActor     *button,
+                                       ClutterEventType  type,
+                                       gfloat            stage_x,
+                                       gfloat            stage_y)
+{
+  ClutterEvent *event = clutter_event_new (type);
+
+  event->crossing.stage = CLUTTER_STAGE (clutter_actor_get_stage (button));
+  event->crossing.time = clutter_get_current_event_time ();
+  event->crossing.source = button;
+  event->crossing.x = stage_x;
+  event->crossing.y = stage_y;
+
+  clutter_actor_event (button, event, FALSE);
+  clutter_event_free (event);
+}
+
+static void
+mnb_netpanel_scrollview_set_hover (MnbNetpanelScrollview *self,
+                                   ClutterActor          *button)
+{
+  MnbNetpanelScrollviewPrivate *priv = self->priv;
+
+  if (priv->hover_button == button)
+    return;
+
+  if (priv->hover_button)
+    mnb_netpanel_scrollview_send_crossing (priv->hover_button, CLUTTER_LEAVE,
+                                           priv->pointer_x, priv->pointer_y);
+
+  priv->hover_button = button;
+
+  if (button)
+    mnb_netpanel_scrollview_send_crossing (button, CLUTTER_ENTER,
+                                           priv->pointer_x, priv->pointer_y);
+}
+
+/* Moves the hover to the item under the last pointer position */
+static void
+mnb_netpanel_scrollview_update_hover (MnbNetpanelScrollview *self)
+{
+  MnbNetpanelScrollviewPrivate *priv = self->priv;
+  ClutterActor *button = NULL;
+
+  if (priv->pointer_inside)
+    button = mnb_netpanel_scrollview_get_button_at_pos (self,
+                                                        priv->pointer_x,
+                                                        priv->pointer_y);
+
+  mnb_netpanel_scrollview_set_hover (self, button);
+}
+
+static gboolean
+mnb_netpanel_scrollview_motion_event (ClutterActor       *actor,
+                                      ClutterMotionEvent *event)
+{
+  MnbNetpanelScrollview *self = MNB_NETPANEL_SCROLLVIEW (actor);
+  MnbNetpanelScrollviewPrivate *priv = self->priv;
+
+  priv->pointer_inside = TRUE;
+  priv->pointer_x = event->x;
+  priv->pointer_y = event->y;
+  mnb_netpanel_scrollview_update_hover (self);
+
+  return FALSE;
+}
+
+static gboolean
+mnb_netpanel_scrollview_leave_event (ClutterActor         *actor,
+                                     ClutterCrossingEvent *event)
+{
+  MnbNetpanelScrollview *self = MNB_NETPANEL_SCROLLVIEW (actor);
+
+  self->priv->pointer_inside = FALSE;
+  mnb_netpanel_scrollview_update_hover (self);
+
+  return FALSE;
+}
+
+/* The button grabs the pointer on press, so it gets the release and
+   emits "clicked" itself */
+static gboolean
+mnb_netpanel_scrollview_button_press_event (ClutterActor       *actor,
+                                            ClutterButtonEvent *event)
+{
+  MnbNetpanelScrollview *self = MNB_NETPANEL_SCROLLVIEW (actor);
+  MnbNetpanelScrollviewPrivate *priv = self->priv;
+  ClutterActor *button;
+
+  button = mnb_netpanel_scrollview_get_button_at_pos (self,
+                                                      event->x, event->y);
+  if (!button)
+    return FALSE;
+
+  priv->pointer_inside = TRUE;
+  priv->pointer_x = event->x;
+  priv->pointer_y = event->y;
+  mnb_netpanel_scrollview_set_hover (self, button);
+
+  return clutter_actor_event (button, (ClutterEvent *) event, FALSE);
 }
 
 static gboolean
@@ -335,6 +514,9 @@ mnb_netpanel_scrollview_class_init (MnbNetpanelScrollviewClass *klass)
     mnb_netpanel_scrollview_get_preferred_height;
   actor_class->paint = mnb_netpanel_scrollview_paint;
   actor_class->pick = mnb_netpanel_scrollview_pick;
+  actor_class->motion_event = mnb_netpanel_scrollview_motion_event;
+  actor_class->leave_event = mnb_netpanel_scrollview_leave_event;
+  actor_class->button_press_event = mnb_netpanel_scrollview_button_press_event;
   actor_class->captured_event = mnb_netpanel_scrollview_captured_event;
 }
 
@@ -383,6 +565,7 @@ mnb_netpanel_scrollview_scroll_event_cb (ClutterActor       *actor,
   if (offset != priv->scroll_offset)
     {
       priv->scroll_offset = offset;
+      mnb_netpanel_scrollview_update_hover (self);
       mx_adjustment_set_value (priv->scroll_adjustment, (gdouble)offset);
     }
 
@@ -400,6 +583,7 @@ mnb_netpanel_scrollview_scroll_value_cb (MxAdjustment        *adjustment,
   if (value != priv->scroll_offset)
     {
       priv->scroll_offset = value;
+      mnb_netpanel_scrollview_update_hover (self);
       clutter_actor_queue_relayout (CLUTTER_ACTOR (self));
     }
 }
@@ -434,7 +618,8 @@ mnb_netpanel_scrollview_new (void)
 void
 mnb_netpanel_scrollview_add_item (MnbNetpanelScrollview *self,
                                   guint                  order,
-                                  ClutterActor          *box)
+                                  ClutterActor          *box,
+                                  ClutterActor          *button)
 {
   GList *i;
   ItemProps *props;
@@ -444,6 +629,7 @@ mnb_netpanel_scrollview_add_item (MnbNetpanelScrollview *self,
 
   props = g_slice_new0 (ItemProps);
   props->box = box;
+  props->button = button;
   props->order = order;
 
   for (i = priv->items; i != NULL; i = i->next)
@@ -458,3 +644,24 @@ mnb_netpanel_scrollview_add_item (MnbNetpanelScrollview *self,
   if (g_list_length (priv->items) > MAX_DISPLAY)
     clutter_actor_show (CLUTTER_ACTOR (priv->scroll_bar));
 }
+
+/* Items with a budget entry are touched whenever they are painted, so
+   only the textures of items scrolled out of view get evicted */
+void
+mnb_netpanel_scrollview_set_item_budget (MnbNetpanelScrollview *self,
+                                         ClutterActor          *box,
+                                         MwbTextureBudgetEntry *budget)
+{
+  GList *i;
+  MnbNetpanelScrollviewPrivate *priv = self->priv;
+
+  for (i = priv->items; i != NULL; i = i->next)
+    {
+      ItemProps *props = (ItemProps*)i->data;
+      if (props->box == box)
+        {
+          props->budget = budget;
+          break;
+        }
+    }
+}
@@ -23,6 +23,7 @@
 extern "C" {
 #include <clutter/clutter.h>
 #include <meego-panel/mpl-entry.h>
+#include "mwb-texture-budget.h"
 }
 
 G_BEGIN_DECLS
@@ -66,9 +67,16 @@ GType mnb_netpanel_scrollview_get_type (void);
 
 MxWidget *mnb_netpanel_scrollview_new ();
 
+/* 'button' is the reactive child of 'box' the item's pointer events
+   are passed on to, as the items themselves are never picked */
 void mnb_netpanel_scrollview_add_item (MnbNetpanelScrollview *self,
                                        guint                  order,
-                                       ClutterActor          *box);
+                                       ClutterActor          *box,
+                                       ClutterActor          *button);
+
+void mnb_netpanel_scrollview_set_item_budget (MnbNetpanelScrollview *self,
+                                              ClutterActor          *box,
+                                              MwbTextureBudgetEntry *budget);
 
 G_END_DECLS
 
@@ -0,0 +1,451 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Replays typing a handful of words one keystroke at a time against
+   generated chromium.db files and reports per-keystroke latency
+   percentiles and allocation counts for each stage of what MwbAcList
+   does on a text change. Only the data side is exercised so nothing
+   here needs a display. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <sqlite3.h>
+
+#include "mwb-ac-query.h"
+#include "mwb-arena.h"
+#include "mwb-stats.h"
+#include "mwb-profile-gen.h"
+
+/* Same as MWB_AC_LIST_MAX_ENTRIES */
+#define BENCH_MAX_ENTRIES 15
+
+static const gchar *bench_words[] =
+  {
+    "news", "mail", "wiki", "forum", "shop", "maps.", "video.com",
+    "http://www.", "linux/kernel", "Uutiset", "新闻", "zzqx"
+  };
+
+static const gchar *bench_tlds[] =
+  {
+    ".com", ".org", ".net", ".co.uk", ".fi", ".de", ".jp", ".com.cn"
+  };
+
+enum
+{
+  PHASE_QUERY,
+  PHASE_MATCH,
+  PHASE_FAVICON,
+  PHASE_COMPLETE,
+  PHASE_TOTAL,
+
+  N_PHASES
+};
+
+static const gchar *phase_names[N_PHASES] =
+  {
+    "set-search-text", "stristr", "favicon", "complete-domain", "keystroke"
+  };
+
+typedef struct
+{
+  GArray *usecs;
+  GArray *allocs;
+} BenchPhase;
+
+static gchar  *sizes_arg = NULL;
+static gchar  *db_arg = NULL;
+static gint    iterations = 3;
+static gboolean keep = FALSE;
+
+static GOptionEntry entries[] = {
+  { "sizes", 's', 0, G_OPTION_ARG_STRING, &sizes_arg,
+    "Comma separated history sizes to generate (default 1000,10000,100000,1000000)",
+    "<n,...>" },
+  { "db", 'd', 0, G_OPTION_ARG_FILENAME, &db_arg,
+    "Benchmark an existing chromium.db instead of generated ones", "<file>" },
+  { "iterations", 'i', 0, G_OPTION_ARG_INT, &iterations,
+    "Number of times to replay the typed words", "<n>" },
+  { "keep", 'k', 0, G_OPTION_ARG_NONE, &keep,
+    "Leave the generated profiles behind", NULL },
+  { NULL }
+};
+
+/* Allocation counting. Both GLib and SQLite allocations are routed
+   through these so a keystroke's cost can be read off a counter. */
+
+static volatile gint bench_n_allocs = 0;
+
+static gpointer
+bench_malloc (gsize n_bytes)
+{
+  g_atomic_int_inc (&bench_n_allocs);
+  return malloc (n_bytes);
+}
+
+static gpointer
+bench_realloc (gpointer mem, gsize n_bytes)
+{
+  g_atomic_int_inc (&bench_n_allocs);
+  return realloc (mem, n_bytes);
+}
+
+static gpointer
+bench_calloc (gsize n_blocks, gsize n_block_bytes)
+{
+  g_atomic_int_inc (&bench_n_allocs);
+  return calloc (n_blocks, n_block_bytes);
+}
+
+static GMemVTable bench_mem_vtable =
+  {
+    bench_malloc,
+    bench_realloc,
+    free,
+    bench_calloc,
+    bench_malloc,
+    bench_realloc
+  };
+
+static sqlite3_mem_methods bench_sqlite_default_methods;
+
+static void *
+bench_sqlite_malloc (int n_bytes)
+{
+  g_atomic_int_inc (&bench_n_allocs);
+  return bench_sqlite_default_methods.xMalloc (n_bytes);
+}
+
+static void *
+bench_sqlite_realloc (void *mem, int n_bytes)
+{
+  g_atomic_int_inc (&bench_n_allocs);
+  return bench_sqlite_default_methods.xRealloc (mem, n_bytes);
+}
+
+static void
+bench_install_alloc_counters (void)
+{
+  sqlite3_mem_methods methods;
+
+  g_mem_set_vtable (&bench_mem_vtable);
+
+  sqlite3_config (SQLITE_CONFIG_GETMALLOC, &bench_sqlite_default_methods);
+  methods = bench_sqlite_default_methods;
+  methods.xMalloc = bench_sqlite_malloc;
+  methods.xRealloc = bench_sqlite_realloc;
+  sqlite3_config (SQLITE_CONFIG_MALLOC, &methods);
+}
+
+/* Removes the generated profile, which is only ever one level of
+   subdirectories deep */
+static void
+bench_remove_dir (const gchar *path)
+{
+  GDir *dir = g_dir_open (path, 0, NULL);
+  const gchar *name;
+
+  if (dir)
+    {
+      while ((name = g_dir_read_name (dir)))
+        {
+          gchar *child = g_build_filename (path, name, NULL);
+
+          if (g_file_test (child, G_FILE_TEST_IS_DIR))
+            bench_remove_dir (child);
+          else
+            g_unlink (child);
+
+          g_free (child);
+        }
+      g_dir_close (dir);
+    }
+
+  g_rmdir (path);
+}
+
+static void
+bench_phase_add (BenchPhase *phase, gint64 start, gint start_allocs)
+{
+  gint64 usecs = mwb_stats_get_monotonic_time () - start;
+  gint64 allocs = g_atomic_int_get (&bench_n_allocs) - start_allocs;
+
+  g_array_append_val (phase->usecs, usecs);
+  g_array_append_val (phase->allocs, allocs);
+}
+
+static void
+bench_keystroke (sqlite3      *dbcon,
+                 sqlite3_stmt *search_stmt,
+                 MwbTldTrie   *tld_trie,
+                 GString      *pattern,
+                 MwbArena     *arena,
+                 const gchar  *search_text,
+                 BenchPhase   *phases)
+{
+  gint64 keystroke_start, start, match_usecs = 0, favicon_usecs = 0;
+  gint keystroke_allocs, allocs, match_allocs = 0, favicon_allocs = 0;
+  guint n_entries = 0;
+  gchar *completion, *completion_url;
+
+  keystroke_start = mwb_stats_get_monotonic_time ();
+  keystroke_allocs = g_atomic_int_get (&bench_n_allocs);
+
+  /* This mirrors mwb_ac_list_set_search_text() and the per-result
+     work in mwb_ac_list_result_received() */
+  start = keystroke_start;
+  allocs = keystroke_allocs;
+  mwb_arena_reset (arena);
+  mwb_ac_query_bind (search_stmt, search_text, pattern);
+  while (sqlite3_step (search_stmt) == SQLITE_ROW)
+    {
+      const gchar *url = (const gchar *)sqlite3_column_text (search_stmt, 0);
+      const gchar *value = (const gchar *)sqlite3_column_text (search_stmt, 1);
+      gint favicon_id = sqlite3_column_int (search_stmt, 2);
+      gint64 phase_start;
+      gint phase_allocs;
+      gint match_start, match_end;
+      gchar *icon_path;
+
+      if (!url || !value || n_entries >= BENCH_MAX_ENTRIES)
+        continue;
+      n_entries++;
+
+      mwb_arena_strdup (arena, value);
+      mwb_arena_strdup (arena, url);
+
+      phase_start = mwb_stats_get_monotonic_time ();
+      phase_allocs = g_atomic_int_get (&bench_n_allocs);
+      mwb_ac_query_stristr (value, search_text, &match_start, &match_end);
+      match_usecs += mwb_stats_get_monotonic_time () - phase_start;
+      match_allocs += g_atomic_int_get (&bench_n_allocs) - phase_allocs;
+
+      phase_start = mwb_stats_get_monotonic_time ();
+      phase_allocs = g_atomic_int_get (&bench_n_allocs);
+      icon_path = mwb_ac_query_get_favicon_filename (dbcon, favicon_id);
+      g_free (icon_path);
+      favicon_usecs += mwb_stats_get_monotonic_time () - phase_start;
+      favicon_allocs += g_atomic_int_get (&bench_n_allocs) - phase_allocs;
+    }
+  bench_phase_add (phases + PHASE_QUERY, start, allocs);
+
+  g_array_append_val (phases[PHASE_MATCH].usecs, match_usecs);
+  g_array_append_val (phases[PHASE_FAVICON].usecs, favicon_usecs);
+  {
+    gint64 v = match_allocs;
+    g_array_append_val (phases[PHASE_MATCH].allocs, v);
+    v = favicon_allocs;
+    g_array_append_val (phases[PHASE_FAVICON].allocs, v);
+  }
+
+  start = mwb_stats_get_monotonic_time ();
+  allocs = g_atomic_int_get (&bench_n_allocs);
+  mwb_ac_query_complete_domain (tld_trie, search_text,
+                                &completion, &completion_url);
+  g_free (completion);
+  g_free (completion_url);
+  bench_phase_add (phases + PHASE_COMPLETE, start, allocs);
+
+  bench_phase_add (phases + PHASE_TOTAL, keystroke_start, keystroke_allocs);
+}
+
+static gdouble
+bench_mean (GArray *samples)
+{
+  gdouble total = 0.0;
+  guint i;
+
+  if (samples->len == 0)
+    return 0.0;
+
+  for (i = 0; i < samples->len; i++)
+    total += g_array_index (samples, gint64, i);
+
+  return total / samples->len;
+}
+
+static void
+bench_run (const gchar *db_filename, const gchar *label)
+{
+  sqlite3 *dbcon = NULL;
+  sqlite3_stmt *search_stmt = NULL;
+  MwbTldTrie *tld_trie;
+  GString *pattern;
+  MwbArena *arena;
+  BenchPhase phases[N_PHASES];
+  guint i, j;
+  gint iteration;
+
+  if (sqlite3_open (db_filename, &dbcon) != SQLITE_OK)
+    {
+      g_warning ("[bench] unable to open %s: %s",
+                 db_filename, sqlite3_errmsg (dbcon));
+      sqlite3_close (dbcon);
+      return;
+    }
+
+  if (sqlite3_prepare_v2 (dbcon, MWB_AC_QUERY_SQL, -1,
+                          &search_stmt, NULL) != SQLITE_OK)
+    {
+      g_warning ("[bench] sqlite3_prepare_v2(): %s", sqlite3_errmsg (dbcon));
+      sqlite3_close (dbcon);
+      return;
+    }
+
+  tld_trie = mwb_tld_trie_new ();
+  for (i = 0; i < G_N_ELEMENTS (bench_tlds); i++)
+    mwb_tld_trie_add_score (tld_trie, bench_tlds[i], strlen (bench_tlds[i]),
+                            G_N_ELEMENTS (bench_tlds) - i);
+  mwb_ac_query_load_tld_scores (dbcon, tld_trie);
+
+  for (i = 0; i < N_PHASES; i++)
+    {
+      phases[i].usecs = g_array_new (FALSE, FALSE, sizeof (gint64));
+      phases[i].allocs = g_array_new (FALSE, FALSE, sizeof (gint64));
+    }
+
+  pattern = g_string_new ("");
+  arena = mwb_arena_new (4096);
+
+  for (iteration = 0; iteration < iterations; iteration++)
+    for (i = 0; i < G_N_ELEMENTS (bench_words); i++)
+      {
+        const gchar *word = bench_words[i];
+
+        /* Type the word one character at a time */
+        for (j = 1; j <= strlen (word); j++)
+          {
+            gchar *prefix = g_strndup (word, j);
+            bench_keystroke (dbcon, search_stmt, tld_trie, pattern, arena,
+                             prefix, phases);
+            g_free (prefix);
+          }
+      }
+
+  printf ("\n%s (%u keystrokes)\n", label, phases[PHASE_TOTAL].usecs->len);
+  printf ("  %-16s %10s %10s %10s %10s %12s\n",
+          "phase", "p50 us", "p90 us", "p99 us", "max us", "allocs/key");
+  for (i = 0; i < N_PHASES; i++)
+    {
+      printf ("  %-16s %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT
+              " %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT " %12.1f\n",
+              phase_names[i],
+              mwb_stats_percentile (phases[i].usecs, 50),
+              mwb_stats_percentile (phases[i].usecs, 90),
+              mwb_stats_percentile (phases[i].usecs, 99),
+              mwb_stats_percentile (phases[i].usecs, 100),
+              bench_mean (phases[i].allocs));
+
+      g_array_free (phases[i].usecs, TRUE);
+      g_array_free (phases[i].allocs, TRUE);
+    }
+
+  mwb_arena_free (arena);
+  mwb_tld_trie_free (tld_trie);
+  sqlite3_finalize (search_stmt);
+  g_string_free (pattern, TRUE);
+  sqlite3_close (dbcon);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  gchar **sizes;
+  gchar *tmp_dir;
+  guint i;
+
+  /* Has to happen before anything allocates */
+  bench_install_alloc_counters ();
+
+  g_type_init ();
+
+  context = g_option_context_new ("- auto-complete micro benchmarks");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Error parsing option: %s\n", error->message);
+      g_clear_error (&error);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  if (db_arg)
+    {
+      bench_run (db_arg, db_arg);
+      return 0;
+    }
+
+  tmp_dir = g_build_filename (g_get_tmp_dir (), "mwb-bench-XXXXXX", NULL);
+  if (!mkdtemp (tmp_dir))
+    {
+      g_printerr ("Unable to create %s\n", tmp_dir);
+      return 1;
+    }
+
+  /* Favicon lookups resolve against the generated profile */
+  g_setenv ("MWB_NETPANEL_DIR", tmp_dir, TRUE);
+
+  sizes = g_strsplit (sizes_arg ? sizes_arg : "1000,10000,100000,1000000",
+                      ",", -1);
+  for (i = 0; sizes[i]; i++)
+    {
+      MwbProfileGenParams params;
+      gchar *label, *db_filename;
+
+      mwb_profile_gen_params_init (&params);
+      params.n_urls = strtoul (sizes[i], NULL, 10);
+      /* Thumbnails aren't read by anything measured here */
+      params.n_thumbnails = 0;
+      params.n_tabs = 0;
+      if (params.n_urls == 0)
+        continue;
+
+      label = g_strdup_printf ("%u urls", params.n_urls);
+      db_filename = g_build_filename (tmp_dir, "chromium.db", NULL);
+
+      /* Each size replaces the previous database. The seed is fixed so
+         the favicon files written for earlier sizes stay valid. */
+      if (mwb_profile_gen_create (tmp_dir, &params, &error))
+        bench_run (db_filename, label);
+      else
+        {
+          g_printerr ("Unable to generate profile: %s\n", error->message);
+          g_clear_error (&error);
+        }
+
+      g_free (db_filename);
+      g_free (label);
+    }
+  g_strfreev (sizes);
+
+  if (keep)
+    printf ("\nProfiles kept in %s\n", tmp_dir);
+  else
+    bench_remove_dir (tmp_dir);
+  g_free (tmp_dir);
+
+  return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Generates a synthetic internet-panel profile for load testing, eg.
+
+     mwb-gen-profile --urls=100000 --tabs=256 /tmp/profile
+     MWB_NETPANEL_DIR=/tmp/profile meego-panel-web --standalone */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include "mwb-profile-gen.h"
+
+static MwbProfileGenParams params;
+static gint n_urls, n_bookmarks, n_tabs, n_thumbnails, n_favicon_files;
+static gint seed;
+static gdouble zipf_exponent;
+
+static GOptionEntry entries[] = {
+  { "urls", 'u', 0, G_OPTION_ARG_INT, &n_urls,
+    "Number of history entries", "<n>" },
+  { "bookmarks", 'b', 0, G_OPTION_ARG_INT, &n_bookmarks,
+    "Number of bookmarks", "<n>" },
+  { "tabs", 't', 0, G_OPTION_ARG_INT, &n_tabs,
+    "Number of open tabs, at most 256", "<n>" },
+  { "thumbnails", 0, 0, G_OPTION_ARG_INT, &n_thumbnails,
+    "Write thumbnails for this many of the most visited pages", "<n>" },
+  { "favicons", 0, 0, G_OPTION_ARG_INT, &n_favicon_files,
+    "Write favicons for this many of the most popular sites", "<n>" },
+  { "zipf", 'z', 0, G_OPTION_ARG_DOUBLE, &zipf_exponent,
+    "Exponent of the visit distribution", "<s>" },
+  { "seed", 's', 0, G_OPTION_ARG_INT, &seed,
+    "Random seed", "<n>" },
+  { NULL }
+};
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+
+  g_type_init ();
+
+  mwb_profile_gen_params_init (&params);
+  n_urls = params.n_urls;
+  n_bookmarks = params.n_bookmarks;
+  n_tabs = params.n_tabs;
+  n_thumbnails = params.n_thumbnails;
+  n_favicon_files = params.n_favicon_files;
+  zipf_exponent = params.zipf_exponent;
+  seed = params.seed;
+
+  context = g_option_context_new ("<directory> - generate a test profile");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Error parsing option: %s\n", error->message);
+      g_clear_error (&error);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  if (argc != 2)
+    {
+      g_printerr ("Usage: %s [OPTION...] <directory>\n", argv[0]);
+      return 1;
+    }
+
+  params.n_urls = MAX (n_urls, 1);
+  params.n_bookmarks = MAX (n_bookmarks, 0);
+  params.n_tabs = CLAMP (n_tabs, 0, MWB_PROFILE_GEN_MAX_TABS);
+  params.n_thumbnails = MAX (n_thumbnails, 0);
+  params.n_favicon_files = MAX (n_favicon_files, 0);
+  params.zipf_exponent = zipf_exponent;
+  params.seed = seed;
+
+  if (!mwb_profile_gen_create (argv[1], &params, &error))
+    {
+      g_printerr ("Unable to generate profile: %s\n", error->message);
+      g_clear_error (&error);
+      return 1;
+    }
+
+  return 0;
+}
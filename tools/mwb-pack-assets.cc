@@ -0,0 +1,260 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Packs theme images into the pre-decoded atlas read by mwb-assets, eg.
+
+     mwb-pack-assets --source-dir=data/netpanel assets.atlas o2_globe.png
+
+   The atlas is written in host byte order so it has to be generated on
+   the machine, or at least the architecture, it is used on. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "mwb-assets.h"
+
+/* Gap around each image. The edge pixels are repeated into it so that
+   linear filtering doesn't pull in the neighbouring image. */
+#define PADDING 1
+
+typedef struct
+{
+  const gchar *name;
+  GdkPixbuf   *pixbuf;
+  guint        x, y;
+} Image;
+
+static gchar *source_dir;
+
+static GOptionEntry entries[] = {
+  { "source-dir", 'd', 0, G_OPTION_ARG_FILENAME, &source_dir,
+    "Directory to read the images from", "<dir>" },
+  { NULL }
+};
+
+static gint
+compare_height (gconstpointer a, gconstpointer b)
+{
+  gint height_a = gdk_pixbuf_get_height (((const Image *) a)->pixbuf);
+  gint height_b = gdk_pixbuf_get_height (((const Image *) b)->pixbuf);
+
+  return height_b - height_a;
+}
+
+/* Shelves of images sorted by height, which wastes little space on a
+   handful of small images. Returns the height used. */
+static guint
+pack (GArray *images, guint width)
+{
+  guint i, x = 0, y = 0, shelf_height = 0;
+
+  g_array_sort (images, compare_height);
+
+  for (i = 0; i < images->len; i++)
+    {
+      Image *image = &g_array_index (images, Image, i);
+      guint w = gdk_pixbuf_get_width (image->pixbuf) + PADDING * 2;
+      guint h = gdk_pixbuf_get_height (image->pixbuf) + PADDING * 2;
+
+      if (x + w > width)
+        {
+          y += shelf_height;
+          x = 0;
+          shelf_height = 0;
+        }
+
+      image->x = x + PADDING;
+      image->y = y + PADDING;
+      x += w;
+      shelf_height = MAX (shelf_height, h);
+    }
+
+  return y + shelf_height;
+}
+
+static void
+copy_image (guchar *pixels, guint rowstride, const Image *image)
+{
+  const guchar *src = gdk_pixbuf_get_pixels (image->pixbuf);
+  gint src_stride = gdk_pixbuf_get_rowstride (image->pixbuf);
+  gint channels = gdk_pixbuf_get_n_channels (image->pixbuf);
+  gint w = gdk_pixbuf_get_width (image->pixbuf);
+  gint h = gdk_pixbuf_get_height (image->pixbuf);
+  gint x, y;
+
+  /* Covers the padding too by clamping to the nearest source pixel */
+  for (y = -PADDING; y < h + PADDING; y++)
+    {
+      const guchar *row = src + CLAMP (y, 0, h - 1) * src_stride;
+      guchar *dst = pixels + (image->y + y) * rowstride
+        + (image->x - PADDING) * 4;
+
+      for (x = -PADDING; x < w + PADDING; x++, dst += 4)
+        {
+          const guchar *p = row + CLAMP (x, 0, w - 1) * channels;
+
+          dst[0] = p[0];
+          dst[1] = p[1];
+          dst[2] = p[2];
+          dst[3] = channels == 4 ? p[3] : 0xff;
+        }
+    }
+}
+
+static gboolean
+write_atlas (const gchar *filename,
+             GArray      *images,
+             guint        width,
+             guint        height,
+             guchar      *pixels,
+             GError     **error)
+{
+  MwbAssetsHeader header;
+  GString *contents;
+  gboolean result;
+  guint i;
+
+  memcpy (header.magic, MWB_ASSETS_MAGIC, sizeof (header.magic));
+  header.version = MWB_ASSETS_VERSION;
+  header.width = width;
+  header.height = height;
+  header.n_entries = images->len;
+
+  contents = g_string_sized_new (sizeof (header)
+                                 + images->len * sizeof (MwbAssetsEntry)
+                                 + width * height * 4);
+  g_string_append_len (contents, (const gchar *) &header, sizeof (header));
+
+  for (i = 0; i < images->len; i++)
+    {
+      const Image *image = &g_array_index (images, Image, i);
+      MwbAssetsEntry entry;
+
+      memset (&entry, 0, sizeof (entry));
+      strncpy (entry.name, image->name, sizeof (entry.name) - 1);
+      entry.x = image->x;
+      entry.y = image->y;
+      entry.width = gdk_pixbuf_get_width (image->pixbuf);
+      entry.height = gdk_pixbuf_get_height (image->pixbuf);
+
+      g_string_append_len (contents, (const gchar *) &entry, sizeof (entry));
+    }
+
+  g_string_append_len (contents, (const gchar *) pixels, width * height * 4);
+
+  result = g_file_set_contents (filename, contents->str, contents->len, error);
+  g_string_free (contents, TRUE);
+
+  return result;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GArray *images;
+  guint i, width, height, max_width = 0, area = 0;
+  guchar *pixels;
+
+  g_type_init ();
+
+  context = g_option_context_new ("<atlas> <image>... - pack theme images");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      fprintf (stderr, "%s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  if (argc < 3)
+    {
+      fprintf (stderr, "Usage: %s [--source-dir=<dir>] <atlas> <image>...\n",
+               argv[0]);
+      return 1;
+    }
+
+  images = g_array_new (FALSE, FALSE, sizeof (Image));
+
+  for (i = 2; i < (guint) argc; i++)
+    {
+      gchar *path = source_dir ? g_build_filename (source_dir, argv[i], NULL)
+        : g_strdup (argv[i]);
+      Image image;
+
+      image.name = argv[i];
+      image.pixbuf = gdk_pixbuf_new_from_file (path, &error);
+      g_free (path);
+
+      if (!image.pixbuf)
+        {
+          fprintf (stderr, "%s\n", error->message);
+          return 1;
+        }
+      if (strlen (image.name) >= MWB_ASSETS_NAME_SIZE)
+        {
+          fprintf (stderr, "%s: name too long\n", image.name);
+          return 1;
+        }
+      if (gdk_pixbuf_get_bits_per_sample (image.pixbuf) != 8)
+        {
+          fprintf (stderr, "%s: only 8 bits per sample is supported\n",
+                   image.name);
+          return 1;
+        }
+
+      max_width = MAX (max_width,
+                       (guint) gdk_pixbuf_get_width (image.pixbuf)
+                       + PADDING * 2);
+      area += (gdk_pixbuf_get_width (image.pixbuf) + PADDING * 2)
+        * (gdk_pixbuf_get_height (image.pixbuf) + PADDING * 2);
+
+      g_array_append_val (images, image);
+    }
+
+  /* Roughly square, a power of two wide */
+  for (width = 64; width < max_width || width * width < area; width *= 2);
+  height = pack (images, width);
+
+  pixels = (guchar *) g_malloc0 (width * height * 4);
+  for (i = 0; i < images->len; i++)
+    copy_image (pixels, width * 4, &g_array_index (images, Image, i));
+
+  if (!write_atlas (argv[1], images, width, height, pixels, &error))
+    {
+      fprintf (stderr, "%s\n", error->message);
+      return 1;
+    }
+
+  printf ("%s: %u images in %ux%u\n", argv[1], images->len, width, height);
+
+  g_free (pixels);
+  for (i = 0; i < images->len; i++)
+    g_object_unref (g_array_index (images, Image, i).pixbuf);
+  g_array_free (images, TRUE);
+
+  return 0;
+}
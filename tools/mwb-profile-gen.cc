@@ -0,0 +1,491 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <time.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <sqlite3.h>
+
+#include "mwb-profile-gen.h"
+
+/* Seconds between the Windows epoch Chromium uses and the Unix one */
+#define CHROMIUM_EPOCH_DELTA G_GINT64_CONSTANT (11644473600)
+
+#define THUMBNAIL_WIDTH  210
+#define THUMBNAIL_HEIGHT 114
+#define FAVICON_SIZE     16
+
+/* URLs we keep in memory after inserting them, for tabs and bookmarks */
+#define KEEP_URLS_MIN 1000
+
+#define PROFILE_SCHEMA_SQL \
+  "CREATE TABLE urls (id INTEGER PRIMARY KEY, url LONGVARCHAR, " \
+  "title LONGVARCHAR, visit_count INTEGER DEFAULT 0 NOT NULL, " \
+  "typed_count INTEGER DEFAULT 0 NOT NULL, " \
+  "last_visit_time INTEGER NOT NULL, " \
+  "hidden INTEGER DEFAULT 0 NOT NULL, " \
+  "favicon_id INTEGER DEFAULT 0 NOT NULL);" \
+  "CREATE INDEX urls_url_index ON urls (url);" \
+  "CREATE TABLE favicons (id INTEGER PRIMARY KEY, " \
+  "url LONGVARCHAR NOT NULL, last_updated INTEGER DEFAULT 0, " \
+  "image_data BLOB);" \
+  "CREATE TABLE bookmarks (id INTEGER PRIMARY KEY, url LONGVARCHAR, " \
+  "title LONGVARCHAR, favicon_id INTEGER DEFAULT 0 NOT NULL);" \
+  "CREATE TABLE current_tabs (tab_id INTEGER PRIMARY KEY, " \
+  "url LONGVARCHAR, title LONGVARCHAR);"
+
+static const gchar *profile_words[] =
+  {
+    "news", "mail", "wiki", "forum", "shop", "blog", "video", "maps",
+    "search", "photo", "music", "games", "sport", "weather", "travel",
+    "open", "source", "linux", "kernel", "mobile", "cloud", "daily",
+    "world", "local", "market", "review", "guide", "store", "home",
+    "garden", "food", "recipe", "movie", "book", "science", "health"
+  };
+
+/* Titles pick from these some of the time so the UTF-8 paths in the
+   matching code get exercised */
+static const gchar *profile_unicode_words[] =
+  {
+    "Uutiset", "Sää", "Jäätelö", "Straße", "Café", "Übersicht",
+    "Привет", "Новости", "Погода", "Ελληνικά", "Ειδήσεις",
+    "日本語", "天気", "ニュース", "中文", "新闻", "한국어", "뉴스",
+    "عربي", "أخبار", "עברית", "हिन्दी", "ภาษาไทย", "Tiếng Việt"
+  };
+
+static const gchar *profile_tlds[] =
+  {
+    ".com", ".org", ".net", ".co.uk", ".fi", ".de", ".jp", ".com.cn"
+  };
+
+typedef struct
+{
+  gdouble *cdf;
+  guint    n;
+} ZipfTable;
+
+static void
+zipf_table_init (ZipfTable *table, guint n, gdouble exponent)
+{
+  gdouble sum = 0.0;
+  guint i;
+
+  table->n = n;
+  table->cdf = g_new (gdouble, n);
+
+  for (i = 0; i < n; i++)
+    {
+      sum += 1.0 / pow (i + 1, exponent);
+      table->cdf[i] = sum;
+    }
+  for (i = 0; i < n; i++)
+    table->cdf[i] /= sum;
+}
+
+/* Returns a rank in [0, n), 0 being the most likely */
+static guint
+zipf_table_sample (ZipfTable *table, GRand *rand)
+{
+  gdouble u = g_rand_double (rand);
+  guint lo = 0, hi = table->n - 1;
+
+  while (lo < hi)
+    {
+      guint mid = (lo + hi) / 2;
+
+      if (table->cdf[mid] < u)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+static const gchar *
+profile_word (GRand *rand)
+{
+  return profile_words[g_rand_int_range (rand, 0,
+                                         G_N_ELEMENTS (profile_words))];
+}
+
+static gchar *
+profile_make_host (GRand *rand, guint index)
+{
+  GString *host = g_string_new (NULL);
+
+  g_string_append (host, profile_word (rand));
+  if (g_rand_boolean (rand))
+    {
+      if (g_rand_boolean (rand))
+        g_string_append_c (host, '-');
+      g_string_append (host, profile_word (rand));
+    }
+  /* Keeps host names unique without making them look machine made */
+  g_string_append_printf (host, "%u", index);
+  g_string_append (host,
+                   profile_tlds[index % G_N_ELEMENTS (profile_tlds)]);
+
+  return g_string_free (host, FALSE);
+}
+
+static gchar *
+profile_make_url (GRand *rand, const gchar *host, guint index)
+{
+  GString *url = g_string_new (NULL);
+  gint n_segments = g_rand_int_range (rand, 0, 6);
+  gint i;
+
+  g_string_append (url, g_rand_int_range (rand, 0, 5) ? "http://" : "https://");
+  if (g_rand_int_range (rand, 0, 5) < 3)
+    g_string_append (url, "www.");
+  g_string_append (url, host);
+
+  for (i = 0; i < n_segments; i++)
+    {
+      g_string_append_c (url, '/');
+      if (g_rand_int_range (rand, 0, 4) == 0)
+        g_string_append_printf (url, "%u", g_rand_int_range (rand, 1, 100000));
+      else
+        g_string_append (url, profile_word (rand));
+    }
+
+  /* Make sure every URL is distinct */
+  g_string_append_printf (url, "/%u", index);
+  if (g_rand_int_range (rand, 0, 3) == 0)
+    g_string_append_printf (url, ".html?q=%s&id=%u",
+                            profile_word (rand),
+                            g_rand_int (rand));
+  else
+    g_string_append_c (url, '/');
+
+  return g_string_free (url, FALSE);
+}
+
+static gchar *
+profile_make_title (GRand *rand, const gchar *host)
+{
+  GString *title = g_string_new (NULL);
+  gint n_words = g_rand_int_range (rand, 2, 11);
+  gint i;
+
+  for (i = 0; i < n_words; i++)
+    {
+      const gchar *word;
+
+      if (i > 0)
+        g_string_append_c (title, ' ');
+
+      if (g_rand_int_range (rand, 0, 100) < 15)
+        word = profile_unicode_words[g_rand_int_range (rand, 0,
+                                                       G_N_ELEMENTS (profile_unicode_words))];
+      else
+        word = profile_word (rand);
+
+      if (i == 0 && g_ascii_islower (*word))
+        {
+          g_string_append_c (title, g_ascii_toupper (*word));
+          g_string_append (title, word + 1);
+        }
+      else
+        g_string_append (title, word);
+    }
+
+  if (g_rand_boolean (rand))
+    g_string_append_printf (title, " - %s", host);
+
+  return g_string_free (title, FALSE);
+}
+
+static gboolean
+profile_exec (sqlite3 *dbcon, const gchar *sql, GError **error)
+{
+  gchar *errmsg = NULL;
+
+  if (sqlite3_exec (dbcon, sql, NULL, NULL, &errmsg) != SQLITE_OK)
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   "%s", errmsg);
+      sqlite3_free (errmsg);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Solid colour derived from the key so different URLs look different
+   and the PNG encoder has something to do */
+static gboolean
+profile_write_image (const gchar *dir,
+                     const gchar *key,
+                     const gchar *extension,
+                     const gchar *type,
+                     gint         width,
+                     gint         height,
+                     GError     **error)
+{
+  gchar *csum = g_compute_checksum_for_string (G_CHECKSUM_MD5, key, -1);
+  gchar *filename = g_strconcat (csum, extension, NULL);
+  gchar *path = g_build_filename (dir, filename, NULL);
+  GdkPixbuf *pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
+                                      width, height);
+  gboolean ret;
+
+  gdk_pixbuf_fill (pixbuf, ((guint32)g_str_hash (csum) & 0xffffff00) | 0xff);
+  ret = gdk_pixbuf_save (pixbuf, path, type, error, NULL);
+
+  g_object_unref (pixbuf);
+  g_free (path);
+  g_free (filename);
+  g_free (csum);
+
+  return ret;
+}
+
+void
+mwb_profile_gen_params_init (MwbProfileGenParams *params)
+{
+  params->n_urls = 10000;
+  params->n_bookmarks = 50;
+  params->n_tabs = 8;
+  params->n_thumbnails = 16;
+  params->n_favicon_files = 100;
+  params->zipf_exponent = 1.0;
+  params->seed = 42;
+}
+
+gboolean
+mwb_profile_gen_create (const gchar               *dir,
+                        const MwbProfileGenParams *params,
+                        GError                   **error)
+{
+  sqlite3 *dbcon = NULL;
+  sqlite3_stmt *url_stmt = NULL, *favicon_stmt = NULL;
+  sqlite3_stmt *bookmark_stmt = NULL, *tab_stmt = NULL;
+  gchar *db_path, *thumbnails_dir, *favicons_dir;
+  gchar **hosts, **urls, **titles;
+  guint n_hosts, n_keep, n_tabs, i;
+  ZipfTable host_table;
+  GRand *rand;
+  gint64 now;
+  gboolean ret = FALSE;
+
+  thumbnails_dir = g_build_filename (dir, "thumbnails", NULL);
+  favicons_dir = g_build_filename (dir, "favicons", NULL);
+  db_path = g_build_filename (dir, "chromium.db", NULL);
+
+  if (g_mkdir_with_parents (thumbnails_dir, 0755) ||
+      g_mkdir_with_parents (favicons_dir, 0755))
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   "Unable to create %s", dir);
+      g_free (thumbnails_dir);
+      g_free (favicons_dir);
+      g_free (db_path);
+      return FALSE;
+    }
+
+  /* Always start from an empty database */
+  g_unlink (db_path);
+  if (sqlite3_open (db_path, &dbcon) != SQLITE_OK)
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   "Unable to create %s: %s",
+                   db_path, sqlite3_errmsg (dbcon));
+      goto out;
+    }
+
+  if (!profile_exec (dbcon,
+                     "PRAGMA synchronous = OFF;"
+                     "PRAGMA journal_mode = OFF;"
+                     PROFILE_SCHEMA_SQL
+                     "BEGIN;",
+                     error))
+    goto out;
+
+  if (sqlite3_prepare_v2 (dbcon,
+                          "INSERT INTO urls (url, title, visit_count, "
+                          "typed_count, last_visit_time, favicon_id) "
+                          "VALUES (?, ?, ?, ?, ?, ?)",
+                          -1, &url_stmt, NULL) ||
+      sqlite3_prepare_v2 (dbcon,
+                          "INSERT INTO favicons (id, url, last_updated) "
+                          "VALUES (?, ?, ?)",
+                          -1, &favicon_stmt, NULL) ||
+      sqlite3_prepare_v2 (dbcon,
+                          "INSERT INTO bookmarks (url, title, favicon_id) "
+                          "VALUES (?, ?, ?)",
+                          -1, &bookmark_stmt, NULL) ||
+      sqlite3_prepare_v2 (dbcon,
+                          "INSERT INTO current_tabs (tab_id, url, title) "
+                          "VALUES (?, ?, ?)",
+                          -1, &tab_stmt, NULL))
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   "%s", sqlite3_errmsg (dbcon));
+      goto out;
+    }
+
+  rand = g_rand_new_with_seed (params->seed);
+  now = ((gint64)time (NULL) + CHROMIUM_EPOCH_DELTA) * G_USEC_PER_SEC;
+
+  /* Roughly twenty pages per site, sites chosen by a Zipf law so a
+     few hosts dominate the history like they do in real profiles */
+  n_hosts = MAX (params->n_urls / 20, 1);
+  hosts = g_new0 (gchar *, n_hosts);
+  for (i = 0; i < n_hosts; i++)
+    {
+      gchar *favicon_url;
+
+      hosts[i] = profile_make_host (rand, i);
+
+      favicon_url = g_strconcat ("http://", hosts[i], "/favicon.ico", NULL);
+      sqlite3_reset (favicon_stmt);
+      sqlite3_bind_int (favicon_stmt, 1, i + 1);
+      sqlite3_bind_text (favicon_stmt, 2, favicon_url, -1, SQLITE_TRANSIENT);
+      sqlite3_bind_int64 (favicon_stmt, 3, now);
+      sqlite3_step (favicon_stmt);
+
+      if (i < params->n_favicon_files &&
+          !profile_write_image (favicons_dir, favicon_url, ".ico", "ico",
+                                FAVICON_SIZE, FAVICON_SIZE, error))
+        {
+          g_free (favicon_url);
+          n_keep = 0;
+          urls = titles = NULL;
+          goto out_hosts;
+        }
+
+      g_free (favicon_url);
+    }
+  zipf_table_init (&host_table, n_hosts, params->zipf_exponent);
+
+  n_keep = MAX (MAX (params->n_thumbnails, params->n_bookmarks),
+                KEEP_URLS_MIN);
+  n_keep = MIN (n_keep, params->n_urls);
+  urls = g_new0 (gchar *, n_keep);
+  titles = g_new0 (gchar *, n_keep);
+
+  /* URLs are generated most visited first so the top N are simply the
+     first N rows */
+  for (i = 0; i < params->n_urls; i++)
+    {
+      guint host = zipf_table_sample (&host_table, rand);
+      gchar *url = profile_make_url (rand, hosts[host], i);
+      gchar *title = profile_make_title (rand, hosts[host]);
+      gint visit_count
+        = MAX (1, (gint)(10000.0 / pow (i + 1, params->zipf_exponent)));
+
+      sqlite3_reset (url_stmt);
+      sqlite3_bind_text (url_stmt, 1, url, -1, SQLITE_TRANSIENT);
+      sqlite3_bind_text (url_stmt, 2, title, -1, SQLITE_TRANSIENT);
+      sqlite3_bind_int (url_stmt, 3, visit_count);
+      sqlite3_bind_int (url_stmt, 4, g_rand_int_range (rand, 0, 4) == 0
+                        ? visit_count / 2 : 0);
+      /* Anywhere in the last 90 days */
+      sqlite3_bind_int64 (url_stmt, 5,
+                          now - (gint64)g_rand_int_range (rand, 0, 90 * 24 * 3600)
+                          * G_USEC_PER_SEC);
+      sqlite3_bind_int (url_stmt, 6, host + 1);
+      sqlite3_step (url_stmt);
+
+      if (i < params->n_thumbnails &&
+          !profile_write_image (thumbnails_dir, url, ".png", "png",
+                                THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT, error))
+        {
+          g_free (url);
+          g_free (title);
+          goto out_urls;
+        }
+
+      if (i < n_keep)
+        {
+          urls[i] = url;
+          titles[i] = title;
+        }
+      else
+        {
+          g_free (url);
+          g_free (title);
+        }
+    }
+
+  for (i = 0; i < params->n_bookmarks && i < n_keep; i++)
+    {
+      guint index = g_rand_int_range (rand, 0, n_keep);
+
+      sqlite3_reset (bookmark_stmt);
+      sqlite3_bind_text (bookmark_stmt, 1, urls[index], -1, SQLITE_STATIC);
+      sqlite3_bind_text (bookmark_stmt, 2, titles[index], -1, SQLITE_STATIC);
+      sqlite3_bind_int (bookmark_stmt, 3, 0);
+      sqlite3_step (bookmark_stmt);
+    }
+
+  n_tabs = MIN (params->n_tabs, MWB_PROFILE_GEN_MAX_TABS);
+  for (i = 0; i < n_tabs && n_keep > 0; i++)
+    {
+      guint index = g_rand_int_range (rand, 0, n_keep);
+
+      sqlite3_reset (tab_stmt);
+      sqlite3_bind_int (tab_stmt, 1, i + 1);
+      sqlite3_bind_text (tab_stmt, 2, urls[index], -1, SQLITE_STATIC);
+      sqlite3_bind_text (tab_stmt, 3, titles[index], -1, SQLITE_STATIC);
+      sqlite3_step (tab_stmt);
+
+      if (index >= params->n_thumbnails &&
+          !profile_write_image (thumbnails_dir, urls[index], ".png", "png",
+                                THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT, error))
+        goto out_urls;
+    }
+
+  ret = profile_exec (dbcon, "COMMIT;", error);
+
+ out_urls:
+  g_free (host_table.cdf);
+ out_hosts:
+  for (i = 0; i < n_keep; i++)
+    {
+      g_free (urls[i]);
+      g_free (titles[i]);
+    }
+  g_free (urls);
+  g_free (titles);
+  for (i = 0; i < n_hosts; i++)
+    g_free (hosts[i]);
+  g_free (hosts);
+  g_rand_free (rand);
+
+ out:
+  sqlite3_finalize (url_stmt);
+  sqlite3_finalize (favicon_stmt);
+  sqlite3_finalize (bookmark_stmt);
+  sqlite3_finalize (tab_stmt);
+  sqlite3_close (dbcon);
+
+  g_free (thumbnails_dir);
+  g_free (favicons_dir);
+  g_free (db_path);
+
+  return ret;
+}
@@ -0,0 +1,63 @@
+/*
+ * Meego-Web-Browser: The web browser for Meego
+ * Copyright (c) 2010, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Writes a synthetic internet-panel profile: chromium.db with the
+   urls, bookmarks, favicons and current_tabs tables the panel reads,
+   plus the thumbnails/ and favicons/ directories next to it. Point
+   $MWB_NETPANEL_DIR at the result to load it. */
+
+#ifndef _MWB_PROFILE_GEN_H
+#define _MWB_PROFILE_GEN_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* The most rows TAB_SQL will ever read */
+#define MWB_PROFILE_GEN_MAX_TABS 256
+
+typedef struct
+{
+  guint   n_urls;
+  guint   n_bookmarks;
+  guint   n_tabs;
+
+  /* Thumbnails are written for this many of the most visited URLs as
+     well as for every open tab */
+  guint   n_thumbnails;
+
+  /* Favicon files are written for this many of the most popular
+     hosts. Every host still gets a row in the favicons table. */
+  guint   n_favicon_files;
+
+  /* Exponent of the Zipf distribution used for both host popularity
+     and per-URL visit counts */
+  gdouble zipf_exponent;
+
+  guint32 seed;
+} MwbProfileGenParams;
+
+void     mwb_profile_gen_params_init (MwbProfileGenParams *params);
+
+gboolean mwb_profile_gen_create      (const gchar               *dir,
+                                      const MwbProfileGenParams *params,
+                                      GError                   **error);
+
+G_END_DECLS
+
+#endif /* _MWB_PROFILE_GEN_H */